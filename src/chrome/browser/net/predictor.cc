@@ -6,12 +6,14 @@
 
 #include <algorithm>
 #include <cmath>
+#include <functional>
 #include <set>
 #include <sstream>
 
 #include "base/bind.h"
 #include "base/command_line.h"
 #include "base/compiler_specific.h"
+#include "base/format_macros.h"
 #include "base/metrics/histogram.h"
 #include "base/prefs/pref_service.h"
 #include "base/stl_util.h"
@@ -45,7 +47,10 @@ using content::BrowserThread;
 namespace chrome_browser_net {
 
 // static
-const int Predictor::kPredictorReferrerVersion = 2;
+const int Predictor::kPredictorReferrerVersion = 3;
+const int Predictor::kPredictorLegacyReferrerVersion = 2;
+// Enough for 500 typical pages' worth of subresource hosts.
+const size_t Predictor::kMaxReferrerEdges = 5000;
 const double Predictor::kPreconnectWorthyExpectedValue = 0.8;
 const double Predictor::kDNSPreresolutionWorthyExpectedValue = 0.1;
 const double Predictor::kDiscardableExpectedValue = 0.05;
@@ -131,11 +136,19 @@ Predictor::Predictor(bool preconnect_enabled)
       peak_pending_lookups_(0),
       shutdown_(false),
       max_concurrent_dns_lookups_(g_max_parallel_resolves),
+      speculative_lookup_limit_(max_concurrent_dns_lookups_),
+      smoothed_resolve_duration_(
+          TimeDelta::FromMilliseconds(kExpectedResolutionTimeMs)),
+      speculative_lookups_(0),
+      speculative_lookup_hits_(0),
+      wasted_speculative_lookups_(0),
       max_dns_queue_delay_(
           TimeDelta::FromMilliseconds(g_max_queueing_delay_ms)),
       host_resolver_(NULL),
       preconnect_enabled_(preconnect_enabled),
       consecutive_omnibox_preconnect_count_(0),
+      referrer_edge_count_(0),
+      max_referrer_edges_(kMaxReferrerEdges),
       next_trim_time_(base::TimeTicks::Now() +
                       TimeDelta::FromHours(kDurationBetweenTrimmingsHours)) {
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::UI));
@@ -357,6 +370,11 @@ void Predictor::set_max_parallel_resolves(size_t max_parallel_resolves) {
   g_max_parallel_resolves = max_parallel_resolves;
 }
 
+void Predictor::SetMaxReferrerEdgesForTesting(size_t max_referrer_edges) {
+  max_referrer_edges_ = max_referrer_edges;
+  EvictReferrerEdgesIfNeeded();
+}
+
 void Predictor::ShutdownOnUIThread(PrefService* user_prefs) {
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::UI));
 
@@ -384,7 +402,7 @@ void Predictor::DiscardAllResults() {
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
   // Delete anything listed so far in this session that shows in about:dns.
   referrers_.clear();
-
+  referrer_edge_count_ = 0;
 
   // Try to delete anything in our work queue.
   while (!work_queue_.IsEmpty()) {
@@ -449,7 +467,20 @@ void Predictor::LearnFromNavigation(const GURL& referring_url,
   DCHECK_EQ(target_url, Predictor::CanonicalizeUrl(target_url));
   DCHECK_NE(target_url, GURL::EmptyGURL());
 
-  referrers_[referring_url].SuggestHost(target_url);
+  Results::iterator result = results_.find(target_url);
+  bool preresolved = result != results_.end() &&
+      result->second.was_found() && result->second.MarkUsed();
+  if (preresolved)
+    ++speculative_lookup_hits_;
+  UMA_HISTOGRAM_BOOLEAN("Net.PredictionSubresourceWasPreresolved",
+                        preresolved);
+
+  Referrer* referrer = &referrers_[referring_url];
+  size_t old_size = referrer->size();
+  referrer->SuggestHost(target_url);
+  referrer_edge_count_ += referrer->size();
+  referrer_edge_count_ -= old_size;
+  EvictReferrerEdgesIfNeeded();
   // Possibly do some referrer trimming.
   TrimReferrers();
 }
@@ -556,6 +587,16 @@ void Predictor::GetHtmlInfo(std::string* output) {
   // Show list of subresource predictions and stats.
   GetHtmlReferrerLists(output);
 
+  base::StringAppendF(
+      output,
+      "Speculative lookups: %" PRId64 " (%" PRId64 " needed, %" PRId64
+      " expired unused); currently allowing %" PRIuS " of %" PRIuS
+      " in parallel, smoothed lookup time %" PRId64 "ms.<br>",
+      speculative_lookups_, speculative_lookup_hits_,
+      wasted_speculative_lookups_, speculative_lookup_limit_,
+      max_concurrent_dns_lookups_,
+      smoothed_resolve_duration_.InMilliseconds());
+
   // Local lists for calling UrlInfo
   UrlInfo::UrlInfoTable name_not_found;
   UrlInfo::UrlInfoTable name_preresolved;
@@ -603,47 +644,52 @@ void Predictor::SerializeReferrers(base::ListValue* referral_list) {
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
   referral_list->Clear();
   referral_list->Append(new base::FundamentalValue(kPredictorReferrerVersion));
-  for (Referrers::const_iterator it = referrers_.begin();
-       it != referrers_.end(); ++it) {
-    // Serialize the list of subresource names.
-    Value* subresource_list(it->second.Serialize());
-
-    // Create a list for each referer.
-    ListValue* motivator(new ListValue);
-    motivator->Append(new StringValue(it->first.spec()));
-    motivator->Append(subresource_list);
-
-    referral_list->Append(motivator);
-  }
+  if (referrers_.empty())
+    return;
+  std::string encoded;
+  EncodeReferrers(referrers_, &encoded);
+  referral_list->Append(new base::StringValue(encoded));
 }
 
 void Predictor::DeserializeReferrers(const base::ListValue& referral_list) {
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
   int format_version = -1;
-  if (referral_list.GetSize() > 0 &&
-      referral_list.GetInteger(0, &format_version) &&
-      format_version == kPredictorReferrerVersion) {
+  if (referral_list.GetSize() == 0 ||
+      !referral_list.GetInteger(0, &format_version)) {
+    return;
+  }
+
+  if (format_version == kPredictorReferrerVersion) {
+    std::string encoded;
+    if (referral_list.GetString(1, &encoded) &&
+        !DecodeReferrers(encoded, &referrers_)) {
+      LOG(WARNING) << "Discarding corrupt predictor referrers.";
+    }
+  } else if (format_version == kPredictorLegacyReferrerVersion) {
     for (size_t i = 1; i < referral_list.GetSize(); ++i) {
       const base::ListValue* motivator;
       if (!referral_list.GetList(i, &motivator)) {
         NOTREACHED();
-        return;
+        break;
       }
       std::string motivating_url_spec;
       if (!motivator->GetString(0, &motivating_url_spec)) {
         NOTREACHED();
-        return;
+        break;
       }
 
       const Value* subresource_list;
       if (!motivator->Get(1, &subresource_list)) {
         NOTREACHED();
-        return;
+        break;
       }
 
       referrers_[GURL(motivating_url_spec)].Deserialize(*subresource_list);
     }
   }
+
+  CountReferrerEdges();
+  EvictReferrerEdgesIfNeeded();
 }
 
 void Predictor::DeserializeReferrersThenDelete(
@@ -875,6 +921,10 @@ void Predictor::PrepareFrameSubresources(const GURL& url,
   referrer->IncrementUseCount();
   const UrlInfo::ResolutionMotivation motivation =
       UrlInfo::LEARNED_REFERAL_MOTIVATED;
+  // Subresources worth preresolving are queued as one batch, most likely
+  // first, so that the ones we expect to need win any contention for the
+  // speculative lookup limit.
+  std::vector<std::pair<double, GURL> > preresolutions;
   for (Referrer::iterator future_url = referrer->begin();
        future_url != referrer->end(); ++future_url) {
     SubresourceValue evalution(TOO_NEW);
@@ -895,14 +945,24 @@ void Predictor::PrepareFrameSubresources(const GURL& url,
     } else if (connection_expectation > kDNSPreresolutionWorthyExpectedValue) {
       evalution = PRERESOLUTION;
       future_url->second.preresolution_increment();
-      UrlInfo* queued_info = AppendToResolutionQueue(future_url->first,
-                                                     motivation);
-      if (queued_info)
-        queued_info->SetReferringHostname(url);
+      preresolutions.push_back(
+          std::make_pair(connection_expectation, future_url->first));
     }
     UMA_HISTOGRAM_ENUMERATION("Net.PreconnectSubresourceEval", evalution,
                               SUBRESOURCE_VALUE_MAX);
   }
+
+  if (preresolutions.empty())
+    return;
+  std::sort(preresolutions.begin(), preresolutions.end(),
+            std::greater<std::pair<double, GURL> >());
+  for (size_t i = 0; i < preresolutions.size(); ++i) {
+    UrlInfo* queued_info = QueueForResolution(preresolutions[i].second,
+                                              motivation);
+    if (queued_info)
+      queued_info->SetReferringHostname(url);
+  }
+  StartSomeQueuedResolutions();
 }
 
 void Predictor::OnLookupFinished(LookupRequest* request, const GURL& url,
@@ -913,9 +973,30 @@ void Predictor::OnLookupFinished(LookupRequest* request, const GURL& url,
   pending_lookups_.erase(request);
   delete request;
 
+  Results::const_iterator it = results_.find(url);
+  if (it != results_.end())
+    AdjustSpeculativeLookupLimit(it->second.resolve_duration());
+
   StartSomeQueuedResolutions();
 }
 
+void Predictor::AdjustSpeculativeLookupLimit(TimeDelta resolve_duration) {
+  // Same smoothing as TCP's round trip time estimate.
+  smoothed_resolve_duration_ =
+      (smoothed_resolve_duration_ * 7 + resolve_duration) / 8;
+  // While lookups take no longer than expected, allow the full limit.  Past
+  // that, scale it down in proportion, so that the rate at which speculative
+  // lookups are issued tracks the rate at which the resolver completes them.
+  int64 duration_ms = std::max<int64>(
+      smoothed_resolve_duration_.InMilliseconds(), 1);
+  size_t limit = max_concurrent_dns_lookups_;
+  if (duration_ms > kExpectedResolutionTimeMs) {
+    limit = static_cast<size_t>(
+        max_concurrent_dns_lookups_ * kExpectedResolutionTimeMs / duration_ms);
+  }
+  speculative_lookup_limit_ = std::max<size_t>(limit, 1);
+}
+
 void Predictor::LookupFinished(LookupRequest* request, const GURL& url,
                                bool found) {
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
@@ -934,6 +1015,15 @@ void Predictor::LookupFinished(LookupRequest* request, const GURL& url,
 UrlInfo* Predictor::AppendToResolutionQueue(
     const GURL& url,
     UrlInfo::ResolutionMotivation motivation) {
+  UrlInfo* info = QueueForResolution(url, motivation);
+  if (info)
+    StartSomeQueuedResolutions();
+  return info;
+}
+
+UrlInfo* Predictor::QueueForResolution(
+    const GURL& url,
+    UrlInfo::ResolutionMotivation motivation) {
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
   DCHECK(url.has_host());
 
@@ -948,13 +1038,19 @@ UrlInfo* Predictor::AppendToResolutionQueue(
   DCHECK(info->HasUrl(url));
 
   if (!info->NeedsDnsUpdate()) {
+    // Let a more urgent request move a name that is already queued ahead.
+    if (info->is_queued())
+      work_queue_.Push(url, motivation);
     info->DLogResultsStats("DNS PrefetchNotUpdated");
     return NULL;
   }
 
+  if (info->was_found() && !info->was_used()) {
+    // Our last lookup of this name expired without ever being needed.
+    ++wasted_speculative_lookups_;
+  }
   info->SetQueuedState(motivation);
   work_queue_.Push(url, motivation);
-  StartSomeQueuedResolutions();
   return info;
 }
 
@@ -980,7 +1076,7 @@ void Predictor::StartSomeQueuedResolutions() {
   DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
 
   while (!work_queue_.IsEmpty() &&
-         pending_lookups_.size() < max_concurrent_dns_lookups_) {
+         pending_lookups_.size() < speculative_lookup_limit_) {
     const GURL url(work_queue_.Pop());
     UrlInfo* info = &results_[url];
     DCHECK(info->HasUrl(url));
@@ -992,6 +1088,7 @@ void Predictor::StartSomeQueuedResolutions() {
     }
 
     LookupRequest* request = new LookupRequest(this, host_resolver_, url);
+    ++speculative_lookups_;
     int status = request->Start();
     if (status == net::ERR_IO_PENDING) {
       // Will complete asynchronously.
@@ -1052,12 +1149,75 @@ void Predictor::IncrementalTrimReferrers(bool trim_all_now) {
     urls_being_trimmed_.pop_back();
     if (it == referrers_.end())
       continue;  // Defensive code: It got trimmed away already.
-    if (!it->second.Trim(kReferrerTrimRatio, kDiscardableExpectedValue))
+    referrer_edge_count_ -= it->second.size();
+    if (it->second.Trim(kReferrerTrimRatio, kDiscardableExpectedValue))
+      referrer_edge_count_ += it->second.size();
+    else
       referrers_.erase(it);
   }
   PostIncrementalTrimTask();
 }
 
+void Predictor::CountReferrerEdges() {
+  referrer_edge_count_ = 0;
+  for (Referrers::const_iterator it = referrers_.begin();
+       it != referrers_.end(); ++it)
+    referrer_edge_count_ += it->second.size();
+}
+
+void Predictor::EvictReferrerEdgesIfNeeded() {
+  if (referrer_edge_count_ <= max_referrer_edges_)
+    return;
+
+  // Evict down to 7/8 of the budget, so that the scan below runs at most once
+  // per max_referrer_edges_ / 8 newly learned edges.
+  size_t target_count = max_referrer_edges_ - max_referrer_edges_ / 8;
+  size_t evict_count = referrer_edge_count_ - target_count;
+
+  // Find the use rate at or below which edges will be evicted.
+  std::vector<double> rates;
+  rates.reserve(referrer_edge_count_);
+  for (Referrers::const_iterator it = referrers_.begin();
+       it != referrers_.end(); ++it) {
+    for (SubresourceMap::const_iterator sub = it->second.begin();
+         sub != it->second.end(); ++sub)
+      rates.push_back(sub->second.subresource_use_rate());
+  }
+  std::nth_element(rates.begin(), rates.begin() + evict_count - 1,
+                   rates.end());
+  const double cutoff_rate = rates[evict_count - 1];
+  // Edges strictly below the cutoff all go; ties at the cutoff go only until
+  // |evict_count| edges have been removed.
+  size_t ties_to_evict = evict_count;
+  for (size_t i = 0; i < evict_count - 1; ++i) {
+    if (rates[i] < cutoff_rate)
+      --ties_to_evict;
+  }
+
+  Referrers::iterator it = referrers_.begin();
+  while (it != referrers_.end()) {
+    Referrer* referrer = &it->second;
+    SubresourceMap::iterator sub = referrer->begin();
+    while (sub != referrer->end()) {
+      double rate = sub->second.subresource_use_rate();
+      if (rate < cutoff_rate || (rate == cutoff_rate && ties_to_evict > 0)) {
+        if (rate == cutoff_rate)
+          --ties_to_evict;
+        referrer->erase(sub++);
+        --referrer_edge_count_;
+      } else {
+        ++sub;
+      }
+    }
+    if (referrer->empty())
+      referrers_.erase(it++);
+    else
+      ++it;
+  }
+  DCHECK_EQ(target_count, referrer_edge_count_);
+  UMA_HISTOGRAM_COUNTS("Net.PredictionReferrerEdgesEvicted", evict_count);
+}
+
 // ---------------------- End IO methods. -------------------------------------
 
 //-----------------------------------------------------------------------------
@@ -1070,30 +1230,53 @@ Predictor::HostNameQueue::~HostNameQueue() {
 
 void Predictor::HostNameQueue::Push(const GURL& url,
     UrlInfo::ResolutionMotivation motivation) {
+  QueueType type;
   switch (motivation) {
     case UrlInfo::STATIC_REFERAL_MOTIVATED:
     case UrlInfo::LEARNED_REFERAL_MOTIVATED:
     case UrlInfo::MOUSE_OVER_MOTIVATED:
-      rush_queue_.push(url);
+      type = RUSH_QUEUE;
       break;
 
     default:
-      background_queue_.push(url);
+      type = BACKGROUND_QUEUE;
       break;
   }
+
+  std::pair<QueuedNames::iterator, bool> result =
+      queued_names_.insert(std::make_pair(url.spec(), type));
+  if (!result.second) {
+    // Already queued.  Only a promotion to the rush queue changes anything.
+    if (type != RUSH_QUEUE || result.first->second == RUSH_QUEUE)
+      return;
+    result.first->second = RUSH_QUEUE;
+  }
+
+  if (type == RUSH_QUEUE)
+    rush_queue_.push(url);
+  else
+    background_queue_.push(url);
 }
 
 bool Predictor::HostNameQueue::IsEmpty() const {
-  return rush_queue_.empty() && background_queue_.empty();
+  return queued_names_.empty();
 }
 
 GURL Predictor::HostNameQueue::Pop() {
   DCHECK(!IsEmpty());
-  std::queue<GURL> *queue(rush_queue_.empty() ? &background_queue_
-                                              : &rush_queue_);
-  GURL url(queue->front());
-  queue->pop();
-  return url;
+  while (true) {
+    QueueType type = rush_queue_.empty() ? BACKGROUND_QUEUE : RUSH_QUEUE;
+    std::queue<GURL>* queue(type == RUSH_QUEUE ? &rush_queue_
+                                               : &background_queue_);
+    GURL url(queue->front());
+    queue->pop();
+    QueuedNames::iterator it = queued_names_.find(url.spec());
+    // Skip entries left behind by a promotion, or by an earlier Pop().
+    if (it == queued_names_.end() || it->second != type)
+      continue;
+    queued_names_.erase(it);
+    return url;
+  }
 }
 
 //-----------------------------------------------------------------------------
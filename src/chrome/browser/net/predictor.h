@@ -26,6 +26,7 @@
 #include <vector>
 
 #include "base/gtest_prod_util.h"
+#include "base/hash_tables.h"
 #include "base/memory/scoped_ptr.h"
 #include "base/memory/weak_ptr.h"
 #include "chrome/browser/net/referrer.h"
@@ -69,6 +70,14 @@ class Predictor {
   // we change the format so that we discard old data.
   static const int kPredictorReferrerVersion;
 
+  // The previous, ListValue based, pref format.  It is still read so that
+  // learned referrers survive the switch to the compact format.
+  static const int kPredictorLegacyReferrerVersion;
+
+  // The most subresource edges, summed over all referrers, that we will keep.
+  // Each edge is a few dozen bytes in memory, and is persisted in prefs.
+  static const size_t kMaxReferrerEdges;
+
   // Given that the underlying Chromium resolver defaults to a total maximum of
   // 8 paralell resolutions, we will avoid any chance of starving navigational
   // resolutions by limiting the number of paralell speculative resolutions.
@@ -127,6 +136,10 @@ class Predictor {
 
   static void set_max_parallel_resolves(size_t max_parallel_resolves);
 
+  // Overrides kMaxReferrerEdges, evicting edges right away if needed.
+  void SetMaxReferrerEdgesForTesting(size_t max_referrer_edges);
+  size_t referrer_edge_count() const { return referrer_edge_count_; }
+
   virtual void ShutdownOnUIThread(PrefService* user_prefs);
 
   // ------------- End UI thread methods.
@@ -246,6 +259,10 @@ class Predictor {
     return max_concurrent_dns_lookups_;
   }
   // Used for testing.
+  size_t speculative_lookup_limit() const {
+    return speculative_lookup_limit_;
+  }
+  // Used for testing.
   void SetShutdown(bool shutdown) {
     shutdown_ = shutdown;
   }
@@ -269,6 +286,8 @@ class Predictor {
   FRIEND_TEST_ALL_PREFIXES(PredictorTest, MassiveConcurrentLookupTest);
   FRIEND_TEST_ALL_PREFIXES(PredictorTest, PriorityQueuePushPopTest);
   FRIEND_TEST_ALL_PREFIXES(PredictorTest, PriorityQueueReorderTest);
+  FRIEND_TEST_ALL_PREFIXES(PredictorTest, PriorityQueueDuplicateTest);
+  FRIEND_TEST_ALL_PREFIXES(PredictorTest, AdaptiveLookupLimitTest);
   FRIEND_TEST_ALL_PREFIXES(PredictorTest, ReferrerSerializationTrimTest);
   friend class WaitForResolutionHelper;  // For testing.
 
@@ -292,11 +311,20 @@ class Predictor {
     GURL Pop();
 
    private:
+    enum QueueType { RUSH_QUEUE, BACKGROUND_QUEUE };
+
+    // Maps the spec of each queued name to the queue it will be popped from.
+    // A name is only queued once; pushing it again with a rush motivation
+    // moves it to the rush queue, leaving a stale entry in the background
+    // queue that Pop() skips.
+    typedef base::hash_map<std::string, QueueType> QueuedNames;
+
     // The names in the queue that should be serviced (popped) ASAP.
     std::queue<GURL> rush_queue_;
     // The names in the queue that should only be serviced when rush_queue is
     // empty.
     std::queue<GURL> background_queue_;
+    QueuedNames queued_names_;
 
   DISALLOW_COPY_AND_ASSIGN(HostNameQueue);
   };
@@ -333,11 +361,6 @@ class Predictor {
     static const size_t kStartupResolutionCount = 10;
   };
 
-  // A map that is keyed with the host/port that we've learned were the cause
-  // of loading additional URLs.  The list of additional targets is held
-  // in a Referrer instance, which is a value in this map.
-  typedef std::map<GURL, Referrer> Referrers;
-
   // Depending on the expected_subresource_use_, we may either make a TCP/IP
   // preconnection, or merely pre-resolve the hostname via DNS (or even do
   // nothing).  The following are the threasholds for taking those actions.
@@ -380,6 +403,15 @@ class Predictor {
   // Only for testing;
   size_t peak_pending_lookups() const { return peak_pending_lookups_; }
 
+  // Speculative lookup accounting, shown in about:dns.  A hit is a lookup
+  // whose host a navigation later needed, and a wasted lookup is one whose
+  // result expired before anything used it.
+  int64 speculative_lookups() const { return speculative_lookups_; }
+  int64 speculative_lookup_hits() const { return speculative_lookup_hits_; }
+  int64 wasted_speculative_lookups() const {
+    return wasted_speculative_lookups_;
+  }
+
   // ------------- Start IO thread methods.
 
   // Perform actual resolution or preconnection to subresources now.  This is
@@ -400,6 +432,18 @@ class Predictor {
   UrlInfo* AppendToResolutionQueue(const GURL& url,
       UrlInfo::ResolutionMotivation motivation);
 
+  // Like AppendToResolutionQueue(), but doesn't start any resolutions, so
+  // that a batch of names can be queued (and prioritized) before the first
+  // of them is handed to the resolver.
+  UrlInfo* QueueForResolution(const GURL& url,
+                              UrlInfo::ResolutionMotivation motivation);
+
+  // Folds the duration of a completed asynchronous lookup into
+  // smoothed_resolve_duration_, and scales speculative_lookup_limit_ so that
+  // a slow (probably congested) resolver gets fewer concurrent speculative
+  // lookups.
+  void AdjustSpeculativeLookupLimit(base::TimeDelta resolve_duration);
+
   // Check to see if too much queuing delay has been noted for the given info,
   // which indicates that there is "congestion" or growing delay in handling the
   // resolution of names.  Rather than letting this congestion potentially grow
@@ -422,6 +466,15 @@ class Predictor {
   // series of short tasks by posting continuations again an again until done.
   void TrimReferrers();
 
+  // Recomputes referrer_edge_count_ from scratch, after referrers_ has been
+  // changed wholesale.
+  void CountReferrerEdges();
+
+  // If referrers_ holds more than max_referrer_edges_ edges, discards the
+  // ones with the lowest expected use until it is comfortably under budget.
+  // Evicting in batches keeps the cost per learned edge constant.
+  void EvictReferrerEdgesIfNeeded();
+
   // Loads urls_being_trimmed_ from keys of current referrers_.
   void LoadUrlsForTrimming();
 
@@ -465,6 +518,18 @@ class Predictor {
   // sub-resource speculation, and retard resolutions suggested by page scans.
   const size_t max_concurrent_dns_lookups_;
 
+  // The number of concurrent speculative lookups allowed right now.  Starts
+  // at max_concurrent_dns_lookups_, and shrinks towards one while resolutions
+  // are taking longer than expected.
+  size_t speculative_lookup_limit_;
+
+  // Exponentially weighted moving average of asynchronous lookup durations.
+  base::TimeDelta smoothed_resolve_duration_;
+
+  int64 speculative_lookups_;
+  int64 speculative_lookup_hits_;
+  int64 wasted_speculative_lookups_;
+
   // The maximum queueing delay that is acceptable before we enter congestion
   // reduction mode, and discard all queued (but not yet assigned) resolutions.
   const base::TimeDelta max_dns_queue_delay_;
@@ -495,6 +560,10 @@ class Predictor {
   // orginial hostname.
   Referrers referrers_;
 
+  // Total number of subresource edges in referrers_, and the most we keep.
+  size_t referrer_edge_count_;
+  size_t max_referrer_edges_;
+
   // List of URLs in referrers_ currently being trimmed (scaled down to
   // eventually be aged out of use).
   std::vector<GURL> urls_being_trimmed_;
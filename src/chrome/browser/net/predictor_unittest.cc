@@ -10,6 +10,7 @@
 
 #include "base/memory/scoped_ptr.h"
 #include "base/message_loop.h"
+#include "base/stringprintf.h"
 #include "base/strings/string_number_conversions.h"
 #include "base/timer.h"
 #include "base/values.h"
@@ -160,6 +161,8 @@ TEST_F(PredictorTest, SingleLookupTest) {
 
   MessageLoop::current()->RunUntilIdle();
 
+  // The flood of duplicates only caused one lookup.
+  EXPECT_EQ(1, testing_master.speculative_lookups());
   EXPECT_GT(testing_master.peak_pending_lookups(), names.size() / 2);
   EXPECT_LE(testing_master.peak_pending_lookups(), names.size());
   EXPECT_LE(testing_master.peak_pending_lookups(),
@@ -243,7 +246,9 @@ TEST_F(PredictorTest, MassiveConcurrentLookupTest) {
 
 //------------------------------------------------------------------------------
 // Functions to help synthesize and test serializations of subresource referrer
-// lists.
+// lists.  Input lists are synthesized in the legacy ListValue format, which
+// DeserializeReferrers() still accepts; serialized output is decoded with
+// DecodeReferrers().
 
 // Return a motivation_list if we can find one for the given motivating_host (or
 // NULL if a match is not found).
@@ -253,7 +258,7 @@ static const ListValue* FindSerializationMotivation(
   CHECK_LT(0u, referral_list->GetSize());  // Room for version.
   int format_version = -1;
   CHECK(referral_list->GetInteger(0, &format_version));
-  CHECK_EQ(Predictor::kPredictorReferrerVersion, format_version);
+  CHECK_EQ(Predictor::kPredictorLegacyReferrerVersion, format_version);
   const ListValue* motivation_list(NULL);
   for (size_t i = 1; i < referral_list->GetSize(); ++i) {
     referral_list->GetList(i, &motivation_list);
@@ -275,7 +280,7 @@ static ListValue* FindSerializationMotivation(const GURL& motivation,
 static ListValue* NewEmptySerializationList() {
   base::ListValue* list = new base::ListValue;
   list->Append(
-      new base::FundamentalValue(Predictor::kPredictorReferrerVersion));
+      new base::FundamentalValue(Predictor::kPredictorLegacyReferrerVersion));
   return list;
 }
 
@@ -322,21 +327,23 @@ static bool GetDataFromSerialization(const GURL& motivation,
                                      const GURL& subresource,
                                      const ListValue& referral_list,
                                      double* use_rate) {
-  const ListValue* motivation_list =
-      FindSerializationMotivation(motivation, &referral_list);
-  if (!motivation_list)
+  int format_version = -1;
+  CHECK(referral_list.GetInteger(0, &format_version));
+  CHECK_EQ(Predictor::kPredictorReferrerVersion, format_version);
+  std::string encoded;
+  if (!referral_list.GetString(1, &encoded))
     return false;
-  const ListValue* subresource_list;
-  EXPECT_TRUE(motivation_list->GetList(1, &subresource_list));
-  for (size_t i = 0; i < subresource_list->GetSize();) {
-    std::string url_spec;
-    EXPECT_TRUE(subresource_list->GetString(i++, &url_spec));
-    EXPECT_TRUE(subresource_list->GetDouble(i++, use_rate));
-    if (subresource == GURL(url_spec)) {
-      return true;
-    }
-  }
-  return false;
+  Referrers referrers;
+  EXPECT_TRUE(DecodeReferrers(encoded, &referrers));
+  Referrers::const_iterator it = referrers.find(motivation);
+  if (it == referrers.end())
+    return false;
+  SubresourceMap::const_iterator subresource_it =
+      it->second.find(subresource);
+  if (subresource_it == it->second.end())
+    return false;
+  *use_rate = subresource_it->second.subresource_use_rate();
+  return true;
 }
 
 //------------------------------------------------------------------------------
@@ -599,7 +606,7 @@ TEST_F(PredictorTest, PriorityQueueReorderTest) {
   queue.Push(low3, UrlInfo::LINKED_MAX_MOTIVATED);
   queue.Push(low4, UrlInfo::OMNIBOX_MOTIVATED);
   queue.Push(low5, UrlInfo::STARTUP_LIST_MOTIVATED);
-  queue.Push(low4, UrlInfo::OMNIBOX_MOTIVATED);
+  queue.Push(low4, UrlInfo::OMNIBOX_MOTIVATED);  // Duplicate is dropped.
 
   // Push all the high prority items
   queue.Push(hi1, UrlInfo::LEARNED_REFERAL_MOTIVATED);
@@ -617,11 +624,62 @@ TEST_F(PredictorTest, PriorityQueueReorderTest) {
   EXPECT_EQ(queue.Pop(), low3);
   EXPECT_EQ(queue.Pop(), low4);
   EXPECT_EQ(queue.Pop(), low5);
-  EXPECT_EQ(queue.Pop(), low4);
 
   EXPECT_TRUE(queue.IsEmpty());
 }
 
+TEST_F(PredictorTest, PriorityQueueDuplicateTest) {
+  Predictor::HostNameQueue queue;
+
+  GURL low1("http://low1:80"),
+      low2("http://low2:80"),
+      hi1("http://hi1:80");
+
+  queue.Push(low1, UrlInfo::PAGE_SCAN_MOTIVATED);
+  queue.Push(low2, UrlInfo::PAGE_SCAN_MOTIVATED);
+  queue.Push(hi1, UrlInfo::MOUSE_OVER_MOTIVATED);
+  // Duplicates at the same or lower priority are dropped.
+  queue.Push(hi1, UrlInfo::PAGE_SCAN_MOTIVATED);
+  queue.Push(hi1, UrlInfo::LEARNED_REFERAL_MOTIVATED);
+  queue.Push(low1, UrlInfo::OMNIBOX_MOTIVATED);
+  // A higher priority duplicate moves the name to the rush queue.
+  queue.Push(low2, UrlInfo::LEARNED_REFERAL_MOTIVATED);
+
+  EXPECT_EQ(queue.Pop(), hi1);
+  EXPECT_EQ(queue.Pop(), low2);
+  EXPECT_EQ(queue.Pop(), low1);
+  EXPECT_TRUE(queue.IsEmpty());
+
+  // Once popped, a name can be queued again.
+  queue.Push(low2, UrlInfo::PAGE_SCAN_MOTIVATED);
+  EXPECT_FALSE(queue.IsEmpty());
+  EXPECT_EQ(queue.Pop(), low2);
+  EXPECT_TRUE(queue.IsEmpty());
+}
+
+TEST_F(PredictorTest, AdaptiveLookupLimitTest) {
+  Predictor predictor(true);
+  const size_t max_lookups = predictor.max_concurrent_dns_lookups();
+  EXPECT_EQ(max_lookups, predictor.speculative_lookup_limit());
+
+  // Fast lookups leave the full limit in place.
+  for (int i = 0; i < 20; ++i)
+    predictor.AdjustSpeculativeLookupLimit(TimeDelta::FromMilliseconds(20));
+  EXPECT_EQ(max_lookups, predictor.speculative_lookup_limit());
+
+  // Consistently slow lookups throttle us down to a single lookup.
+  for (int i = 0; i < 50; ++i)
+    predictor.AdjustSpeculativeLookupLimit(TimeDelta::FromSeconds(10));
+  EXPECT_EQ(1U, predictor.speculative_lookup_limit());
+
+  // ...and we recover once the resolver speeds up again.
+  for (int i = 0; i < 50; ++i)
+    predictor.AdjustSpeculativeLookupLimit(TimeDelta::FromMilliseconds(20));
+  EXPECT_EQ(max_lookups, predictor.speculative_lookup_limit());
+
+  predictor.Shutdown();
+}
+
 TEST_F(PredictorTest, CanonicalizeUrl) {
   // Base case, only handles HTTP and HTTPS.
   EXPECT_EQ(GURL(), Predictor::CanonicalizeUrl(GURL("ftp://anything")));
@@ -660,6 +718,107 @@ TEST_F(PredictorTest, CanonicalizeUrl) {
             long_https.GetWithEmptyPath());
 }
 
+// Make sure a serialization in the compact format can be read back in, and
+// that hosts shared between referrers survive the trip.
+TEST_F(PredictorTest, ReferrerSerializationRoundTripTest) {
+  Predictor predictor(true);
+  predictor.SetHostResolver(host_resolver_.get());
+  const GURL motivation_a("http://a.com/");
+  const GURL motivation_b("http://b.com/");
+  const GURL shared("http://static.cdn.com/");
+  const GURL only_b("http://ads.b.com/");
+
+  scoped_ptr<ListValue> referral_list(NewEmptySerializationList());
+  AddToSerializedList(motivation_a, shared, 3.5, referral_list.get());
+  AddToSerializedList(motivation_b, shared, 1.25, referral_list.get());
+  AddToSerializedList(motivation_b, only_b, 0.5, referral_list.get());
+  AddToSerializedList(shared, motivation_a, 0.75, referral_list.get());
+  predictor.DeserializeReferrers(*referral_list.get());
+  EXPECT_EQ(4U, predictor.referrer_edge_count());
+
+  ListValue compact_list;
+  predictor.SerializeReferrers(&compact_list);
+  ASSERT_EQ(2U, compact_list.GetSize());
+
+  Predictor restored(true);
+  restored.SetHostResolver(host_resolver_.get());
+  restored.DeserializeReferrers(compact_list);
+  EXPECT_EQ(4U, restored.referrer_edge_count());
+
+  ListValue restored_list;
+  restored.SerializeReferrers(&restored_list);
+  double rate;
+  EXPECT_TRUE(GetDataFromSerialization(
+      motivation_a, shared, restored_list, &rate));
+  EXPECT_EQ(3.5, rate);
+  EXPECT_TRUE(GetDataFromSerialization(
+      motivation_b, shared, restored_list, &rate));
+  EXPECT_EQ(1.25, rate);
+  EXPECT_TRUE(GetDataFromSerialization(
+      motivation_b, only_b, restored_list, &rate));
+  EXPECT_EQ(0.5, rate);
+  EXPECT_TRUE(GetDataFromSerialization(
+      shared, motivation_a, restored_list, &rate));
+  EXPECT_EQ(0.75, rate);
+  EXPECT_FALSE(GetDataFromSerialization(
+      motivation_a, only_b, restored_list, &rate));
+
+  // A corrupt blob is ignored rather than crashing.
+  ListValue corrupt_list;
+  corrupt_list.Append(
+      new base::FundamentalValue(Predictor::kPredictorReferrerVersion));
+  corrupt_list.Append(new base::StringValue("not a pickle"));
+  Predictor corrupt(true);
+  corrupt.SetHostResolver(host_resolver_.get());
+  corrupt.DeserializeReferrers(corrupt_list);
+  EXPECT_EQ(0U, corrupt.referrer_edge_count());
+
+  predictor.Shutdown();
+  restored.Shutdown();
+  corrupt.Shutdown();
+}
+
+// Make sure that once the edge budget is exceeded, the least used edges are
+// evicted first, and referrers left without edges are dropped.
+TEST_F(PredictorTest, ReferrerEdgeBudgetTest) {
+  Predictor predictor(true);
+  predictor.SetHostResolver(host_resolver_.get());
+
+  scoped_ptr<ListValue> referral_list(NewEmptySerializationList());
+  for (int i = 0; i < 16; ++i) {
+    GURL motivation(base::StringPrintf("http://r%d.com/", i / 4));
+    GURL subresource(base::StringPrintf("http://s%d.com/", i));
+    AddToSerializedList(motivation, subresource, 1.0 + i, referral_list.get());
+  }
+  predictor.DeserializeReferrers(*referral_list.get());
+  EXPECT_EQ(16U, predictor.referrer_edge_count());
+
+  // Evicts down to 7/8 of the budget: the 9 least used edges go.
+  predictor.SetMaxReferrerEdgesForTesting(8);
+  EXPECT_EQ(7U, predictor.referrer_edge_count());
+
+  ListValue recovered_referral_list;
+  predictor.SerializeReferrers(&recovered_referral_list);
+  double rate;
+  for (int i = 0; i < 16; ++i) {
+    GURL motivation(base::StringPrintf("http://r%d.com/", i / 4));
+    GURL subresource(base::StringPrintf("http://s%d.com/", i));
+    EXPECT_EQ(i >= 9, GetDataFromSerialization(
+        motivation, subresource, recovered_referral_list, &rate)) << i;
+  }
+
+  // Learning a new edge pushes us over budget again.
+  predictor.LearnFromNavigation(GURL("http://r0.com/"), GURL("http://x.com/"));
+  EXPECT_EQ(8U, predictor.referrer_edge_count());
+  predictor.LearnFromNavigation(GURL("http://r1.com/"), GURL("http://y.com/"));
+  EXPECT_EQ(7U, predictor.referrer_edge_count());
+
+  predictor.DiscardAllResults();
+  EXPECT_EQ(0U, predictor.referrer_edge_count());
+
+  predictor.Shutdown();
+}
+
 TEST_F(PredictorTest, DiscardPredictorResults) {
   Predictor predictor(true);
   predictor.SetHostResolver(host_resolver_.get());
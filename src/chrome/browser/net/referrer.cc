@@ -6,9 +6,14 @@
 
 #include <limits.h>
 
+#include <algorithm>
+#include <vector>
+
+#include "base/base64.h"
 #include "base/compiler_specific.h"
 #include "base/logging.h"
 #include "base/message_loop.h"
+#include "base/pickle.h"
 #include "base/values.h"
 #include "chrome/browser/net/predictor.h"
 
@@ -139,11 +144,17 @@ void Referrer::Deserialize(const Value& value) {
     // of how best to optimize the learning and pruning (Trim) algorithm at this
     // level, so for now, we just suggest subresources, which leaves them all
     // with the same birth date (typically start of process).
-    SuggestHost(url);
-    (*this)[url].SetSubresourceUseRate(rate);
+    RestoreHost(url, rate);
   }
 }
 
+void Referrer::RestoreHost(const GURL& url, double rate) {
+  SuggestHost(url);
+  SubresourceMap::iterator it = find(url);
+  if (it != end())
+    it->second.SetSubresourceUseRate(rate);
+}
+
 Value* Referrer::Serialize() const {
   base::ListValue* subresource_list(new base::ListValue);
   for (const_iterator it = begin(); it != end(); ++it) {
@@ -159,6 +170,93 @@ Value* Referrer::Serialize() const {
 
 //------------------------------------------------------------------------------
 
+void EncodeReferrers(const Referrers& referrers, std::string* output) {
+  // Assign each distinct host an index in order of first appearance.
+  std::map<GURL, uint32> host_indices;
+  std::vector<const GURL*> hosts;
+  for (Referrers::const_iterator it = referrers.begin();
+       it != referrers.end(); ++it) {
+    if (host_indices.insert(std::make_pair(it->first, hosts.size())).second)
+      hosts.push_back(&it->first);
+    for (SubresourceMap::const_iterator sub = it->second.begin();
+         sub != it->second.end(); ++sub) {
+      if (host_indices.insert(std::make_pair(sub->first, hosts.size())).second)
+        hosts.push_back(&sub->first);
+    }
+  }
+
+  Pickle pickle;
+  pickle.WriteUInt32(hosts.size());
+  for (size_t i = 0; i < hosts.size(); ++i)
+    pickle.WriteString(hosts[i]->spec());
+
+  pickle.WriteUInt32(referrers.size());
+  for (Referrers::const_iterator it = referrers.begin();
+       it != referrers.end(); ++it) {
+    pickle.WriteUInt32(host_indices[it->first]);
+    pickle.WriteUInt32(it->second.size());
+    for (SubresourceMap::const_iterator sub = it->second.begin();
+         sub != it->second.end(); ++sub) {
+      pickle.WriteUInt32(host_indices[sub->first]);
+      pickle.WriteInt64(bit_cast<int64>(sub->second.subresource_use_rate()));
+    }
+  }
+
+  base::Base64Encode(
+      base::StringPiece(static_cast<const char*>(pickle.data()),
+                        pickle.size()),
+      output);
+}
+
+bool DecodeReferrers(const std::string& input, Referrers* referrers) {
+  std::string decoded;
+  if (!base::Base64Decode(input, &decoded))
+    return false;
+  Pickle pickle(decoded.data(), decoded.size());
+  PickleIterator iter(pickle);
+
+  uint32 host_count;
+  if (!pickle.ReadUInt32(&iter, &host_count))
+    return false;
+  std::vector<GURL> hosts;
+  // Each spec takes at least a length word, so don't let a corrupt count
+  // reserve more than the input could hold.
+  hosts.reserve(std::min<size_t>(host_count, decoded.size() / sizeof(int)));
+  for (uint32 i = 0; i < host_count; ++i) {
+    std::string spec;
+    if (!pickle.ReadString(&iter, &spec))
+      return false;
+    hosts.push_back(GURL(spec));
+  }
+
+  uint32 referrer_count;
+  if (!pickle.ReadUInt32(&iter, &referrer_count))
+    return false;
+  for (uint32 i = 0; i < referrer_count; ++i) {
+    uint32 referrer_index;
+    uint32 edge_count;
+    if (!pickle.ReadUInt32(&iter, &referrer_index) ||
+        referrer_index >= hosts.size() ||
+        !pickle.ReadUInt32(&iter, &edge_count)) {
+      return false;
+    }
+    for (uint32 j = 0; j < edge_count; ++j) {
+      uint32 subresource_index;
+      int64 rate_bits;
+      if (!pickle.ReadUInt32(&iter, &subresource_index) ||
+          subresource_index >= hosts.size() ||
+          !pickle.ReadInt64(&iter, &rate_bits)) {
+        return false;
+      }
+      (*referrers)[hosts[referrer_index]].RestoreHost(
+          hosts[subresource_index], bit_cast<double>(rate_bits));
+    }
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
 ReferrerValue::ReferrerValue()
     : birth_time_(base::Time::Now()),
       navigation_count_(0),
@@ -16,6 +16,7 @@
 #define CHROME_BROWSER_NET_REFERRER_H_
 
 #include <map>
+#include <string>
 
 #include "base/basictypes.h"
 #include "base/time.h"
@@ -114,6 +115,9 @@ class Referrer : public SubresourceMap {
   // Returns true if expected use rate is greater than the threshold.
   bool Trim(double reduce_rate, double threshold);
 
+  // Restore a persisted subresource |url| with its learned use |rate|.
+  void RestoreHost(const GURL& url, double rate);
+
   // Provide methods for persisting, and restoring contents into a Value class.
   base::Value* Serialize() const;
   void Deserialize(const base::Value& referrers);
@@ -137,6 +141,23 @@ class Referrer : public SubresourceMap {
   // avoid deep copies during re-alloc of the containing map.
 };
 
+//------------------------------------------------------------------------------
+// A map that is keyed with the host/port that we've learned were the cause
+// of loading additional URLs.  The list of additional targets is held
+// in a Referrer instance, which is a value in this map.
+typedef std::map<GURL, Referrer> Referrers;
+
+// Encodes |referrers| into |output| in a compact binary form suitable for
+// storing in a pref.  Every distinct host is written once, and each referrer
+// and subresource edge names its hosts by index into that table, so a host
+// that appears under many referrers costs only a few bytes per appearance.
+void EncodeReferrers(const Referrers& referrers, std::string* output);
+
+// Decodes the output of EncodeReferrers() and merges its edges into
+// |referrers|.  Returns false if |input| is malformed, in which case any
+// edges decoded before the error was found are kept.
+bool DecodeReferrers(const std::string& input, Referrers* referrers);
+
 }  // namespace chrome_browser_net
 
 #endif  // CHROME_BROWSER_NET_REFERRER_H_
@@ -73,7 +73,8 @@ UrlInfo::UrlInfo()
       queue_duration_(NullDuration()),
       sequence_number_(0),
       motivation_(NO_PREFETCH_MOTIVATION),
-      was_linked_(false) {
+      was_linked_(false),
+      was_used_(false) {
 }
 
 UrlInfo::~UrlInfo() {}
@@ -155,6 +156,7 @@ void UrlInfo::SetPendingDeleteState() {
 void UrlInfo::SetFoundState() {
   DCHECK(ASSIGNED == state_);
   state_ = FOUND;
+  was_used_ = false;
   resolve_duration_ = GetDuration();
   const TimeDelta max_duration = MaxNonNetworkDnsLookupDuration();
   if (max_duration <= resolve_duration_) {
@@ -168,6 +170,7 @@ void UrlInfo::SetFoundState() {
 void UrlInfo::SetNoSuchNameState() {
   DCHECK(ASSIGNED == state_);
   state_ = NO_SUCH_NAME;
+  was_used_ = false;
   resolve_duration_ = GetDuration();
   if (MaxNonNetworkDnsLookupDuration() <= resolve_duration_) {
     DHISTOGRAM_TIMES("DNS.PrefetchNotFoundName", resolve_duration_);
@@ -176,6 +179,13 @@ void UrlInfo::SetNoSuchNameState() {
   DLogResultsStats("DNS PrefetchNotFound");
 }
 
+bool UrlInfo::MarkUsed() {
+  if (was_used_)
+    return false;
+  was_used_ = true;
+  return true;
+}
+
 void UrlInfo::SetUrl(const GURL& url) {
   if (url_.is_empty())  // Not yet initialized.
     url_ = url;
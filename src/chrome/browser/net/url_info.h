@@ -99,6 +99,12 @@ class UrlInfo {
 
   bool was_linked() const { return was_linked_; }
 
+  // Records that a navigation needed this host.  Returns true only for the
+  // first such use since the host was last resolved, so that each lookup is
+  // credited at most once.
+  bool MarkUsed();
+  bool was_used() const { return was_used_; }
+
   GURL referring_url() const { return referring_url_; }
   void SetReferringHostname(const GURL& url) {
     referring_url_ = url;
@@ -106,6 +112,7 @@ class UrlInfo {
 
   bool was_found() const { return FOUND == state_; }
   bool was_nonexistent() const { return NO_SUCH_NAME == state_; }
+  bool is_queued() const { return QUEUED == state_; }
   bool is_assigned() const {
     return ASSIGNED == state_ || ASSIGNED_BUT_MARKED == state_;
   }
@@ -173,6 +180,9 @@ class UrlInfo {
   // Record if the motivation for prefetching was ever a page-link-scan.
   bool was_linked_;
 
+  // Whether a navigation has needed this host since it was last resolved.
+  bool was_used_;
+
   // If this instance holds data about a navigation, we store the referrer.
   // If this instance hold data about a prefetch, and the prefetch was
   // instigated by a referrer, we store it here (for use in about:dns).
@@ -25,6 +25,7 @@
 #include "base/strings/string_number_conversions.h"
 #include "base/strings/string_piece.h"
 #include "base/strings/string_split.h"
+#include "base/synchronization/lock.h"
 #include "base/threading/worker_pool.h"
 #include "base/utf_string_conversions.h"
 #include "base/values.h"
@@ -507,10 +508,11 @@ class NetInternalsMessageHandler
 };
 
 // This class is the "real" message handler. It is allocated and destroyed on
-// the UI thread.  With the exception of OnAddEntry, OnWebUIDeleted, and
-// SendJavascriptCommand, its methods are all expected to be called from the IO
-// thread.  OnAddEntry and SendJavascriptCommand can be called from any thread,
-// and OnWebUIDeleted can only be called from the UI thread.
+// the UI thread.  With the exception of OnAddEntry, AddEntryToQueue,
+// PostPendingEntries, OnWebUIDeleted, and SendJavascriptCommand, its methods
+// are all expected to be called from the IO thread.  OnAddEntry,
+// AddEntryToQueue, PostPendingEntries and SendJavascriptCommand can be called
+// from any thread, and OnWebUIDeleted can only be called from the UI thread.
 class NetInternalsMessageHandler::IOThreadImpl
     : public base::RefCountedThreadSafe<
           NetInternalsMessageHandler::IOThreadImpl,
@@ -609,14 +611,15 @@ class NetInternalsMessageHandler::IOThreadImpl
   virtual ~IOThreadImpl();
 
   // Adds |entry| to the queue of pending log entries to be sent to the page via
-  // Javascript.  Must be called on the IO Thread.  Also creates a delayed task
-  // that will call PostPendingEntries, if there isn't one already.
+  // Javascript.  Can be called from any thread.  Also creates a delayed task
+  // on the UI thread that will call PostPendingEntries, if there isn't one
+  // already, so each batch costs a single posted task.
   void AddEntryToQueue(Value* entry);
 
   // Sends all pending entries to the page via Javascript, and clears the list
   // of pending entries.  Sending multiple entries at once results in a
   // significant reduction of CPU usage when a lot of events are happening.
-  // Must be called on the IO Thread.
+  // Can be called from any thread.
   void PostPendingEntries();
 
   // Adds entries with the states of ongoing URL requests.
@@ -647,9 +650,14 @@ class NetInternalsMessageHandler::IOThreadImpl
   // This is only read and written to on the UI thread.
   bool was_webui_deleted_;
 
+  // Protects |pending_entries_|.  NetLog observers are notified on whichever
+  // thread logged the event, so entries are batched here rather than each
+  // being posted to the IO thread.
+  base::Lock pending_entries_lock_;
+
   // Log entries that have yet to be passed along to Javascript page.  Non-NULL
   // when and only when there is a pending delayed task to call
-  // PostPendingEntries.  Read and written to exclusively on the IO Thread.
+  // PostPendingEntries.  Guarded by |pending_entries_lock_|.
   scoped_ptr<ListValue> pending_entries_;
 
   // Used for getting current status of URLRequests when net-internals is
@@ -1709,9 +1717,7 @@ void NetInternalsMessageHandler::IOThreadImpl::OnSetLogLevel(
 // can be called from ANY THREAD.
 void NetInternalsMessageHandler::IOThreadImpl::OnAddEntry(
     const net::NetLog::Entry& entry) {
-  BrowserThread::PostTask(
-      BrowserThread::IO, FROM_HERE,
-      base::Bind(&IOThreadImpl::AddEntryToQueue, this, entry.ToValue()));
+  AddEntryToQueue(entry.ToValue());
 }
 
 void NetInternalsMessageHandler::IOThreadImpl::OnStartConnectionTestSuite() {
@@ -1769,22 +1775,35 @@ void NetInternalsMessageHandler::IOThreadImpl::SendJavascriptCommand(
   }
 }
 
+// Note that this can be called from ANY THREAD.
 void NetInternalsMessageHandler::IOThreadImpl::AddEntryToQueue(Value* entry) {
-  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
+  base::AutoLock lock(pending_entries_lock_);
   if (!pending_entries_.get()) {
     pending_entries_.reset(new ListValue());
-    BrowserThread::PostDelayedTask(
-        BrowserThread::IO, FROM_HERE,
-        base::Bind(&IOThreadImpl::PostPendingEntries, this),
-        base::TimeDelta::FromMilliseconds(kNetLogEventDelayMilliseconds));
+    // The batch is flushed from the UI thread, where it has to end up anyway,
+    // so the IO thread does no work on behalf of the page's event log.
+    if (!BrowserThread::PostDelayedTask(
+            BrowserThread::UI, FROM_HERE,
+            base::Bind(&IOThreadImpl::PostPendingEntries, this),
+            base::TimeDelta::FromMilliseconds(kNetLogEventDelayMilliseconds))) {
+      // Nothing would ever flush the batch, so don't start one.
+      pending_entries_.reset();
+      delete entry;
+      return;
+    }
   }
   pending_entries_->Append(entry);
 }
 
+// Note that this can be called from ANY THREAD.
 void NetInternalsMessageHandler::IOThreadImpl::PostPendingEntries() {
-  DCHECK(BrowserThread::CurrentlyOn(BrowserThread::IO));
-  if (pending_entries_.get())
-    SendJavascriptCommand("receivedLogEntries", pending_entries_.release());
+  scoped_ptr<ListValue> entries;
+  {
+    base::AutoLock lock(pending_entries_lock_);
+    entries.reset(pending_entries_.release());
+  }
+  if (entries.get())
+    SendJavascriptCommand("receivedLogEntries", entries.release());
 }
 
 void NetInternalsMessageHandler::IOThreadImpl::PrePopulateEventList() {
@@ -1832,9 +1851,8 @@ void NetInternalsMessageHandler::IOThreadImpl::PrePopulateEventList() {
                              &callback,
                              request->net_log().GetLogLevel());
 
-    // Have to add |entry| to the queue synchronously, as there may already
-    // be posted tasks queued up to add other events for |request|, which we
-    // want |entry| to precede.
+    // Entries are queued in the order they are logged, so any events for
+    // |request| logged after this point will follow |entry|.
     AddEntryToQueue(entry.ToValue());
   }
 }
@@ -4,13 +4,19 @@
 
 #include "net/base/directory_lister.h"
 
+#include <stdio.h>
+
 #include <algorithm>
+#include <queue>
 #include <vector>
 
 #include "base/bind.h"
 #include "base/file_util.h"
 #include "base/i18n/file_util_icu.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/memory/scoped_vector.h"
 #include "base/message_loop.h"
+#include "base/pickle.h"
 #include "base/threading/thread_restrictions.h"
 #include "base/threading/worker_pool.h"
 #include "net/base/net_errors.h"
@@ -19,7 +25,12 @@ namespace net {
 
 namespace {
 
-const int kFilesPerEvent = 8;
+// Number of entries sent to the origin thread at a time.
+const size_t kFilesPerEvent = 128;
+
+// Sorted listings hold at most this many entries in memory.  Larger listings
+// are sorted in runs of this size, spilled to temporary files, and merged.
+const size_t kDefaultMaxEntriesInMemory = 50000;
 
 bool IsDotDot(const base::FilePath& path) {
   return FILE_PATH_LITERAL("..") == path.BaseName().value();
@@ -82,22 +93,152 @@ bool CompareFullPath(const DirectoryLister::DirectoryListerData& a,
   return file_util::LocaleAwareCompareFilenames(a.path, b.path);
 }
 
-void SortData(std::vector<DirectoryLister::DirectoryListerData>* data,
-              DirectoryLister::SortType sort_type) {
-  // Sort the results. See the TODO below (this sort should be removed and we
-  // should do it from JS).
-  if (sort_type == DirectoryLister::DATE)
-    std::sort(data->begin(), data->end(), CompareDate);
-  else if (sort_type == DirectoryLister::FULL_PATH)
-    std::sort(data->begin(), data->end(), CompareFullPath);
-  else if (sort_type == DirectoryLister::ALPHA_DIRS_FIRST)
-    std::sort(data->begin(), data->end(), CompareAlphaDirsFirst);
-  else
-    DCHECK_EQ(DirectoryLister::NO_SORT, sort_type);
+typedef bool (*CompareFunction)(const DirectoryLister::DirectoryListerData&,
+                                const DirectoryLister::DirectoryListerData&);
+
+// Returns the comparator for |sort_type|, or NULL if entries aren't sorted.
+CompareFunction GetCompareFunction(DirectoryLister::SortType sort_type) {
+  // See the TODO in StartInternal (sorting should be done from JS).
+  switch (sort_type) {
+    case DirectoryLister::DATE:
+      return CompareDate;
+    case DirectoryLister::FULL_PATH:
+      return CompareFullPath;
+    case DirectoryLister::ALPHA_DIRS_FIRST:
+      return CompareAlphaDirsFirst;
+    case DirectoryLister::NO_SORT:
+      return NULL;
+  }
+  NOTREACHED();
+  return NULL;
 }
 
+void WriteEntry(const DirectoryLister::DirectoryListerData& data,
+                Pickle* pickle) {
+#if defined(OS_POSIX)
+  pickle->WriteData(reinterpret_cast<const char*>(&data.info.stat),
+                    sizeof(data.info.stat));
+  pickle->WriteString(data.info.filename);
+#elif defined(OS_WIN)
+  pickle->WriteData(reinterpret_cast<const char*>(&data.info),
+                    sizeof(data.info));
+#endif
+  data.path.WriteToPickle(pickle);
+}
+
+bool ReadEntry(const Pickle& pickle,
+               PickleIterator* iter,
+               DirectoryLister::DirectoryListerData* data) {
+  const char* info;
+  int info_length;
+#if defined(OS_POSIX)
+  if (!pickle.ReadData(iter, &info, &info_length) ||
+      info_length != sizeof(data->info.stat)) {
+    return false;
+  }
+  memcpy(&data->info.stat, info, sizeof(data->info.stat));
+  if (!pickle.ReadString(iter, &data->info.filename))
+    return false;
+#elif defined(OS_WIN)
+  if (!pickle.ReadData(iter, &info, &info_length) ||
+      info_length != sizeof(data->info)) {
+    return false;
+  }
+  memcpy(&data->info, info, sizeof(data->info));
+#endif
+  return data->path.ReadFromPickle(iter);
+}
+
+// Orders run indices so that a std::priority_queue yields the run whose next
+// entry sorts first.
+class RunHeadGreater {
+ public:
+  RunHeadGreater(
+      CompareFunction compare,
+      const std::vector<DirectoryLister::DirectoryListerData>* heads)
+      : compare_(compare),
+        heads_(heads) {
+  }
+
+  bool operator()(size_t a, size_t b) const {
+    return compare_((*heads_)[b], (*heads_)[a]);
+  }
+
+ private:
+  CompareFunction compare_;
+  const std::vector<DirectoryLister::DirectoryListerData>* heads_;
+};
+
 }  // namespace
 
+// A sorted run of entries spilled to a temporary file, read back in order
+// while merging.
+class DirectoryLister::Core::SortedRun {
+ public:
+  ~SortedRun() {
+    file_util::CloseFile(file_);
+    file_util::Delete(path_, false);
+  }
+
+  // Writes |data|, which must already be sorted, to a new temporary file.
+  // Returns NULL on failure.
+  static SortedRun* Create(
+      const std::vector<DirectoryLister::DirectoryListerData>& data) {
+    base::FilePath path;
+    FILE* file = file_util::CreateAndOpenTemporaryFile(&path);
+    if (!file)
+      return NULL;
+    scoped_ptr<SortedRun> run(new SortedRun(file, path));
+    for (size_t i = 0; i < data.size(); ++i) {
+      Pickle pickle;
+      WriteEntry(data[i], &pickle);
+      uint32 size = pickle.size();
+      if (fwrite(&size, sizeof(size), 1, file) != 1 ||
+          fwrite(pickle.data(), size, 1, file) != 1) {
+        return NULL;
+      }
+    }
+    if (fseek(file, 0, SEEK_SET) != 0)
+      return NULL;
+    return run.release();
+  }
+
+  // Reads the next entry into |data|.  Returns false at the end of the run,
+  // or if it couldn't be read back, in which case failed() is true.
+  bool ReadNext(DirectoryLister::DirectoryListerData* data) {
+    uint32 size;
+    if (fread(&size, sizeof(size), 1, file_) != 1) {
+      failed_ = !feof(file_);
+      return false;
+    }
+    buffer_.resize(size);
+    if (size == 0 || fread(&buffer_[0], size, 1, file_) != 1) {
+      failed_ = true;
+      return false;
+    }
+    Pickle pickle(&buffer_[0], size);
+    PickleIterator iter(pickle);
+    failed_ = !ReadEntry(pickle, &iter, data);
+    return !failed_;
+  }
+
+  bool failed() const { return failed_; }
+
+ private:
+  SortedRun(FILE* file, const base::FilePath& path)
+      : file_(file),
+        path_(path),
+        failed_(false) {
+  }
+
+  FILE* const file_;
+  const base::FilePath path_;
+  std::vector<char> buffer_;
+  bool failed_;
+
+  DISALLOW_COPY_AND_ASSIGN(SortedRun);
+};
+
 DirectoryLister::DirectoryLister(const base::FilePath& dir,
                                  DirectoryListerDelegate* delegate)
     : core_(new Core(dir, false, ALPHA_DIRS_FIRST, this)),
@@ -128,6 +269,11 @@ void DirectoryLister::Cancel() {
   return core_->Cancel();
 }
 
+void DirectoryLister::set_max_entries_in_memory_for_testing(
+    size_t max_entries) {
+  core_->set_max_entries_in_memory(max_entries);
+}
+
 DirectoryLister::Core::Core(const base::FilePath& dir,
                             bool recursive,
                             SortType sort,
@@ -135,6 +281,7 @@ DirectoryLister::Core::Core(const base::FilePath& dir,
     : dir_(dir),
       recursive_(recursive),
       sort_(sort),
+      max_entries_in_memory_(kDefaultMaxEntriesInMemory),
       lister_(lister) {
   DCHECK(lister_);
 }
@@ -168,6 +315,15 @@ void DirectoryLister::Core::StartInternal() {
 
   file_util::FileEnumerator file_enum(dir_, recursive_, types);
 
+  // TODO(brettw) bug 24107: The sorting should eventually be done from JS to
+  // give more flexibility in the page.  Until then, only unsorted listings
+  // can be sent while the directory is still being enumerated.  Sorted ones
+  // are sent in order once enumeration finishes, and spill to disk rather
+  // than holding more than |max_entries_in_memory_| entries.
+  CompareFunction compare = GetCompareFunction(sort_);
+  ScopedVector<SortedRun> runs;
+  bool can_spill = true;
+
   base::FilePath path;
   std::vector<DirectoryListerData> file_data;
   while (lister_ && !(path = file_enum.Next()).empty()) {
@@ -176,29 +332,82 @@ void DirectoryLister::Core::StartInternal() {
     data.path = path;
     file_data.push_back(data);
 
-    /* TODO(brettw) bug 24107: It would be nice to send incremental updates.
-       We gather them all so they can be sorted, but eventually the sorting
-       should be done from JS to give more flexibility in the page. When we do
-       that, we can uncomment this to send incremental updates to the page.
-
-    if (file_data.size() < kFilesPerEvent)
+    if (!compare) {
+      if (file_data.size() >= kFilesPerEvent)
+        PostData(&file_data);
       continue;
+    }
+
+    if (can_spill && file_data.size() >= max_entries_in_memory_) {
+      std::sort(file_data.begin(), file_data.end(), compare);
+      SortedRun* run = SortedRun::Create(file_data);
+      if (run) {
+        runs.push_back(run);
+        file_data.clear();
+      } else {
+        // Keep going in memory, as before spilling existed.
+        can_spill = false;
+      }
+    }
+  }
 
-    origin_loop_->PostTask(
-        FROM_HERE,
-        base::Bind(&DirectoryLister::Core::SendData, file_data));
-    file_data.clear();
-    */
+  int error = OK;
+  if (compare) {
+    std::sort(file_data.begin(), file_data.end(), compare);
+    if (!runs.empty())
+      error = MergeRuns(compare, &runs, &file_data);
   }
+  PostData(&file_data);
 
-  SortData(&file_data, sort_);
   origin_loop_->PostTask(
       FROM_HERE,
-      base::Bind(&DirectoryLister::Core::SendData, this, file_data));
+      base::Bind(&DirectoryLister::Core::OnDone, this, error));
+}
+
+int DirectoryLister::Core::MergeRuns(
+    CompareFunction compare,
+    ScopedVector<SortedRun>* runs,
+    std::vector<DirectoryListerData>* file_data) {
+  // The entries still in memory are the last run.
+  SortedRun* last_run = SortedRun::Create(*file_data);
+  file_data->clear();
+  if (!last_run)
+    return ERR_FAILED;
+  runs->push_back(last_run);
+
+  std::vector<DirectoryListerData> heads(runs->size());
+  RunHeadGreater greater(compare, &heads);
+  std::priority_queue<size_t, std::vector<size_t>, RunHeadGreater> queue(
+      greater);
+  for (size_t i = 0; i < runs->size(); ++i) {
+    if ((*runs)[i]->ReadNext(&heads[i]))
+      queue.push(i);
+  }
 
+  while (lister_ && !queue.empty()) {
+    size_t i = queue.top();
+    queue.pop();
+    file_data->push_back(heads[i]);
+    if (file_data->size() >= kFilesPerEvent)
+      PostData(file_data);
+    if ((*runs)[i]->ReadNext(&heads[i]))
+      queue.push(i);
+  }
+
+  for (size_t i = 0; i < runs->size(); ++i) {
+    if ((*runs)[i]->failed())
+      return ERR_FAILED;
+  }
+  return OK;
+}
+
+void DirectoryLister::Core::PostData(std::vector<DirectoryListerData>* data) {
+  if (data->empty())
+    return;
   origin_loop_->PostTask(
       FROM_HERE,
-      base::Bind(&DirectoryLister::Core::OnDone, this, OK));
+      base::Bind(&DirectoryLister::Core::SendData, this, *data));
+  data->clear();
 }
 
 void DirectoryLister::Core::SendData(
@@ -10,6 +10,7 @@
 #include "base/file_util.h"
 #include "base/files/file_path.h"
 #include "base/memory/ref_counted.h"
+#include "base/memory/scoped_vector.h"
 #include "base/message_loop_proxy.h"
 #include "net/base/net_export.h"
 
@@ -73,6 +74,10 @@ class NET_EXPORT DirectoryLister  {
   // delegate will not be called back.
   void Cancel();
 
+  // Sorted listings with more entries than this are sorted in runs on disk
+  // and merged.  Must be called before Start().
+  void set_max_entries_in_memory_for_testing(size_t max_entries);
+
  private:
   class Core : public base::RefCountedThreadSafe<Core> {
    public:
@@ -85,15 +90,33 @@ class NET_EXPORT DirectoryLister  {
 
     void Cancel();
 
+    void set_max_entries_in_memory(size_t max_entries) {
+      max_entries_in_memory_ = max_entries;
+    }
+
    private:
     friend class base::RefCountedThreadSafe<Core>;
     class DataEvent;
+    class SortedRun;
+
+    typedef bool (*CompareFunction)(const DirectoryListerData& a,
+                                    const DirectoryListerData& b);
 
     ~Core();
 
     // This method runs on a WorkerPool thread.
     void StartInternal();
 
+    // Merges |runs| and the sorted entries in |file_data|, sending the result
+    // to the origin thread in batches.  Runs on the WorkerPool thread.
+    // Returns OK, or ERR_FAILED if a run couldn't be written or read back.
+    int MergeRuns(CompareFunction compare,
+                  ScopedVector<SortedRun>* runs,
+                  std::vector<DirectoryListerData>* file_data);
+
+    // Posts the entries in |data| to the origin thread, and clears it.
+    void PostData(std::vector<DirectoryListerData>* data);
+
     void SendData(const std::vector<DirectoryListerData>& data);
 
     void OnDone(int error);
@@ -101,6 +124,7 @@ class NET_EXPORT DirectoryLister  {
     base::FilePath dir_;
     bool recursive_;
     SortType sort_;
+    size_t max_entries_in_memory_;
     scoped_refptr<base::MessageLoopProxy> origin_loop_;
 
     // |lister_| gets set to NULL when canceled.
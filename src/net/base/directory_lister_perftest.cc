@@ -0,0 +1,109 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/base/directory_lister.h"
+
+#include "base/files/file_path.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/message_loop.h"
+#include "base/perftimer.h"
+#include "base/platform_file.h"
+#include "base/stringprintf.h"
+#include "base/time.h"
+#include "net/base/net_errors.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace net {
+
+namespace {
+
+const int kNumFiles = 50000;
+
+// Small enough that the sorted listings below are merged from disk.
+const size_t kMaxEntriesInMemory = 4096;
+
+class CountingDelegate : public DirectoryLister::DirectoryListerDelegate {
+ public:
+  CountingDelegate() : num_files_(0), error_(-1) {}
+
+  virtual void OnListFile(
+      const DirectoryLister::DirectoryListerData& data) OVERRIDE {
+    if (num_files_++ == 0)
+      first_file_time_ = base::TimeTicks::Now();
+  }
+
+  virtual void OnListDone(int error) OVERRIDE {
+    error_ = error;
+    base::MessageLoop::current()->Quit();
+  }
+
+  int num_files() const { return num_files_; }
+  int error() const { return error_; }
+  base::TimeTicks first_file_time() const { return first_file_time_; }
+
+ private:
+  int num_files_;
+  int error_;
+  base::TimeTicks first_file_time_;
+};
+
+class DirectoryListerPerfTest : public testing::Test {
+ protected:
+  virtual void SetUp() OVERRIDE {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    for (int i = 0; i < kNumFiles; ++i) {
+      base::PlatformFile file = base::CreatePlatformFile(
+          temp_dir_.path().AppendASCII(base::StringPrintf("file_%d", i)),
+          base::PLATFORM_FILE_CREATE | base::PLATFORM_FILE_WRITE,
+          NULL,
+          NULL);
+      ASSERT_NE(base::kInvalidPlatformFileValue, file);
+      ASSERT_TRUE(base::ClosePlatformFile(file));
+    }
+  }
+
+  // Lists the directory, logging the total time and the time until the first
+  // entry arrived.  |max_entries_in_memory| of zero leaves the default.
+  void List(const std::string& name,
+            DirectoryLister::SortType sort,
+            size_t max_entries_in_memory) {
+    CountingDelegate delegate;
+    DirectoryLister lister(temp_dir_.path(), false, sort, &delegate);
+    if (max_entries_in_memory)
+      lister.set_max_entries_in_memory_for_testing(max_entries_in_memory);
+
+    base::TimeTicks start = base::TimeTicks::Now();
+    PerfTimeLogger timer(name.c_str());
+    ASSERT_TRUE(lister.Start());
+    base::MessageLoop::current()->Run();
+    timer.Done();
+
+    EXPECT_EQ(OK, delegate.error());
+    // Includes "..".
+    EXPECT_EQ(kNumFiles + 1, delegate.num_files());
+    LOG(INFO) << name << ": first entry after "
+              << (delegate.first_file_time() - start).InMillisecondsF()
+              << " ms";
+  }
+
+  base::MessageLoopForIO message_loop_;
+  base::ScopedTempDir temp_dir_;
+};
+
+}  // namespace
+
+TEST_F(DirectoryListerPerfTest, Unsorted) {
+  List("DirectoryLister_Unsorted", DirectoryLister::NO_SORT, 0);
+}
+
+TEST_F(DirectoryListerPerfTest, Sorted) {
+  List("DirectoryLister_Sorted", DirectoryLister::ALPHA_DIRS_FIRST, 0);
+}
+
+TEST_F(DirectoryListerPerfTest, SortedMerged) {
+  List("DirectoryLister_SortedMerged", DirectoryLister::ALPHA_DIRS_FIRST,
+       kMaxEntriesInMemory);
+}
+
+}  // namespace net
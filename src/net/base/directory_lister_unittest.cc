@@ -24,7 +24,8 @@ class ListerDelegate : public DirectoryLister::DirectoryListerDelegate {
                  bool quit_loop_after_each_file)
       : error_(-1),
         recursive_(recursive),
-        quit_loop_after_each_file_(quit_loop_after_each_file) {
+        quit_loop_after_each_file_(quit_loop_after_each_file),
+        check_sort_(true) {
   }
 
   virtual void OnListFile(
@@ -38,6 +39,8 @@ class ListerDelegate : public DirectoryLister::DirectoryListerDelegate {
   virtual void OnListDone(int error) OVERRIDE {
     error_ = error;
     base::MessageLoop::current()->Quit();
+    if (!check_sort_)
+      return;
     if (recursive_)
       CheckRecursiveSort();
     else
@@ -83,16 +86,20 @@ class ListerDelegate : public DirectoryLister::DirectoryListerDelegate {
 
   int num_files() const { return file_list_.size(); }
 
+  void set_check_sort(bool check_sort) { check_sort_ = check_sort; }
+
  private:
   int error_;
   bool recursive_;
   bool quit_loop_after_each_file_;
+  bool check_sort_;
   std::vector<file_util::FileEnumerator::FindInfo> file_list_;
   std::vector<base::FilePath> paths_;
 };
 
 class DirectoryListerTest : public PlatformTest {
  public:
+  DirectoryListerTest() : num_entries_(0) {}
 
   virtual void SetUp() OVERRIDE {
     const int kMaxDepth = 3;
@@ -117,12 +124,14 @@ class DirectoryListerTest : public PlatformTest {
             NULL);
         ASSERT_NE(base::kInvalidPlatformFileValue, file);
         ASSERT_TRUE(base::ClosePlatformFile(file));
+        ++num_entries_;
       }
       if (dir_data.second < kMaxDepth - 1) {
         for (int i = 0; i < kBranchingFactor; i++) {
           std::string dir_name = base::StringPrintf("child_dir_%d", i);
           base::FilePath dir_path = dir_data.first.AppendASCII(dir_name);
           ASSERT_TRUE(file_util::CreateDirectory(dir_path));
+          ++num_entries_;
           directories.push_back(std::make_pair(dir_path, dir_data.second + 1));
         }
       }
@@ -134,8 +143,12 @@ class DirectoryListerTest : public PlatformTest {
     return temp_root_dir_.path();
   }
 
+  // Number of files and directories below root_path().
+  int num_entries() const { return num_entries_; }
+
  private:
   base::ScopedTempDir temp_root_dir_;
+  int num_entries_;
 };
 
 TEST_F(DirectoryListerTest, BigDirTest) {
@@ -159,6 +172,34 @@ TEST_F(DirectoryListerTest, BigDirRecursiveTest) {
   EXPECT_EQ(OK, delegate.error());
 }
 
+// A sorted listing that doesn't fit in memory is sorted in runs on disk,
+// then merged.
+TEST_F(DirectoryListerTest, BigDirRecursiveMergeSortTest) {
+  ListerDelegate delegate(true, false);
+  DirectoryLister lister(root_path(), true, DirectoryLister::FULL_PATH,
+                         &delegate);
+  lister.set_max_entries_in_memory_for_testing(7);
+  lister.Start();
+
+  base::MessageLoop::current()->Run();
+
+  EXPECT_EQ(OK, delegate.error());
+  EXPECT_EQ(num_entries(), delegate.num_files());
+}
+
+TEST_F(DirectoryListerTest, BigDirRecursiveUnsortedTest) {
+  ListerDelegate delegate(true, false);
+  delegate.set_check_sort(false);
+  DirectoryLister lister(root_path(), true, DirectoryLister::NO_SORT,
+                         &delegate);
+  lister.Start();
+
+  base::MessageLoop::current()->Run();
+
+  EXPECT_EQ(OK, delegate.error());
+  EXPECT_EQ(num_entries(), delegate.num_files());
+}
+
 TEST_F(DirectoryListerTest, CancelTest) {
   ListerDelegate delegate(false, true);
   DirectoryLister lister(root_path(), &delegate);
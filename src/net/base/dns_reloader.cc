@@ -9,11 +9,11 @@
 
 #include <resolv.h>
 
+#include "base/atomicops.h"
 #include "base/basictypes.h"
 #include "base/lazy_instance.h"
 #include "base/logging.h"
 #include "base/message_loop.h"
-#include "base/synchronization/lock.h"
 #include "base/threading/thread_local_storage.h"
 #include "net/base/network_change_notifier.h"
 
@@ -42,27 +42,31 @@ namespace {
 class DnsReloader : public net::NetworkChangeNotifier::DNSObserver {
  public:
   struct ReloadState {
-    int resolver_generation;
+    base::subtle::Atomic32 resolver_generation;
   };
 
   // NetworkChangeNotifier::DNSObserver:
   virtual void OnDNSChanged() OVERRIDE {
     DCHECK_EQ(base::MessageLoop::current()->type(), base::MessageLoop::TYPE_IO);
-    base::AutoLock l(lock_);
-    resolver_generation_++;
+    base::subtle::Barrier_AtomicIncrement(&resolver_generation_, 1);
   }
 
+  // Called before every lookup, from any of the resolver's worker threads, so
+  // the common case of an up to date thread takes no lock.  Each thread only
+  // touches its own resolver state, and only needs to notice a change
+  // eventually, as a lookup racing with a change could have gone either way.
   void MaybeReload() {
     ReloadState* reload_state = static_cast<ReloadState*>(tls_index_.Get());
-    base::AutoLock l(lock_);
+    base::subtle::Atomic32 resolver_generation =
+        base::subtle::Acquire_Load(&resolver_generation_);
 
     if (!reload_state) {
       reload_state = new ReloadState();
-      reload_state->resolver_generation = resolver_generation_;
+      reload_state->resolver_generation = resolver_generation;
       res_ninit(&_res);
       tls_index_.Set(reload_state);
-    } else if (reload_state->resolver_generation != resolver_generation_) {
-      reload_state->resolver_generation = resolver_generation_;
+    } else if (reload_state->resolver_generation != resolver_generation) {
+      reload_state->resolver_generation = resolver_generation;
       // It is safe to call res_nclose here since we know res_ninit will have
       // been called above.
       res_nclose(&_res);
@@ -88,8 +92,8 @@ class DnsReloader : public net::NetworkChangeNotifier::DNSObserver {
     NOTREACHED();  // LeakyLazyInstance is not destructed.
   }
 
-  base::Lock lock_;  // Protects resolver_generation_.
-  int resolver_generation_;
+  // Bumped on every DNS change; compared against each thread's ReloadState.
+  volatile base::subtle::Atomic32 resolver_generation_;
   friend struct base::DefaultLazyInstanceTraits<DnsReloader>;
 
   // We use thread local storage to identify which ReloadState to interact with.
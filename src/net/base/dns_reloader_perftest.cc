@@ -0,0 +1,63 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/base/dns_reloader.h"
+
+#if defined(OS_POSIX) && !defined(OS_MACOSX) && !defined(OS_OPENBSD) && \
+    !defined(OS_ANDROID)
+
+#include "base/memory/scoped_vector.h"
+#include "base/perftimer.h"
+#include "base/stringprintf.h"
+#include "base/threading/simple_thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace net {
+
+namespace {
+
+const int kLookupsPerThread = 1000000;
+
+// Does what each HostResolverImpl worker does before calling getaddrinfo(),
+// without the lookup itself.
+class LookupThread : public base::SimpleThread {
+ public:
+  explicit LookupThread(int index)
+      : base::SimpleThread(base::StringPrintf("LookupThread%d", index)) {}
+
+  virtual void Run() OVERRIDE {
+    for (int i = 0; i < kLookupsPerThread; ++i)
+      DnsReloaderMaybeReload();
+  }
+};
+
+// Measures the per-lookup reload check with |num_threads| resolver threads
+// running at once.
+void RunLookups(int num_threads) {
+  ScopedVector<LookupThread> threads;
+  for (int i = 0; i < num_threads; ++i)
+    threads.push_back(new LookupThread(i));
+
+  PerfTimeLogger timer(base::StringPrintf(
+      "DnsReloader_MaybeReload_%dThreads", num_threads).c_str());
+  for (int i = 0; i < num_threads; ++i)
+    threads[i]->Start();
+  for (int i = 0; i < num_threads; ++i)
+    threads[i]->Join();
+  timer.Done();
+}
+
+}  // namespace
+
+TEST(DnsReloaderPerfTest, MaybeReload) {
+  EnsureDnsReloaderInit();
+  const int kThreadCounts[] = { 1, 2, 4, 8, 16 };
+  for (size_t i = 0; i < arraysize(kThreadCounts); ++i)
+    RunLookups(kThreadCounts[i]);
+}
+
+}  // namespace net
+
+#endif  // defined(OS_POSIX) && !defined(OS_MACOSX) && !defined(OS_OPENBSD) &&
+        // !defined(OS_ANDROID)
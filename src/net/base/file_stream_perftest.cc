@@ -0,0 +1,117 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/base/file_stream.h"
+
+#include <algorithm>
+#include <string>
+
+#include "base/file_util.h"
+#include "base/files/file_path.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/message_loop.h"
+#include "base/perftimer.h"
+#include "base/platform_file.h"
+#include "base/stringprintf.h"
+#include "net/base/io_buffer.h"
+#include "net/base/net_errors.h"
+#include "net/base/test_completion_callback.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace net {
+
+namespace {
+
+const int kFileSize = 4 * 1024 * 1024;
+
+// Read sizes from a small file:// read up to a typical upload chunk.
+const int kReadSizes[] = { 512, 4 * 1024, 64 * 1024 };
+
+// Measures FileStream reads of a file that is in the page cache, so the cost
+// of each operation is dominated by how it's dispatched rather than by disk.
+// Asynchronous reads hop to the worker pool and back for every call;
+// synchronous reads on the calling thread are the floor that any other
+// asynchronous backend should be compared against.
+class FileStreamPerfTest : public testing::Test {
+ protected:
+  virtual void SetUp() OVERRIDE {
+    ASSERT_TRUE(file_util::CreateTemporaryFile(&path_));
+    std::string data(kFileSize, 'x');
+    ASSERT_EQ(kFileSize,
+              file_util::WriteFile(path_, data.data(), kFileSize));
+  }
+
+  virtual void TearDown() OVERRIDE {
+    EXPECT_TRUE(file_util::Delete(path_, false));
+  }
+
+  // Reads the whole file |read_size| bytes at a time, |passes| times.
+  void ReadAsync(int read_size, int passes) {
+    scoped_refptr<IOBuffer> buf(new IOBuffer(read_size));
+    PerfTimeLogger timer(base::StringPrintf(
+        "FileStream_ReadAsync_%d", read_size).c_str());
+    for (int i = 0; i < passes; ++i) {
+      FileStream stream(NULL);
+      TestCompletionCallback callback;
+      int rv = stream.Open(path_,
+                           base::PLATFORM_FILE_OPEN |
+                           base::PLATFORM_FILE_READ |
+                           base::PLATFORM_FILE_ASYNC,
+                           callback.callback());
+      ASSERT_EQ(OK, callback.GetResult(rv));
+      int total = 0;
+      do {
+        rv = callback.GetResult(
+            stream.Read(buf.get(), read_size, callback.callback()));
+        ASSERT_LE(0, rv);
+        total += rv;
+      } while (rv > 0);
+      ASSERT_EQ(kFileSize, total);
+    }
+    timer.Done();
+  }
+
+  void ReadSync(int read_size, int passes) {
+    scoped_ptr<char[]> buf(new char[read_size]);
+    PerfTimeLogger timer(base::StringPrintf(
+        "FileStream_ReadSync_%d", read_size).c_str());
+    for (int i = 0; i < passes; ++i) {
+      FileStream stream(NULL);
+      ASSERT_EQ(OK, stream.OpenSync(path_, base::PLATFORM_FILE_OPEN |
+                                           base::PLATFORM_FILE_READ));
+      int total = 0;
+      int rv;
+      do {
+        rv = stream.ReadSync(buf.get(), read_size);
+        ASSERT_LE(0, rv);
+        total += rv;
+      } while (rv > 0);
+      ASSERT_EQ(kFileSize, total);
+    }
+    timer.Done();
+  }
+
+  // The number of passes needed to make about the same number of reads at
+  // every size.
+  static int PassesFor(int read_size) {
+    return std::max(1, read_size / 256);
+  }
+
+  base::MessageLoopForIO message_loop_;
+  base::FilePath path_;
+};
+
+}  // namespace
+
+TEST_F(FileStreamPerfTest, ReadAsync) {
+  for (size_t i = 0; i < arraysize(kReadSizes); ++i)
+    ReadAsync(kReadSizes[i], PassesFor(kReadSizes[i]));
+}
+
+TEST_F(FileStreamPerfTest, ReadSync) {
+  for (size_t i = 0; i < arraysize(kReadSizes); ++i)
+    ReadSync(kReadSizes[i], PassesFor(kReadSizes[i]));
+}
+
+}  // namespace net
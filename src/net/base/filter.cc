@@ -49,13 +49,21 @@ Filter::~Filter() {}
 // static
 Filter* Filter::Factory(const std::vector<FilterType>& filter_types,
                         const FilterContext& filter_context) {
+  return FactoryWithBufferSize(filter_types, filter_context, kFilterBufSize);
+}
+
+// static
+Filter* Filter::FactoryWithBufferSize(
+    const std::vector<FilterType>& filter_types,
+    const FilterContext& filter_context,
+    int buffer_size) {
   if (filter_types.empty())
     return NULL;
 
   Filter* filter_list = NULL;  // Linked list of filters.
   for (size_t i = 0; i < filter_types.size(); i++) {
     filter_list = PrependNewFilter(filter_types[i], filter_context,
-                                   kFilterBufSize, filter_list);
+                                   buffer_size, filter_list);
     if (!filter_list)
       return NULL;
   }
@@ -67,23 +75,6 @@ Filter* Filter::GZipFactory() {
   return InitGZipFilter(FILTER_TYPE_GZIP, kFilterBufSize);
 }
 
-// static
-Filter* Filter::FactoryForTests(const std::vector<FilterType>& filter_types,
-                                const FilterContext& filter_context,
-                                int buffer_size) {
-  if (filter_types.empty())
-    return NULL;
-
-  Filter* filter_list = NULL;  // Linked list of filters.
-  for (size_t i = 0; i < filter_types.size(); i++) {
-    filter_list = PrependNewFilter(filter_types[i], filter_context,
-                                   buffer_size, filter_list);
-    if (!filter_list)
-      return NULL;
-  }
-  return filter_list;
-}
-
 Filter::FilterStatus Filter::ReadData(char* dest_buffer, int* dest_len) {
   const int dest_buffer_capacity = *dest_len;
   if (last_status_ == FILTER_ERROR)
@@ -148,6 +148,17 @@ class NET_EXPORT_PRIVATE Filter {
   static Filter* Factory(const std::vector<FilterType>& filter_types,
                          const FilterContext& filter_context);
 
+  // Like Factory(), but every filter in the chain gets a stream buffer of
+  // |buffer_size| bytes instead of the default 32KB.  Since each filter
+  // decodes directly into the next filter's stream buffer, this is also the
+  // largest chunk any filter but the last will produce per call.  Callers
+  // that stream large bodies can use a larger size to make fewer passes
+  // through the chain.
+  static Filter* FactoryWithBufferSize(
+      const std::vector<FilterType>& filter_types,
+      const FilterContext& filter_context,
+      int buffer_size);
+
   // A simpler version of Factory() which creates a single, unchained
   // Filter of type FILTER_TYPE_GZIP, or NULL if the filter could not be
   // initialized.
@@ -198,7 +209,6 @@ class NET_EXPORT_PRIVATE Filter {
 
  protected:
   friend class GZipUnitTest;
-  friend class SdchFilterChainingTest;
 
   Filter();
 
@@ -253,15 +263,11 @@ class NET_EXPORT_PRIVATE Filter {
                                 const FilterContext& filter_context,
                                 int buffer_size);
 
-  // Helper function to empty our output into the next filter's input.
+  // Helper function to empty our output into the next filter's input.  Our
+  // ReadFilteredData() writes straight into the next filter's stream_buffer_,
+  // so decoded data is never staged in between the two filters.
   void PushDataIntoNextFilter();
 
-  // Constructs a filter with an internal buffer of the given size.
-  // Only meant to be called by unit tests that need to control the buffer size.
-  static Filter* FactoryForTests(const std::vector<FilterType>& filter_types,
-                                 const FilterContext& filter_context,
-                                 int buffer_size);
-
   // An optional filter to process output from this filter.
   scoped_ptr<Filter> next_filter_;
   // Remember what status or local filter last returned so we can better handle
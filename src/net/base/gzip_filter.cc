@@ -8,13 +8,27 @@
 #include "net/base/gzip_header.h"
 #include "third_party/zlib/zlib.h"
 
+namespace {
+
+// Returns true if |cmf| and |flg| form a zlib stream header (RFC 1950,
+// section 2.2) for deflate data without a preset dictionary.
+bool IsZlibHeader(unsigned char cmf, unsigned char flg) {
+  const unsigned char kPresetDictionaryFlag = 0x20;
+  return (cmf & 0x0f) == Z_DEFLATED && (cmf >> 4) + 8 <= MAX_WBITS &&
+         !(flg & kPresetDictionaryFlag) && ((cmf << 8) | flg) % 31 == 0;
+}
+
+}  // namespace
+
 namespace net {
 
 GZipFilter::GZipFilter()
     : decoding_status_(DECODING_UNINITIALIZED),
       decoding_mode_(DECODE_MODE_UNKNOWN),
       gzip_header_status_(GZIP_CHECK_HEADER_IN_PROGRESS),
-      zlib_header_added_(false),
+      zlib_header_checked_(false),
+      has_zlib_header_first_byte_(false),
+      zlib_header_first_byte_(0),
       gzip_footer_bytes_(0),
       possible_sdch_pass_through_(false) {
 }
@@ -123,20 +137,20 @@ Filter::FilterStatus GZipFilter::ReadFilteredData(char* dest_buffer,
     }
   }
 
-  int dest_orig_size = *dest_len;
-  status = DoInflate(dest_buffer, dest_len);
-
-  if (decoding_mode_ == DECODE_MODE_DEFLATE && status == Filter::FILTER_ERROR) {
-    // As noted in Mozilla implementation, some servers such as Apache with
-    // mod_deflate don't generate zlib headers.
-    // See 677409 for instances where this work around is needed.
-    // Insert a dummy zlib header and try again.
-    if (InsertZlibHeader()) {
-      *dest_len = dest_orig_size;
-      status = DoInflate(dest_buffer, dest_len);
+  if (decoding_mode_ == DECODE_MODE_DEFLATE && !zlib_header_checked_) {
+    status = CheckZlibHeader();
+    if (status == Filter::FILTER_NEED_MORE_DATA) {
+      *dest_len = 0;
+      return status;
+    }
+    if (status == Filter::FILTER_ERROR) {
+      decoding_status_ = DECODING_ERROR;
+      return status;
     }
   }
 
+  status = DoInflate(dest_buffer, dest_len);
+
   if (status == Filter::FILTER_DONE) {
     decoding_status_ = DECODING_DONE;
   } else if (status == Filter::FILTER_ERROR) {
@@ -260,28 +274,59 @@ Filter::FilterStatus GZipFilter::DoInflate(char* dest_buffer, int* dest_len) {
   return status;
 }
 
-bool GZipFilter::InsertZlibHeader() {
-  static char dummy_head[2] = { 0x78, 0x1 };
+Filter::FilterStatus GZipFilter::CheckZlibHeader() {
+  DCHECK_EQ(decoding_mode_, DECODE_MODE_DEFLATE);
+  DCHECK(!zlib_header_checked_);
 
-  char dummy_output[4];
+  if (!next_stream_data_ || stream_data_len_ <= 0)
+    return Filter::FILTER_NEED_MORE_DATA;
 
-  // We only try add additional header once.
-  if (zlib_header_added_)
-    return false;
+  unsigned char first_byte;
+  unsigned char second_byte;
+  if (has_zlib_header_first_byte_) {
+    first_byte = zlib_header_first_byte_;
+    second_byte = next_stream_data_[0];
+  } else if (stream_data_len_ == 1) {
+    // Hold on to a lone first byte until the second one arrives.
+    zlib_header_first_byte_ = next_stream_data_[0];
+    has_zlib_header_first_byte_ = true;
+    next_stream_data_ = NULL;
+    stream_data_len_ = 0;
+    return Filter::FILTER_NEED_MORE_DATA;
+  } else {
+    first_byte = next_stream_data_[0];
+    second_byte = next_stream_data_[1];
+  }
+  zlib_header_checked_ = true;
 
-  inflateReset(zlib_stream_.get());
-  zlib_stream_.get()->next_in = bit_cast<Bytef*>(&dummy_head[0]);
-  zlib_stream_.get()->avail_in = sizeof(dummy_head);
-  zlib_stream_.get()->next_out = bit_cast<Bytef*>(&dummy_output[0]);
-  zlib_stream_.get()->avail_out = sizeof(dummy_output);
+  if (!IsZlibHeader(first_byte, second_byte)) {
+    // As noted in Mozilla implementation, some servers such as Apache with
+    // mod_deflate don't generate zlib headers.
+    // See 677409 for instances where this work around is needed.
+    // Switch zlib to raw inflate.  The window size is unchanged, so zlib
+    // keeps the state it has already allocated.
+    if (inflateReset2(zlib_stream_.get(), -MAX_WBITS) != Z_OK)
+      return Filter::FILTER_ERROR;
+  }
 
-  int code = inflate(zlib_stream_.get(), Z_NO_FLUSH);
-  zlib_header_added_ = true;
+  if (has_zlib_header_first_byte_) {
+    // Feed the held back byte to inflate on its own.  A single byte never
+    // completes a zlib header or a deflate code, so it yields no output.
+    char output;
+    zlib_stream_.get()->next_in = bit_cast<Bytef*>(&zlib_header_first_byte_);
+    zlib_stream_.get()->avail_in = 1;
+    zlib_stream_.get()->next_out = bit_cast<Bytef*>(&output);
+    zlib_stream_.get()->avail_out = 1;
+    if (inflate(zlib_stream_.get(), Z_NO_FLUSH) != Z_OK ||
+        zlib_stream_.get()->avail_in != 0 ||
+        zlib_stream_.get()->avail_out != 1) {
+      return Filter::FILTER_ERROR;
+    }
+  }
 
-  return (code == Z_OK);
+  return Filter::FILTER_OK;
 }
 
-
 void GZipFilter::SkipGZipFooter() {
   int footer_bytes_expected = kGZipFooterSize - gzip_footer_bytes_;
   if (footer_bytes_expected > 0) {
@@ -96,11 +96,16 @@ class GZipFilter : public Filter {
   // comments for the use of function.
   FilterStatus DoInflate(char* dest_buffer, int* dest_len);
 
-  // Inserts a zlib header to the data stream before calling zlib inflate.
-  // This is used to work around server bugs. See more comments at the place
-  // it is called in gzip_filter.cc.
-  // The function returns true on success and false otherwise.
-  bool InsertZlibHeader();
+  // Looks at the first two bytes of a deflate stream to tell whether they
+  // are a zlib header (RFC 1950) or the start of raw deflate data, which some
+  // servers send by mistake.  In the latter case zlib is switched to raw
+  // mode in place, so no input is thrown away and nothing is decoded twice.
+  //
+  // Returns Filter::FILTER_OK once the decision is made, or
+  // Filter::FILTER_NEED_MORE_DATA if only one byte has arrived so far; that
+  // byte is held in zlib_header_first_byte_ until the next call.  Returns
+  // Filter::FILTER_ERROR if zlib can't be switched to raw mode.
+  FilterStatus CheckZlibHeader();
 
   // Skip the 8 byte GZip footer after z_stream_end
   void SkipGZipFooter();
@@ -122,16 +127,17 @@ class GZipFilter : public Filter {
   // This variable is maintained by gzip_header_.
   GZipCheckHeaderState gzip_header_status_;
 
-  // A flag used by InsertZlibHeader to record whether we've successfully added
-  // a zlib header to this stream.
-  bool zlib_header_added_;
+  // Tracks CheckZlibHeader(), which only runs in DECODE_MODE_DEFLATE.
+  bool zlib_header_checked_;
+  bool has_zlib_header_first_byte_;
+  char zlib_header_first_byte_;
 
   // Tracks how many bytes of gzip footer have been received.
   int gzip_footer_bytes_;
 
   // The control block of zlib which actually does the decoding.
   // This data structure is initialized by InitDecoding and updated only by
-  // DoInflate, with InsertZlibHeader being the exception as a workaround.
+  // DoInflate, with CheckZlibHeader being the exception as a workaround.
   scoped_ptr<z_stream> zlib_stream_;
 
   // For robustness, when we see the solo sdch filter, we chain in a gzip filter
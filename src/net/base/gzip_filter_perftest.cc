@@ -0,0 +1,173 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/perftimer.h"
+#include "base/stringprintf.h"
+#include "net/base/filter.h"
+#include "net/base/io_buffer.h"
+#include "net/base/mock_filter_context.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "third_party/zlib/zlib.h"
+
+namespace net {
+
+namespace {
+
+const int kNumIterations = 100;
+const size_t kPayloadSize = 512 * 1024;
+
+// Size of the buffer the consumer reads decoded data into.
+const int kReadBufferSize = 32 * 1024;
+
+// Builds roughly |size| bytes of HTML that compresses about as well as a
+// typical search results page: repetitive markup with varying text.
+std::string MakeHtmlPayload(size_t size) {
+  std::string html("<!doctype html><html><head><title>Results</title>"
+                   "<link rel=\"stylesheet\" href=\"/css/main.css\">"
+                   "</head><body><div id=\"results\">\n");
+  for (int i = 0; html.size() < size; ++i) {
+    base::StringAppendF(
+        &html,
+        "<li class=\"g\"><h3 class=\"r\"><a href=\"http://www.example.com/"
+        "page/%d?q=term%d\">Result number %d for term %d</a></h3>"
+        "<div class=\"s\"><cite>www.example.com/page/%d</cite>"
+        "<span class=\"st\">Snippet text %x describing result %d, with "
+        "some words that repeat and some that do not: %o.</span></div>"
+        "</li>\n",
+        i, i * 7, i, i * 7, i, i * 31337, i, i * 13);
+  }
+  html.append("</div></body></html>\n");
+  return html;
+}
+
+// Builds roughly |size| bytes of minified-looking JavaScript.
+std::string MakeJavaScriptPayload(size_t size) {
+  std::string js("(function(){var w=window,d=document;");
+  for (int i = 0; js.size() < size; ++i) {
+    base::StringAppendF(
+        &js,
+        "function f%d(a,b){if(!a)return null;var c=a.getAttribute(\"data-%x\")"
+        "||\"\";for(var e=0;e<b.length;e++){c+=b[e]*%d;}"
+        "d.getElementById(\"n%d\").className=c;return c}"
+        "w.m%d={k:%d,v:\"%o\",g:f%d};",
+        i, i * 977, i % 17, i, i, i * 3, i * 4099, i);
+  }
+  js.append("})();\n");
+  return js;
+}
+
+enum Encoding {
+  ENCODING_GZIP,
+  ENCODING_DEFLATE,      // zlib wrapped, as servers normally send.
+  ENCODING_RAW_DEFLATE,  // No zlib header, as some misconfigured servers send.
+};
+
+std::string Compress(const std::string& input, Encoding encoding) {
+  z_stream zlib_stream;
+  memset(&zlib_stream, 0, sizeof(zlib_stream));
+  int window_bits = MAX_WBITS;
+  if (encoding == ENCODING_GZIP)
+    window_bits += 16;
+  else if (encoding == ENCODING_RAW_DEFLATE)
+    window_bits = -window_bits;
+  CHECK_EQ(Z_OK, deflateInit2(&zlib_stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                              window_bits, 8, Z_DEFAULT_STRATEGY));
+  std::string output(deflateBound(&zlib_stream, input.size()) + 32, '\0');
+  zlib_stream.next_in = bit_cast<Bytef*>(input.data());
+  zlib_stream.avail_in = input.size();
+  zlib_stream.next_out = bit_cast<Bytef*>(&output[0]);
+  zlib_stream.avail_out = output.size();
+  CHECK_EQ(Z_STREAM_END, deflate(&zlib_stream, Z_FINISH));
+  output.resize(output.size() - zlib_stream.avail_out);
+  deflateEnd(&zlib_stream);
+  return output;
+}
+
+// Pushes all of |input| through |filter| the way URLRequestJob does: fill the
+// stream buffer, then read until the filter asks for more.  Returns the
+// number of decoded bytes.
+size_t DecodeAll(Filter* filter, const std::string& input, char* read_buffer) {
+  size_t consumed = 0;
+  size_t decoded = 0;
+  Filter::FilterStatus status = Filter::FILTER_NEED_MORE_DATA;
+  while (status != Filter::FILTER_DONE) {
+    if (status == Filter::FILTER_NEED_MORE_DATA) {
+      if (consumed == input.size())
+        break;
+      int size = std::min(static_cast<size_t>(filter->stream_buffer_size()),
+                          input.size() - consumed);
+      memcpy(filter->stream_buffer()->data(), input.data() + consumed, size);
+      filter->FlushStreamBuffer(size);
+      consumed += size;
+    }
+    int read_size = kReadBufferSize;
+    status = filter->ReadData(read_buffer, &read_size);
+    CHECK_NE(Filter::FILTER_ERROR, status);
+    decoded += read_size;
+  }
+  return decoded;
+}
+
+void RunDecodeTest(const std::string& name,
+                   Filter::FilterType type,
+                   int buffer_size,
+                   const std::string& payload,
+                   const std::string& encoded) {
+  std::vector<Filter::FilterType> filter_types;
+  filter_types.push_back(type);
+  MockFilterContext filter_context;
+  scoped_ptr<char[]> read_buffer(new char[kReadBufferSize]);
+
+  PerfTimeLogger timer(base::StringPrintf("%s_%dK", name.c_str(),
+                                          buffer_size / 1024).c_str());
+  for (int i = 0; i < kNumIterations; ++i) {
+    scoped_ptr<Filter> filter(Filter::FactoryWithBufferSize(
+        filter_types, filter_context, buffer_size));
+    ASSERT_EQ(payload.size(),
+              DecodeAll(filter.get(), encoded, read_buffer.get()));
+  }
+  timer.Done();
+}
+
+// Runs |payload| through a filter of |type| at a range of stream buffer
+// sizes, from below the default 32KB to well above it.
+void RunDecodeTests(const std::string& name,
+                    Filter::FilterType type,
+                    const std::string& payload,
+                    Encoding encoding) {
+  const int kBufferSizes[] = { 16 * 1024, 32 * 1024, 64 * 1024, 128 * 1024 };
+  const std::string encoded(Compress(payload, encoding));
+  for (size_t i = 0; i < arraysize(kBufferSizes); ++i)
+    RunDecodeTest(name, type, kBufferSizes[i], payload, encoded);
+}
+
+}  // namespace
+
+TEST(GZipFilterPerfTest, GZipHtml) {
+  RunDecodeTests("GZipFilter_GZip_Html", Filter::FILTER_TYPE_GZIP,
+                 MakeHtmlPayload(kPayloadSize), ENCODING_GZIP);
+}
+
+TEST(GZipFilterPerfTest, GZipJavaScript) {
+  RunDecodeTests("GZipFilter_GZip_JavaScript", Filter::FILTER_TYPE_GZIP,
+                 MakeJavaScriptPayload(kPayloadSize), ENCODING_GZIP);
+}
+
+TEST(GZipFilterPerfTest, DeflateHtml) {
+  RunDecodeTests("GZipFilter_Deflate_Html", Filter::FILTER_TYPE_DEFLATE,
+                 MakeHtmlPayload(kPayloadSize), ENCODING_DEFLATE);
+}
+
+TEST(GZipFilterPerfTest, RawDeflateHtml) {
+  RunDecodeTests("GZipFilter_RawDeflate_Html", Filter::FILTER_TYPE_DEFLATE,
+                 MakeHtmlPayload(kPayloadSize), ENCODING_RAW_DEFLATE);
+}
+
+}  // namespace net
@@ -229,8 +229,8 @@ class GZipUnitTest : public PlatformTest {
   void InitFilterWithBufferSize(Filter::FilterType type, int buffer_size) {
     std::vector<Filter::FilterType> filter_types;
     filter_types.push_back(type);
-    filter_.reset(Filter::FactoryForTests(filter_types, filter_context_,
-                                          buffer_size));
+    filter_.reset(Filter::FactoryWithBufferSize(filter_types, filter_context_,
+                                                buffer_size));
     ASSERT_TRUE(filter_.get());
   }
 
@@ -325,6 +325,32 @@ TEST_F(GZipUnitTest, DecodeWithOneByteInputAndOutputBuffer) {
                              gzip_encode_buffer_, gzip_encode_len_, 1);
 }
 
+// Some servers send raw deflate data, without the zlib header, for
+// "Content-Encoding: deflate".  The gzip test data minus its header is such a
+// stream.
+TEST_F(GZipUnitTest, DecodeRawDeflate) {
+  InitFilter(Filter::FILTER_TYPE_DEFLATE);
+  DecodeAndCompareWithFilter(filter_.get(), source_buffer(), source_len(),
+                             gzip_encode_buffer_ + sizeof(kGZipHeader),
+                             gzip_encode_len_ - sizeof(kGZipHeader),
+                             kDefaultBufferSize);
+}
+
+// Tests that the filter can tell raw deflate data from zlib wrapped data when
+// the first two bytes arrive separately.
+TEST_F(GZipUnitTest, DecodeDeflateWithOneByteBuffer) {
+  InitFilterWithBufferSize(Filter::FILTER_TYPE_DEFLATE, 1);
+  DecodeAndCompareWithFilter(filter_.get(), source_buffer(), source_len(),
+                             deflate_encode_buffer_, deflate_encode_len_,
+                             kDefaultBufferSize);
+
+  InitFilterWithBufferSize(Filter::FILTER_TYPE_DEFLATE, 1);
+  DecodeAndCompareWithFilter(filter_.get(), source_buffer(), source_len(),
+                             gzip_encode_buffer_ + sizeof(kGZipHeader),
+                             gzip_encode_len_ - sizeof(kGZipHeader),
+                             kDefaultBufferSize);
+}
+
 // Decoding deflate stream with corrupted data.
 TEST_F(GZipUnitTest, DecodeCorruptedData) {
   char corrupt_data[kDefaultBufferSize];
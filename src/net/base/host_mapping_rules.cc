@@ -4,6 +4,10 @@
 
 #include "net/base/host_mapping_rules.h"
 
+#include <algorithm>
+#include <map>
+#include <utility>
+
 #include "base/logging.h"
 #include "base/string_util.h"
 #include "base/strings/string_split.h"
@@ -21,48 +25,136 @@ struct HostMappingRules::MapRule {
   int replacement_port;
 };
 
-struct HostMappingRules::ExclusionRule {
-  std::string hostname_pattern;
-};
+namespace {
 
-HostMappingRules::HostMappingRules() {}
+// Returns whichever of two pattern indices comes first, where -1 means none.
+int EarlierPattern(int a, int b) {
+  if (a == -1)
+    return b;
+  if (b == -1)
+    return a;
+  return std::min(a, b);
+}
 
-HostMappingRules::~HostMappingRules() {}
+}  // namespace
+
+// Finds the first of a list of hostname patterns that matches a string.
+// Patterns that are a plain name, or a plain name after a single leading "*",
+// are kept in a trie of the reversed pattern, so a lookup walks the string
+// once no matter how many such rules there are.  Other patterns fall back to
+// MatchPattern(), in order.
+class HostMappingRules::PatternMatcher {
+ public:
+  PatternMatcher() : nodes_(1), num_patterns_(0) {}
+
+  // Appends |pattern| to the list.  Its index is the number of patterns
+  // added before it.
+  void AddPattern(const std::string& pattern) {
+    int index = num_patterns_++;
+    bool is_suffix = !pattern.empty() && pattern[0] == '*';
+    std::string name = is_suffix ? pattern.substr(1) : pattern;
+    if (name.find_first_of("*?\\") != std::string::npos) {
+      other_patterns_.push_back(std::make_pair(index, pattern));
+      return;
+    }
 
-bool HostMappingRules::RewriteHost(HostPortPair* host_port) const {
-  // Check if the hostname was excluded.
-  for (ExclusionRuleList::const_iterator it = exclusion_rules_.begin();
-       it != exclusion_rules_.end(); ++it) {
-    const ExclusionRule& rule = *it;
-    if (MatchPattern(host_port->host(), rule.hostname_pattern))
-      return false;
+    size_t node = 0;
+    for (std::string::reverse_iterator it = name.rbegin();
+         it != name.rend(); ++it) {
+      std::map<char, size_t>::const_iterator child =
+          nodes_[node].children.find(*it);
+      if (child != nodes_[node].children.end()) {
+        node = child->second;
+      } else {
+        nodes_.push_back(Node());
+        nodes_[node].children[*it] = nodes_.size() - 1;
+        node = nodes_.size() - 1;
+      }
+    }
+    int* slot = is_suffix ? &nodes_[node].suffix_pattern :
+                            &nodes_[node].exact_pattern;
+    if (*slot == -1)
+      *slot = index;
   }
 
-  // Check if the hostname was remapped.
-  for (MapRuleList::const_iterator it = map_rules_.begin();
-       it != map_rules_.end(); ++it) {
-    const MapRule& rule = *it;
-
-    // The rule's hostname_pattern will be something like:
-    //     www.foo.com
-    //     *.foo.com
-    //     www.foo.com:1234
-    //     *.foo.com:1234
-    // First, we'll check for a match just on hostname.
-    // If that fails, we'll check for a match with both hostname and port.
-    if (!MatchPattern(host_port->host(), rule.hostname_pattern)) {
-      std::string host_port_string = host_port->ToString();
-      if (!MatchPattern(host_port_string, rule.hostname_pattern))
-        continue;  // This rule doesn't apply.
+  // Returns the index of the first pattern that matches |text|, or -1.
+  int FindFirstMatch(const std::string& text) const {
+    int first = -1;
+    size_t node = 0;
+    for (size_t i = text.size(); ; --i) {
+      first = EarlierPattern(first, nodes_[node].suffix_pattern);
+      if (i == 0) {
+        first = EarlierPattern(first, nodes_[node].exact_pattern);
+        break;
+      }
+      std::map<char, size_t>::const_iterator child =
+          nodes_[node].children.find(text[i - 1]);
+      if (child == nodes_[node].children.end())
+        break;
+      node = child->second;
     }
 
-    host_port->set_host(rule.replacement_hostname);
-    if (rule.replacement_port != -1)
-      host_port->set_port(rule.replacement_port);
-    return true;
+    for (size_t i = 0; i < other_patterns_.size(); ++i) {
+      if (first != -1 && other_patterns_[i].first > first)
+        break;
+      if (MatchPattern(text, other_patterns_[i].second))
+        return other_patterns_[i].first;
+    }
+    return first;
   }
 
-  return false;
+ private:
+  struct Node {
+    Node() : exact_pattern(-1), suffix_pattern(-1) {}
+
+    std::map<char, size_t> children;
+    // The first pattern spelling out the path to this node, or -1.
+    int exact_pattern;
+    // The first pattern that is "*" followed by the path to this node, or -1.
+    int suffix_pattern;
+  };
+
+  // |nodes_[0]| is the root.
+  std::vector<Node> nodes_;
+  // (index, pattern) of the patterns not in the trie.
+  std::vector<std::pair<int, std::string> > other_patterns_;
+  int num_patterns_;
+
+  DISALLOW_COPY_AND_ASSIGN(PatternMatcher);
+};
+
+HostMappingRules::HostMappingRules()
+    : map_patterns_(new PatternMatcher),
+      exclusion_patterns_(new PatternMatcher) {
+}
+
+HostMappingRules::~HostMappingRules() {}
+
+bool HostMappingRules::RewriteHost(HostPortPair* host_port) const {
+  // Check if the hostname was excluded.
+  if (exclusion_patterns_->FindFirstMatch(host_port->host()) != -1)
+    return false;
+
+  // Check if the hostname was remapped.
+  //
+  // A rule's hostname_pattern will be something like:
+  //     www.foo.com
+  //     *.foo.com
+  //     www.foo.com:1234
+  //     *.foo.com:1234
+  // The first rule that matches either the hostname alone, or the hostname
+  // and port, applies.
+  int index = EarlierPattern(
+      map_patterns_->FindFirstMatch(host_port->host()),
+      map_patterns_->FindFirstMatch(host_port->ToString()));
+  if (index == -1)
+    return false;
+
+  const MapRule& rule = map_rules_[index];
+  host_port->set_host(rule.replacement_hostname);
+  if (rule.replacement_port != -1)
+    host_port->set_port(rule.replacement_port);
+  return true;
 }
 
 bool HostMappingRules::AddRuleFromString(const std::string& rule_string) {
@@ -73,9 +165,7 @@ bool HostMappingRules::AddRuleFromString(const std::string& rule_string) {
 
   // Test for EXCLUSION rule.
   if (parts.size() == 2 && LowerCaseEqualsASCII(parts[0], "exclude")) {
-    ExclusionRule rule;
-    rule.hostname_pattern = StringToLowerASCII(parts[1]);
-    exclusion_rules_.push_back(rule);
+    exclusion_patterns_->AddPattern(StringToLowerASCII(parts[1]));
     return true;
   }
 
@@ -90,6 +180,7 @@ bool HostMappingRules::AddRuleFromString(const std::string& rule_string) {
     }
 
     map_rules_.push_back(rule);
+    map_patterns_->AddPattern(rule.hostname_pattern);
     return true;
   }
 
@@ -97,8 +188,9 @@ bool HostMappingRules::AddRuleFromString(const std::string& rule_string) {
 }
 
 void HostMappingRules::SetRulesFromString(const std::string& rules_string) {
-  exclusion_rules_.clear();
   map_rules_.clear();
+  map_patterns_.reset(new PatternMatcher);
+  exclusion_patterns_.reset(new PatternMatcher);
 
   base::StringTokenizer rules(rules_string, ",");
   while (rules.GetNext()) {
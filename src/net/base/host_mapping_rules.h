@@ -8,6 +8,7 @@
 #include <string>
 #include <vector>
 #include "base/basictypes.h"
+#include "base/memory/scoped_ptr.h"
 #include "net/base/net_export.h"
 
 namespace net {
@@ -38,13 +39,16 @@ class NET_EXPORT_PRIVATE HostMappingRules {
 
  private:
   struct MapRule;
-  struct ExclusionRule;
+  class PatternMatcher;
 
   typedef std::vector<MapRule> MapRuleList;
-  typedef std::vector<ExclusionRule> ExclusionRuleList;
 
   MapRuleList map_rules_;
-  ExclusionRuleList exclusion_rules_;
+
+  // The hostname patterns of |map_rules_|, in the same order, and of the
+  // exclusion rules.
+  scoped_ptr<PatternMatcher> map_patterns_;
+  scoped_ptr<PatternMatcher> exclusion_patterns_;
 
   DISALLOW_COPY_AND_ASSIGN(HostMappingRules);
 };
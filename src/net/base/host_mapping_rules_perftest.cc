@@ -0,0 +1,84 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/base/host_mapping_rules.h"
+
+#include <string>
+#include <vector>
+
+#include "base/perftimer.h"
+#include "base/stringprintf.h"
+#include "net/base/host_port_pair.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace net {
+
+namespace {
+
+const int kNumRules = 10000;
+const int kNumLookups = 100000;
+
+// Builds |kNumRules| rules of the kinds seen in test rig configurations:
+// mostly exact and "*." suffix mappings, a few exclusions, and a handful of
+// general wildcard patterns.
+std::string MakeRules() {
+  std::string rules;
+  for (int i = 0; i < kNumRules; ++i) {
+    if (!rules.empty())
+      rules.append(",");
+    switch (i % 10) {
+      case 0:
+        base::StringAppendF(&rules, "EXCLUDE skip%d.example.com", i);
+        break;
+      case 1:
+        base::StringAppendF(&rules, "map host%d.*.test 127.0.0.1:%d", i,
+                            1024 + i);
+        break;
+      case 2:
+      case 3:
+      case 4:
+      case 5:
+        base::StringAppendF(&rules, "map host%d.example.com 127.0.0.1:%d", i,
+                            1024 + i);
+        break;
+      default:
+        base::StringAppendF(&rules, "map *.site%d.example.org 127.0.0.1:%d",
+                            i, 1024 + i);
+        break;
+    }
+  }
+  return rules;
+}
+
+}  // namespace
+
+TEST(HostMappingRulesPerfTest, RewriteHost) {
+  HostMappingRules rules;
+  rules.SetRulesFromString(MakeRules());
+
+  // Some lookups hit a rule, the rest fall through every rule.
+  std::vector<HostPortPair> hosts;
+  for (int i = 0; i < kNumRules; i += 7) {
+    hosts.push_back(HostPortPair(
+        base::StringPrintf("host%d.example.com", i), 80));
+    hosts.push_back(HostPortPair(
+        base::StringPrintf("www.site%d.example.org", i), 443));
+    hosts.push_back(HostPortPair(
+        base::StringPrintf("www.unmapped%d.example.net", i), 80));
+    hosts.push_back(HostPortPair(
+        base::StringPrintf("nohost%d.example.com", i), 443));
+  }
+
+  int rewritten = 0;
+  PerfTimeLogger timer("HostMappingRules_RewriteHost");
+  for (int i = 0; i < kNumLookups; ++i) {
+    HostPortPair host_port = hosts[i % hosts.size()];
+    if (rules.RewriteHost(&host_port))
+      ++rewritten;
+  }
+  timer.Done();
+  EXPECT_GT(rewritten, 0);
+}
+
+}  // namespace net
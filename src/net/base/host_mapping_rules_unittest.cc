@@ -67,6 +67,43 @@ TEST(HostMappingRulesTest, PortSpecificMatching) {
   EXPECT_EQ(443u, host_port.port());
 }
 
+// Rules apply in the order they were added, whatever the kind of pattern.
+TEST(HostMappingRulesTest, FirstMatchingRuleWins) {
+  HostMappingRules rules;
+  rules.SetRulesFromString(
+      "map www.foo.com exact, map *.foo.com:80 suffix-port, "
+      "map w?w.*.com glob, map *foo.com suffix, map * any, "
+      "EXCLUDE bar.foo.com");
+
+  HostPortPair host_port("www.foo.com", 80);
+  EXPECT_TRUE(rules.RewriteHost(&host_port));
+  EXPECT_EQ("exact", host_port.host());
+
+  host_port = HostPortPair("a.foo.com", 80);
+  EXPECT_TRUE(rules.RewriteHost(&host_port));
+  EXPECT_EQ("suffix-port", host_port.host());
+
+  host_port = HostPortPair("wxw.foo.com", 81);
+  EXPECT_TRUE(rules.RewriteHost(&host_port));
+  EXPECT_EQ("glob", host_port.host());
+
+  host_port = HostPortPair("barfoo.com", 81);
+  EXPECT_TRUE(rules.RewriteHost(&host_port));
+  EXPECT_EQ("suffix", host_port.host());
+
+  host_port = HostPortPair("foo.com", 81);
+  EXPECT_TRUE(rules.RewriteHost(&host_port));
+  EXPECT_EQ("suffix", host_port.host());
+
+  host_port = HostPortPair("foo.org", 81);
+  EXPECT_TRUE(rules.RewriteHost(&host_port));
+  EXPECT_EQ("any", host_port.host());
+
+  host_port = HostPortPair("bar.foo.com", 80);
+  EXPECT_FALSE(rules.RewriteHost(&host_port));
+  EXPECT_EQ("bar.foo.com", host_port.host());
+}
+
 // Parsing bad rules should silently discard the rule (and never crash).
 TEST(HostMappingRulesTest, ParseInvalidRules) {
   HostMappingRules rules;
@@ -92,11 +92,14 @@
 // Note that our definition of HTML payload is much stricter than IE's
 // definition and roughly the same as Firefox's definition.
 
+#include <algorithm>
 #include <string>
+#include <vector>
 
 #include "net/base/mime_sniffer.h"
 
 #include "base/basictypes.h"
+#include "base/lazy_instance.h"
 #include "base/logging.h"
 #include "base/metrics/histogram.h"
 #include "base/string_util.h"
@@ -313,8 +316,19 @@ static bool MagicMaskCmp(const char* magic_entry,
   return true;
 }
 
+// To compare with magic strings, we need to compute strlen(content), but
+// content might not actually have a null terminator.  In that case, we
+// pretend the length is content_size.  No magic number is longer than
+// kBytesRequiredForMagic, so there is no need to look any further than that.
+static size_t ContentStrlen(const char* content, size_t size) {
+  size = std::min(size, kBytesRequiredForMagic);
+  const char* end = static_cast<const char*>(memchr(content, '\0', size));
+  return (end != NULL) ? static_cast<size_t>(end - content) : size;
+}
+
 static bool MatchMagicNumber(const char* content,
                              size_t size,
+                             size_t content_strlen,
                              const MagicNumber& magic_entry,
                              std::string* result) {
   const size_t len = magic_entry.magic_len;
@@ -322,13 +336,6 @@ static bool MatchMagicNumber(const char* content,
   // Keep kBytesRequiredForMagic honest.
   DCHECK_LE(len, kBytesRequiredForMagic);
 
-  // To compare with magic strings, we need to compute strlen(content), but
-  // content might not actually have a null terminator.  In that case, we
-  // pretend the length is content_size.
-  const char* end = static_cast<const char*>(memchr(content, '\0', size));
-  const size_t content_strlen =
-      (end != NULL) ? static_cast<size_t>(end - content) : size;
-
   bool match = false;
   if (magic_entry.is_string) {
     if (content_strlen >= len) {
@@ -356,8 +363,9 @@ static bool CheckForMagicNumbers(const char* content, size_t size,
                                  const MagicNumber* magic, size_t magic_len,
                                  base::HistogramBase* counter,
                                  std::string* result) {
+  const size_t content_strlen = ContentStrlen(content, size);
   for (size_t i = 0; i < magic_len; ++i) {
-    if (MatchMagicNumber(content, size, magic[i], result)) {
+    if (MatchMagicNumber(content, size, content_strlen, magic[i], result)) {
       if (counter) counter->Add(static_cast<int>(i));
       return true;
     }
@@ -365,6 +373,115 @@ static bool CheckForMagicNumbers(const char* content, size_t size,
   return false;
 }
 
+namespace {
+
+// Buckets the entries of a magic number table by the byte they expect at
+// |key_offset|, so that a lookup only compares the few entries that could
+// match the content rather than walking the whole table.  Buckets list their
+// entries in table order, so Check() finds the same entry, and records the
+// same histogram sample, as CheckForMagicNumbers() on the table would.
+class MagicNumberIndex {
+ public:
+  MagicNumberIndex(const MagicNumber* magic,
+                   size_t magic_len,
+                   size_t key_offset);
+
+  bool Check(const char* content,
+             size_t size,
+             base::HistogramBase* counter,
+             std::string* result) const;
+
+ private:
+  // Returns true if |entry| can match content that has |c| at |key_offset_|.
+  bool CanMatch(const MagicNumber& entry, char c) const;
+
+  const MagicNumber* const magic_;
+  const size_t magic_len_;
+  const size_t key_offset_;
+
+  // The entries that can match content with byte |c| at |key_offset_| are
+  // entries_[bucket_begin_[c]] up to entries_[bucket_begin_[c + 1]].
+  size_t bucket_begin_[257];
+  std::vector<size_t> entries_;
+
+  DISALLOW_COPY_AND_ASSIGN(MagicNumberIndex);
+};
+
+MagicNumberIndex::MagicNumberIndex(const MagicNumber* magic,
+                                   size_t magic_len,
+                                   size_t key_offset)
+    : magic_(magic),
+      magic_len_(magic_len),
+      key_offset_(key_offset) {
+  for (int c = 0; c < 256; ++c) {
+    bucket_begin_[c] = entries_.size();
+    for (size_t i = 0; i < magic_len_; ++i) {
+      if (CanMatch(magic_[i], static_cast<char>(c)))
+        entries_.push_back(i);
+    }
+  }
+  bucket_begin_[256] = entries_.size();
+}
+
+bool MagicNumberIndex::Check(const char* content,
+                             size_t size,
+                             base::HistogramBase* counter,
+                             std::string* result) const {
+  // Content too short to have a key byte can only match entries that are
+  // shorter still, which are in every bucket.
+  if (size <= key_offset_) {
+    return CheckForMagicNumbers(content, size, magic_, magic_len_, counter,
+                                result);
+  }
+
+  const size_t content_strlen = ContentStrlen(content, size);
+  const unsigned char c = static_cast<unsigned char>(content[key_offset_]);
+  for (size_t i = bucket_begin_[c]; i < bucket_begin_[c + 1]; ++i) {
+    const size_t entry = entries_[i];
+    if (MatchMagicNumber(content, size, content_strlen, magic_[entry],
+                         result)) {
+      if (counter) counter->Add(static_cast<int>(entry));
+      return true;
+    }
+  }
+  return false;
+}
+
+bool MagicNumberIndex::CanMatch(const MagicNumber& entry, char c) const {
+  // An entry without a key byte matches whatever the content has there.
+  if (entry.magic_len <= key_offset_)
+    return true;
+
+  const char magic = entry.magic[key_offset_];
+  if (entry.is_string)
+    return ToLowerASCII(magic) == ToLowerASCII(c);
+  if (magic == '.')
+    return true;
+  if (entry.mask)
+    return magic == (entry.mask[key_offset_] & c);
+  return magic == c;
+}
+
+// The tables that are searched for most of the content we sniff.
+struct MagicNumberIndexes {
+  MagicNumberIndexes()
+      : magic_numbers(kMagicNumbers, arraysize(kMagicNumbers), 0),
+        extra_magic_numbers(kExtraMagicNumbers, arraysize(kExtraMagicNumbers),
+                            0),
+        // Every sniffable tag starts with '<', so key on the byte after it.
+        sniffable_tags(kSniffableTags, arraysize(kSniffableTags), 1) {
+  }
+
+  const MagicNumberIndex magic_numbers;
+  const MagicNumberIndex extra_magic_numbers;
+  const MagicNumberIndex sniffable_tags;
+};
+
+base::LazyInstance<MagicNumberIndexes>::Leaky g_magic_number_indexes =
+    LAZY_INSTANCE_INITIALIZER;
+
+}  // namespace
+
 // Truncates |size| to |max_size| and returns true if |size| is at least
 // |max_size|.
 static bool TruncateSize(const size_t max_size, size_t* size) {
@@ -402,9 +519,8 @@ static bool SniffForHTML(const char* content,
                                      arraysize(kSniffableTags));
   }
   // |pos| now points to first non-whitespace character (or at end).
-  return CheckForMagicNumbers(pos, end - pos,
-                              kSniffableTags, arraysize(kSniffableTags),
-                              counter, result);
+  return g_magic_number_indexes.Get().sniffable_tags.Check(
+      pos, end - pos, counter, result);
 }
 
 // Returns true and sets result if the content matches any of kMagicNumbers.
@@ -421,9 +537,8 @@ static bool SniffForMagicNumbers(const char* content,
     counter = UMASnifferHistogramGet("mime_sniffer.kMagicNumbers2",
                                      arraysize(kMagicNumbers));
   }
-  return CheckForMagicNumbers(content, size,
-                              kMagicNumbers, arraysize(kMagicNumbers),
-                              counter, result);
+  return g_magic_number_indexes.Get().magic_numbers.Check(
+      content, size, counter, result);
 }
 
 // Returns true and sets result if the content matches any of
@@ -941,12 +1056,11 @@ bool SniffMimeTypeFromLocalData(const char* content,
                                 size_t size,
                                 std::string* result) {
   // First check the extra table.
-  if (CheckForMagicNumbers(content, size, kExtraMagicNumbers,
-                           arraysize(kExtraMagicNumbers), NULL, result))
+  const MagicNumberIndexes& indexes = g_magic_number_indexes.Get();
+  if (indexes.extra_magic_numbers.Check(content, size, NULL, result))
     return true;
   // Finally check the original table.
-  return CheckForMagicNumbers(content, size, kMagicNumbers,
-                              arraysize(kMagicNumbers), NULL, result);
+  return indexes.magic_numbers.Check(content, size, NULL, result);
 }
 
 }  // namespace net
@@ -0,0 +1,81 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/base/mime_sniffer.h"
+
+#include <string>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/perftimer.h"
+#include "googleurl/src/gurl.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace net {
+
+namespace {
+
+const int kNumSniffs = 1000000;
+
+// The start of typical responses that get sniffed: pages served without a
+// type, images, archives and text that matches nothing.
+std::vector<std::string> MakeContents() {
+  static const struct {
+    const char* content;
+    size_t content_len;
+  } kContents[] = {
+    { "\n\n  <!DOCTYPE html>\n<html><head>",
+      sizeof("\n\n  <!DOCTYPE html>\n<html><head>") - 1 },
+    { "<HTML><HEAD><TITLE>", sizeof("<HTML><HEAD><TITLE>") - 1 },
+    { "<p>Hello</p>", sizeof("<p>Hello</p>") - 1 },
+    { "\x89" "PNG\x0D\x0A\x1A\x0A\x00\x00\x00\x0DIHDR", 16 },
+    { "GIF89a\x10\x00\x10\x00", 10 },
+    { "\xFF\xD8\xFF\xE0\x00\x10JFIF", 10 },
+    { "PK\x03\x04\x14\x00\x00\x00", 8 },
+    { "RIFF\x24\x08\x00\x00WEBPVP8 ", 16 },
+    { "Lorem ipsum dolor sit amet, consectetur adipiscing elit.",
+      sizeof("Lorem ipsum dolor sit amet, consectetur adipiscing elit.") - 1 },
+  };
+  std::vector<std::string> contents;
+  for (size_t i = 0; i < arraysize(kContents); ++i) {
+    std::string content(kContents[i].content, kContents[i].content_len);
+    // Pad to the size of a first network read.
+    content.resize(1024, ' ');
+    contents.push_back(content);
+  }
+  return contents;
+}
+
+}  // namespace
+
+TEST(MimeSnifferPerfTest, SniffMimeType) {
+  const std::vector<std::string> contents = MakeContents();
+  const GURL url("http://www.example.com/foo");
+
+  std::string mime_type;
+  PerfTimeLogger timer("MimeSniffer_SniffMimeType");
+  for (int i = 0; i < kNumSniffs; ++i) {
+    const std::string& content = contents[i % contents.size()];
+    SniffMimeType(content.data(), content.size(), url, std::string(),
+                  &mime_type);
+  }
+  timer.Done();
+}
+
+TEST(MimeSnifferPerfTest, SniffMimeTypeFromLocalData) {
+  const std::vector<std::string> contents = MakeContents();
+
+  int matched = 0;
+  std::string mime_type;
+  PerfTimeLogger timer("MimeSniffer_SniffMimeTypeFromLocalData");
+  for (int i = 0; i < kNumSniffs; ++i) {
+    const std::string& content = contents[i % contents.size()];
+    if (SniffMimeTypeFromLocalData(content.data(), content.size(), &mime_type))
+      ++matched;
+  }
+  timer.Done();
+  EXPECT_GT(matched, 0);
+}
+
+}  // namespace net
@@ -395,4 +395,38 @@ TEST(MimeSnifferTest, LooksBinary) {
   EXPECT_EQ("application/octet-stream", mime_type);
 }
 
+// Entries with wildcards, masks and embedded nulls are looked up from the
+// byte they start with like any other.
+TEST(MimeSnifferTest, LocalDataTest) {
+  static const struct {
+    const char* content;
+    size_t content_len;
+    const char* mime_type;
+  } tests[] = {
+    { "#define X 1", sizeof("#define X 1") - 1, "image/x-xbitmap" },
+    { "#!/bin/sh", sizeof("#!/bin/sh") - 1, "text/plain" },
+    { "\x00\x00\x01\x00\x01", 5, "image/x-icon" },
+    { "\x00\x00\x01\xB3\x01", 5, "video/mpeg" },
+    { "\xFF\xFB\x90\x00", 4, "audio/mpeg" },
+    { "\xFF\xD8\xFF\xE0", 4, "image/jpeg" },
+    { "RIFF\x01\x02\x03\x04WAVEfmt ", 16, "audio/wav" },
+    { "RIFF\x01\x02\x03\x04WEBPVP8 ", 16, "image/webp" },
+    { "\x00\x00\x00\x18" "ftyp3gp4", 12, "video/3gpp" },
+    { "\x00\x00\x00\x18" "ftypisom", 12, "video/mp4" },
+    { "GIF89a", 6, "image/gif" },
+  };
+  for (size_t i = 0; i < arraysize(tests); ++i) {
+    std::string mime_type;
+    EXPECT_TRUE(SniffMimeTypeFromLocalData(tests[i].content,
+                                           tests[i].content_len,
+                                           &mime_type));
+    EXPECT_EQ(tests[i].mime_type, mime_type);
+  }
+
+  std::string mime_type;
+  EXPECT_FALSE(SniffMimeTypeFromLocalData("gif89a", 6, &mime_type));
+  EXPECT_FALSE(SniffMimeTypeFromLocalData("RIFF", 4, &mime_type));
+  EXPECT_FALSE(SniffMimeTypeFromLocalData("", 0, &mime_type));
+}
+
 }  // namespace net
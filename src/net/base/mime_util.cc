@@ -6,6 +6,7 @@
 #include <iterator>
 #include <map>
 #include <string>
+#include <utility>
 
 #include "net/base/mime_util.h"
 #include "net/base/platform_mime_util.h"
@@ -78,11 +79,23 @@ class MimeUtil : public PlatformMimeUtil {
       const std::string& mime_type,
       const std::vector<std::string>& codecs) const;
 
+  // Adds the extensions that the hard-coded mappings give for every mime type
+  // starting with |leading_mime_type| to |extensions|.  |leading_mime_type|
+  // must be lowercase.
+  void GetExtensionsFromHardCodedMappings(
+      const std::string& leading_mime_type,
+      base::hash_set<base::FilePath::StringType>* extensions) const;
+
  private:
   friend struct base::DefaultLazyInstanceTraits<MimeUtil>;
 
   typedef base::hash_set<std::string> MimeMappings;
   typedef std::map<std::string, MimeMappings> StrictMappings;
+  // Lowercase extension to mime type.
+  typedef base::hash_map<std::string, const char*> ExtensionMappings;
+  // (mime type, extension) pairs, sorted by mime type.
+  typedef std::vector<std::pair<std::string, base::FilePath::StringType> >
+      MimeTypeExtensions;
 
   MimeUtil();
 
@@ -94,6 +107,9 @@ class MimeUtil : public PlatformMimeUtil {
   // For faster lookup, keep hash sets.
   void InitializeMimeTypeMaps();
 
+  // Indexes the hard-coded extension mappings both ways.
+  void InitializeExtensionMaps();
+
   bool GetMimeTypeFromExtensionHelper(const base::FilePath::StringType& ext,
                                       bool include_platform_types,
                                       std::string* mime_type) const;
@@ -106,6 +122,10 @@ class MimeUtil : public PlatformMimeUtil {
   MimeMappings codecs_map_;
 
   StrictMappings strict_format_map_;
+
+  ExtensionMappings primary_extension_map_;
+  ExtensionMappings secondary_extension_map_;
+  MimeTypeExtensions hard_coded_extensions_;
 };  // class MimeUtil
 
 // This variable is Leaky because we need to access it from WorkerPool threads.
@@ -164,25 +184,39 @@ static const MimeInfo secondary_mappings[] = {
   { "application/pkcs7-signature", "p7s" }
 };
 
-static const char* FindMimeType(const MimeInfo* mappings,
-                                size_t mappings_len,
-                                const char* ext) {
-  size_t ext_len = strlen(ext);
-
+// Adds every extension of |mappings| to |extension_map|, and every (mime
+// type, extension) pair to |mime_type_extensions|.  An extension listed for
+// more than one mime type maps to the first.
+static void AddHardCodedMappings(
+    const MimeInfo* mappings,
+    size_t mappings_len,
+    base::hash_map<std::string, const char*>* extension_map,
+    std::vector<std::pair<std::string, base::FilePath::StringType> >*
+        mime_type_extensions) {
   for (size_t i = 0; i < mappings_len; ++i) {
-    const char* extensions = mappings[i].extensions;
-    for (;;) {
-      size_t end_pos = strcspn(extensions, ",");
-      if (end_pos == ext_len &&
-          base::strncasecmp(extensions, ext, ext_len) == 0)
-        return mappings[i].mime_type;
-      extensions += end_pos;
-      if (!*extensions)
-        break;
-      extensions += 1;  // skip over comma
+    std::vector<string> extensions;
+    base::SplitString(mappings[i].extensions, ',', &extensions);
+    for (size_t j = 0; j < extensions.size(); ++j) {
+      extension_map->insert(std::make_pair(StringToLowerASCII(extensions[j]),
+                                           mappings[i].mime_type));
+#if defined(OS_WIN)
+      base::FilePath::StringType extension(UTF8ToWide(extensions[j]));
+#else
+      base::FilePath::StringType extension(extensions[j]);
+#endif
+      mime_type_extensions->push_back(
+          std::make_pair(StringToLowerASCII(std::string(mappings[i].mime_type)),
+                         extension));
     }
   }
-  return NULL;
+}
+
+static const char* FindMimeType(
+    const base::hash_map<std::string, const char*>& extension_map,
+    const std::string& ext) {
+  base::hash_map<std::string, const char*>::const_iterator it =
+      extension_map.find(ext);
+  return it != extension_map.end() ? it->second : NULL;
 }
 
 bool MimeUtil::GetMimeTypeFromExtension(const base::FilePath::StringType& ext,
@@ -224,10 +258,12 @@ bool MimeUtil::GetMimeTypeFromExtensionHelper(
 #elif defined(OS_POSIX)
   const string& ext_narrow_str = ext;
 #endif
+  // Extensions are matched case-insensitively, up to any embedded null.
+  const std::string ext_lower =
+      StringToLowerASCII(std::string(ext_narrow_str.c_str()));
   const char* mime_type;
 
-  mime_type = FindMimeType(primary_mappings, arraysize(primary_mappings),
-                           ext_narrow_str.c_str());
+  mime_type = FindMimeType(primary_extension_map_, ext_lower);
   if (mime_type) {
     *result = mime_type;
     return true;
@@ -236,8 +272,7 @@ bool MimeUtil::GetMimeTypeFromExtensionHelper(
   if (include_platform_types && GetPlatformMimeTypeFromExtension(ext, result))
     return true;
 
-  mime_type = FindMimeType(secondary_mappings, arraysize(secondary_mappings),
-                           ext_narrow_str.c_str());
+  mime_type = FindMimeType(secondary_extension_map_, ext_lower);
   if (mime_type) {
     *result = mime_type;
     return true;
@@ -421,6 +456,7 @@ static const MediaFormatStrict format_codec_mappings[] = {
 
 MimeUtil::MimeUtil() {
   InitializeMimeTypeMaps();
+  InitializeExtensionMaps();
 }
 
 // static
@@ -485,6 +521,30 @@ void MimeUtil::InitializeMimeTypeMaps() {
   }
 }
 
+void MimeUtil::InitializeExtensionMaps() {
+  AddHardCodedMappings(primary_mappings, arraysize(primary_mappings),
+                       &primary_extension_map_, &hard_coded_extensions_);
+  AddHardCodedMappings(secondary_mappings, arraysize(secondary_mappings),
+                       &secondary_extension_map_, &hard_coded_extensions_);
+  std::sort(hard_coded_extensions_.begin(), hard_coded_extensions_.end());
+}
+
+void MimeUtil::GetExtensionsFromHardCodedMappings(
+    const std::string& leading_mime_type,
+    base::hash_set<base::FilePath::StringType>* extensions) const {
+  // The mime types starting with |leading_mime_type| are a contiguous range
+  // of the sorted pairs, beginning at the first one not less than it.
+  for (MimeTypeExtensions::const_iterator it = std::lower_bound(
+           hard_coded_extensions_.begin(), hard_coded_extensions_.end(),
+           std::make_pair(leading_mime_type, base::FilePath::StringType()));
+       it != hard_coded_extensions_.end() &&
+           it->first.compare(0, leading_mime_type.length(),
+                             leading_mime_type) == 0;
+       ++it) {
+    extensions->insert(it->second);
+  }
+}
+
 bool MimeUtil::IsSupportedImageMimeType(const std::string& mime_type) const {
   return image_map_.find(mime_type) != image_map_.end();
 }
@@ -832,29 +892,6 @@ static const StandardType kStandardTypes[] = {
   { NULL, NULL, 0 }
 };
 
-void GetExtensionsFromHardCodedMappings(
-    const MimeInfo* mappings,
-    size_t mappings_len,
-    const std::string& leading_mime_type,
-    base::hash_set<base::FilePath::StringType>* extensions) {
-  base::FilePath::StringType extension;
-  for (size_t i = 0; i < mappings_len; ++i) {
-    if (StartsWithASCII(mappings[i].mime_type, leading_mime_type, false)) {
-      std::vector<string> this_extensions;
-      base::SplitStringUsingSubstr(mappings[i].extensions, ",",
-                                   &this_extensions);
-      for (size_t j = 0; j < this_extensions.size(); ++j) {
-#if defined(OS_WIN)
-        base::FilePath::StringType extension(UTF8ToWide(this_extensions[j]));
-#else
-        base::FilePath::StringType extension(this_extensions[j]);
-#endif
-        extensions->insert(extension);
-      }
-    }
-  }
-}
-
 void GetExtensionsHelper(
     const char* const* standard_types,
     size_t standard_types_len,
@@ -867,15 +904,8 @@ void GetExtensionsHelper(
 
   // Also look up the extensions from hard-coded mappings in case that some
   // supported extensions are not registered in the system registry, like ogg.
-  GetExtensionsFromHardCodedMappings(primary_mappings,
-                                     arraysize(primary_mappings),
-                                     leading_mime_type,
-                                     extensions);
-
-  GetExtensionsFromHardCodedMappings(secondary_mappings,
-                                     arraysize(secondary_mappings),
-                                     leading_mime_type,
-                                     extensions);
+  g_mime_util.Get().GetExtensionsFromHardCodedMappings(leading_mime_type,
+                                                       extensions);
 }
 
 // Note that the elements in the source set will be appended to the target
@@ -923,15 +953,8 @@ void GetExtensionsForMimeType(
 
     // Also look up the extensions from hard-coded mappings in case that some
     // supported extensions are not registered in the system registry, like ogg.
-    GetExtensionsFromHardCodedMappings(primary_mappings,
-                                       arraysize(primary_mappings),
-                                       mime_type,
-                                       &unique_extensions);
-
-    GetExtensionsFromHardCodedMappings(secondary_mappings,
-                                       arraysize(secondary_mappings),
-                                       mime_type,
-                                       &unique_extensions);
+    g_mime_util.Get().GetExtensionsFromHardCodedMappings(mime_type,
+                                                         &unique_extensions);
   }
 
   HashSetToVector(&unique_extensions, extensions);
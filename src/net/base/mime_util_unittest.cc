@@ -34,6 +34,35 @@ TEST(MimeUtilTest, ExtensionTest) {
   }
 }
 
+TEST(MimeUtilTest, WellKnownExtensionTest) {
+  const struct {
+    const base::FilePath::CharType* extension;
+    const char* mime_type;
+  } tests[] = {
+    { FILE_PATH_LITERAL("png"), "image/png" },
+    { FILE_PATH_LITERAL("PNG"), "image/png" },
+    { FILE_PATH_LITERAL("HtM"), "text/html" },
+    { FILE_PATH_LITERAL("shtml"), "text/html" },
+    // Extensions listed for several mime types map to the first.
+    { FILE_PATH_LITERAL("webm"), "video/webm" },
+    { FILE_PATH_LITERAL("ico"), "image/x-icon" },
+    { FILE_PATH_LITERAL("svgz"), "image/svg+xml" },
+    { FILE_PATH_LITERAL("p7s"), "application/pkcs7-signature" },
+    { FILE_PATH_LITERAL(""), NULL },
+    { FILE_PATH_LITERAL("pn"), NULL },
+    { FILE_PATH_LITERAL("png,jpg"), NULL },
+  };
+
+  for (size_t i = 0; i < ARRAYSIZE_UNSAFE(tests); ++i) {
+    std::string mime_type;
+    bool rv = GetWellKnownMimeTypeFromExtension(tests[i].extension,
+                                                &mime_type);
+    EXPECT_EQ(tests[i].mime_type != NULL, rv) << i;
+    if (rv)
+      EXPECT_EQ(tests[i].mime_type, mime_type);
+  }
+}
+
 TEST(MimeUtilTest, FileTest) {
   const struct {
     const base::FilePath::CharType* file_path;
@@ -244,6 +273,7 @@ TEST(MimeUtilTest, TestGetExtensionsForMimeType) {
     { "message/*",  1, "eml" },
     { "MeSsAge/*",  1, "eml" },
     { "image/bmp",  1, "bmp" },
+    { "IMAGE/JPEG", 3, "pjp" },
     { "video/*",    6, "mp4" },
 #if defined(OS_LINUX) || defined(OS_ANDROID) || defined(OS_IOS)
     { "video/*",    6, "mpg" },
@@ -34,6 +34,9 @@ struct memio_buffer {
      */
     PRErrorCode last_err;
     char *buf;
+    /* set if buf was allocated by memio_buffer_new rather than lent by the
+     * caller of memio_CreateIOLayerWithBuffers */
+    PRBool owns_buf;
 };
 
 
@@ -68,7 +71,11 @@ struct PRFilePrivate {
 /* Allocate a memio_buffer of given size. */
 static void memio_buffer_new(struct memio_buffer *mb, int size);
 
-/* Deallocate a memio_buffer allocated by memio_buffer_new. */
+/* Use caller-owned memory of given size as a memio_buffer. */
+static void memio_buffer_wrap(struct memio_buffer *mb, char *buf, int size);
+
+/* Deallocate a memio_buffer allocated by memio_buffer_new, or forget the
+ * memory of one set up by memio_buffer_wrap. */
 static void memio_buffer_destroy(struct memio_buffer *mb);
 
 /* How many bytes can be read out of the buffer without wrapping */
@@ -93,12 +100,25 @@ static void memio_buffer_new(struct memio_buffer *mb, int size)
     mb->tail = 0;
     mb->bufsize = size;
     mb->buf = malloc(size);
+    mb->owns_buf = PR_TRUE;
 }
 
-/* Deallocate a memio_buffer allocated by memio_buffer_new. */
+/* Use caller-owned memory of given size as a memio_buffer. */
+static void memio_buffer_wrap(struct memio_buffer *mb, char *buf, int size)
+{
+    mb->head = 0;
+    mb->tail = 0;
+    mb->bufsize = size;
+    mb->buf = buf;
+    mb->owns_buf = PR_FALSE;
+}
+
+/* Deallocate a memio_buffer allocated by memio_buffer_new, or forget the
+ * memory of one set up by memio_buffer_wrap. */
 static void memio_buffer_destroy(struct memio_buffer *mb)
 {
-    free(mb->buf);
+    if (mb->owns_buf)
+        free(mb->buf);
     mb->buf = NULL;
     mb->head = 0;
     mb->tail = 0;
@@ -356,7 +376,7 @@ static PRStatus memio_InitializeLayerName(void)
 
 /*--------------- public memio functions -----------------------*/
 
-PRFileDesc *memio_CreateIOLayer(int readbufsize, int writebufsize)
+static PRFileDesc *memio_CreateIOLayerStub(void)
 {
     PRFileDesc *fd;
     struct PRFilePrivate *secret;
@@ -367,10 +387,28 @@ PRFileDesc *memio_CreateIOLayer(int readbufsize, int writebufsize)
     fd = PR_CreateIOLayerStub(memio_identity, &memio_layer_methods);
     secret = malloc(sizeof(struct PRFilePrivate));
     memset(secret, 0, sizeof(*secret));
+    fd->secret = secret;
+    return fd;
+}
+
+PRFileDesc *memio_CreateIOLayer(int readbufsize, int writebufsize)
+{
+    PRFileDesc *fd = memio_CreateIOLayerStub();
+    struct PRFilePrivate *secret = fd->secret;
 
     memio_buffer_new(&secret->readbuf, readbufsize);
     memio_buffer_new(&secret->writebuf, writebufsize);
-    fd->secret = secret;
+    return fd;
+}
+
+PRFileDesc *memio_CreateIOLayerWithBuffers(char *readbuf, int readbufsize,
+                                           char *writebuf, int writebufsize)
+{
+    PRFileDesc *fd = memio_CreateIOLayerStub();
+    struct PRFilePrivate *secret = fd->secret;
+
+    memio_buffer_wrap(&secret->readbuf, readbuf, readbufsize);
+    memio_buffer_wrap(&secret->writebuf, writebuf, writebufsize);
     return fd;
 }
 
@@ -39,6 +39,19 @@ typedef struct memio_Private memio_Private;
 /* Create the I/O layer and its two circular buffers. */
 PRFileDesc *memio_CreateIOLayer(int readbufsize, int writebufsize);
 
+/* Create the I/O layer, using the caller's memory for its two circular
+ * buffers instead of allocating them.  memio never frees that memory, which
+ * must stay valid until the layer is closed.
+ * This lets the app read from the network straight into the position given
+ * by memio_GetReadParams, and send straight from the positions given by
+ * memio_GetWriteParams, rather than copying through buffers of its own.
+ * memio does not touch the region handed out by memio_GetReadParams, nor the
+ * data handed out by memio_GetWriteParams, until the matching
+ * memio_PutReadResult or memio_PutWriteResult call.
+ */
+PRFileDesc *memio_CreateIOLayerWithBuffers(char *readbuf, int readbufsize,
+                                           char *writebuf, int writebufsize);
+
 /* Must call before trying to make an ssl connection */
 void memio_SetPeerName(PRFileDesc *fd, const PRNetAddr *peername);
 
@@ -6,16 +6,73 @@
 
 #include <limits.h>
 #include <ctype.h>
+#include <string.h>
 #include <algorithm>
 
 #include "base/logging.h"
 #include "base/metrics/histogram.h"
 #include "net/base/sdch_manager.h"
 
+#include "sdch/open-vcdiff/src/google/output_string.h"
 #include "sdch/open-vcdiff/src/google/vcdecoder.h"
 
 namespace net {
 
+namespace {
+
+// Output sink for the VCDIFF decoder that writes decoded bytes straight into
+// the caller's buffer, and only spills what does not fit into |overflow|.
+// This saves staging every decoded byte in a std::string and copying it out
+// again, which matters most when SdchFilter is the last filter in a chain and
+// |dest| is the consumer's own IOBuffer.
+class DirectOutputString : public open_vcdiff::OutputStringInterface {
+ public:
+  DirectOutputString(char* dest, size_t capacity, std::string* overflow)
+      : dest_(dest),
+        capacity_(capacity),
+        written_(0),
+        overflow_(overflow) {
+    DCHECK(overflow_->empty());
+  }
+  virtual ~DirectOutputString() {}
+
+  // Number of bytes written into |dest|.
+  size_t written() const { return written_; }
+
+  // open_vcdiff::OutputStringInterface implementation:
+  virtual open_vcdiff::OutputStringInterface& append(const char* s,
+                                                     size_t n) OVERRIDE {
+    size_t direct = std::min(n, capacity_ - written_);
+    memcpy(dest_ + written_, s, direct);
+    written_ += direct;
+    if (direct < n)
+      overflow_->append(s + direct, n - direct);
+    return *this;
+  }
+  virtual void clear() OVERRIDE {
+    written_ = 0;
+    overflow_->clear();
+  }
+  virtual void push_back(char c) OVERRIDE { append(&c, 1); }
+  virtual void ReserveAdditionalBytes(size_t res_arg) OVERRIDE {
+    if (written_ + res_arg > capacity_)
+      overflow_->reserve(written_ + res_arg - capacity_);
+  }
+  virtual size_t size() const OVERRIDE {
+    return written_ + overflow_->size();
+  }
+
+ private:
+  char* const dest_;
+  const size_t capacity_;
+  size_t written_;
+  std::string* const overflow_;
+
+  DISALLOW_COPY_AND_ASSIGN(DirectOutputString);
+};
+
+}  // namespace
+
 SdchFilter::SdchFilter(const FilterContext& filter_context)
     : filter_context_(filter_context),
       decoding_status_(DECODING_UNINITIALIZED),
@@ -287,13 +344,17 @@ Filter::FilterStatus SdchFilter::ReadFilteredData(char* dest_buffer,
   if (!next_stream_data_ || stream_data_len_ <= 0)
     return FILTER_NEED_MORE_DATA;
 
-  bool ret = vcdiff_streaming_decoder_->DecodeChunk(
-    next_stream_data_, stream_data_len_, &dest_buffer_excess_);
+  // Decode straight into |dest_buffer|; anything that doesn't fit is held in
+  // dest_buffer_excess_ for the next call.
+  DirectOutputString output(dest_buffer, available_space,
+                            &dest_buffer_excess_);
+  bool ret = vcdiff_streaming_decoder_->DecodeChunkToInterface(
+    next_stream_data_, stream_data_len_, &output);
   // Assume all data was used in decoding.
   next_stream_data_ = NULL;
   source_bytes_ += stream_data_len_;
   stream_data_len_ = 0;
-  output_bytes_ += dest_buffer_excess_.size();
+  output_bytes_ += output.size();
   if (!ret) {
     vcdiff_streaming_decoder_.reset(NULL);  // Don't call it again.
     decoding_status_ = DECODING_ERROR;
@@ -301,11 +362,8 @@ Filter::FilterStatus SdchFilter::ReadFilteredData(char* dest_buffer,
     return FILTER_ERROR;
   }
 
-  amount = OutputBufferExcess(dest_buffer, available_space);
-  *dest_len += amount;
-  dest_buffer += amount;
-  available_space -= amount;
-  if (0 == available_space && !dest_buffer_excess_.empty())
+  *dest_len += output.written();
+  if (!dest_buffer_excess_.empty())
       return FILTER_OK;
   return FILTER_NEED_MORE_DATA;
 }
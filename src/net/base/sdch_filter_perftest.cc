@@ -0,0 +1,185 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/format_macros.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/memory/scoped_vector.h"
+#include "base/perftimer.h"
+#include "base/stringprintf.h"
+#include "net/base/filter.h"
+#include "net/base/io_buffer.h"
+#include "net/base/mock_filter_context.h"
+#include "net/base/sdch_manager.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "third_party/zlib/zlib.h"
+
+namespace net {
+
+namespace {
+
+// Number of SDCH responses decoded side by side, all sharing one dictionary.
+const size_t kConcurrentResponses = 64;
+const int kNumIterations = 200;
+// Input is handed to each filter in small slices, and the filters are
+// serviced round robin, to mimic many responses trickling in at once.
+const size_t kInputSliceSize = 16;
+
+// Same dictionary and encoding as in sdch_filter_unittest.cc.
+const char kTestVcdiffDictionary[] = "DictionaryFor"
+    "SdchCompression1SdchCompression2SdchCompression3SdchCompression\n";
+const char kTestData[] = "0000000000000000000000000000000000000000000000"
+    "0000000000000000000000000000TestData "
+    "SdchCompression1SdchCompression2SdchCompression3SdchCompression"
+    "00000000000000000000000000000000000000000000000000000000000000000000000000"
+    "000000000000000000000000000000000000000\n";
+const char kSdchCompressedTestData[] =
+    "\326\303\304\0\0\001M\0\201S\202\004\0\201E\006\001"
+    "00000000000000000000000000000000000000000000000000000000000000000000000000"
+    "TestData 00000000000000000000000000000000000000000000000000000000000000000"
+    "000000000000000000000000000000000000000000000000\n\001S\023\077\001r\r";
+
+const char kDomain[] = "sdch.example.com";
+
+// Wraps |input| in gzip, as a server sending "Content-Encoding: sdch,gzip"
+// would.
+std::string GZipCompress(const std::string& input) {
+  z_stream zlib_stream;
+  memset(&zlib_stream, 0, sizeof(zlib_stream));
+  CHECK_EQ(Z_OK, deflateInit2(&zlib_stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                              MAX_WBITS + 16, 8, Z_DEFAULT_STRATEGY));
+  std::string output(deflateBound(&zlib_stream, input.size()) + 32, '\0');
+  zlib_stream.next_in = bit_cast<Bytef*>(input.data());
+  zlib_stream.avail_in = input.size();
+  zlib_stream.next_out = bit_cast<Bytef*>(&output[0]);
+  zlib_stream.avail_out = output.size();
+  CHECK_EQ(Z_STREAM_END, deflate(&zlib_stream, Z_FINISH));
+  output.resize(output.size() - zlib_stream.avail_out);
+  deflateEnd(&zlib_stream);
+  return output;
+}
+
+class SdchFilterPerfTest : public testing::Test {
+ protected:
+  virtual void SetUp() OVERRIDE {
+    std::string dictionary("Domain: ");
+    dictionary.append(kDomain);
+    dictionary.append("\n\n");
+    dictionary.append(kTestVcdiffDictionary,
+                      sizeof(kTestVcdiffDictionary) - 1);
+    url_ = GURL(std::string("http://") + kDomain);
+    ASSERT_TRUE(sdch_manager_.AddSdchDictionary(dictionary, url_));
+
+    std::string client_hash;
+    std::string server_hash;
+    SdchManager::GenerateHash(dictionary, &client_hash, &server_hash);
+    compressed_ = server_hash;
+    compressed_.append("\0", 1);
+    compressed_.append(kSdchCompressedTestData,
+                       sizeof(kSdchCompressedTestData) - 1);
+  }
+
+  SdchManager sdch_manager_;
+  GURL url_;
+  std::string compressed_;
+};
+
+}  // namespace
+
+TEST_F(SdchFilterPerfTest, ConcurrentDecode) {
+  std::vector<Filter::FilterType> filter_types;
+  filter_types.push_back(Filter::FILTER_TYPE_SDCH);
+  MockFilterContext filter_context;
+  filter_context.SetURL(url_);
+
+  const std::string expanded(kTestData, sizeof(kTestData) - 1);
+  char output_buffer[1024];
+  size_t total_output = 0;
+
+  PerfTimeLogger timer(base::StringPrintf(
+      "SdchFilter_ConcurrentDecode_%" PRIuS, kConcurrentResponses).c_str());
+  for (int i = 0; i < kNumIterations; ++i) {
+    ScopedVector<Filter> filters;
+    std::vector<size_t> consumed(kConcurrentResponses, 0);
+    std::vector<std::string> outputs(kConcurrentResponses);
+    for (size_t j = 0; j < kConcurrentResponses; ++j)
+      filters.push_back(Filter::Factory(filter_types, filter_context));
+
+    bool pending = true;
+    while (pending) {
+      pending = false;
+      for (size_t j = 0; j < kConcurrentResponses; ++j) {
+        size_t remaining = compressed_.size() - consumed[j];
+        if (remaining == 0)
+          continue;
+        size_t slice = std::min(remaining, kInputSliceSize);
+        memcpy(filters[j]->stream_buffer()->data(),
+               compressed_.data() + consumed[j], slice);
+        filters[j]->FlushStreamBuffer(slice);
+        consumed[j] += slice;
+
+        Filter::FilterStatus status;
+        do {
+          int output_size = sizeof(output_buffer);
+          status = filters[j]->ReadData(output_buffer, &output_size);
+          ASSERT_NE(Filter::FILTER_ERROR, status);
+          outputs[j].append(output_buffer, output_size);
+          if (output_size == 0)
+            break;
+        } while (status == Filter::FILTER_OK);
+        pending = pending || consumed[j] < compressed_.size();
+      }
+    }
+
+    for (size_t j = 0; j < kConcurrentResponses; ++j) {
+      ASSERT_EQ(expanded, outputs[j]);
+      total_output += outputs[j].size();
+    }
+  }
+  timer.Done();
+  EXPECT_EQ(kNumIterations * kConcurrentResponses * expanded.size(),
+            total_output);
+}
+
+// Measures the two stage chain used for "Content-Encoding: sdch,gzip", where
+// the gzip filter inflates directly into the SDCH filter's input buffer.
+TEST_F(SdchFilterPerfTest, GZipChain) {
+  std::vector<Filter::FilterType> filter_types;
+  filter_types.push_back(Filter::FILTER_TYPE_SDCH);
+  filter_types.push_back(Filter::FILTER_TYPE_GZIP);
+  MockFilterContext filter_context;
+  filter_context.SetURL(url_);
+
+  const std::string expanded(kTestData, sizeof(kTestData) - 1);
+  const std::string gzipped(GZipCompress(compressed_));
+  char output_buffer[1024];
+
+  PerfTimeLogger timer("SdchFilter_GZipChain");
+  for (size_t i = 0; i < kNumIterations * kConcurrentResponses; ++i) {
+    scoped_ptr<Filter> filter(Filter::Factory(filter_types, filter_context));
+    ASSERT_LE(gzipped.size(),
+              static_cast<size_t>(filter->stream_buffer_size()));
+    memcpy(filter->stream_buffer()->data(), gzipped.data(), gzipped.size());
+    filter->FlushStreamBuffer(gzipped.size());
+
+    std::string output;
+    Filter::FilterStatus status;
+    do {
+      int output_size = sizeof(output_buffer);
+      status = filter->ReadData(output_buffer, &output_size);
+      ASSERT_NE(Filter::FILTER_ERROR, status);
+      output.append(output_buffer, output_size);
+      if (output_size == 0)
+        break;
+    } while (status == Filter::FILTER_OK);
+    ASSERT_EQ(expanded, output);
+  }
+  timer.Done();
+}
+
+}  // namespace net
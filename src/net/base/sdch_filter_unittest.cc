@@ -808,14 +808,6 @@ static std::string gzip_compress(const std::string &input) {
 
 //------------------------------------------------------------------------------
 
-class SdchFilterChainingTest {
- public:
-  static Filter* Factory(const std::vector<Filter::FilterType>& types,
-                           const FilterContext& context, int size) {
-    return Filter::FactoryForTests(types, context, size);
-  }
-};
-
 // Test that filters can be cascaded (chained) so that the output of one filter
 // is processed by the next one.  This is most critical for SDCH, which is
 // routinely followed by gzip (during encoding).  The filter we'll test for will
@@ -848,8 +840,8 @@ TEST_F(SdchFilterTest, FilterChaining) {
   MockFilterContext filter_context;
   filter_context.SetURL(url);
   scoped_ptr<Filter> filter(
-      SdchFilterChainingTest::Factory(filter_types, filter_context,
-                                      kLargeInputBufferSize));
+      Filter::FactoryWithBufferSize(filter_types, filter_context,
+                                    kLargeInputBufferSize));
   EXPECT_EQ(static_cast<int>(kLargeInputBufferSize),
             filter->stream_buffer_size());
 
@@ -877,8 +869,8 @@ TEST_F(SdchFilterTest, FilterChaining) {
   CHECK_LT(kMidSizedInputBufferSize * 2, sdch_compressed.size());
   filter_context.SetURL(url);
   filter.reset(
-      SdchFilterChainingTest::Factory(filter_types, filter_context,
-                                      kMidSizedInputBufferSize));
+      Filter::FactoryWithBufferSize(filter_types, filter_context,
+                                    kMidSizedInputBufferSize));
   EXPECT_EQ(static_cast<int>(kMidSizedInputBufferSize),
             filter->stream_buffer_size());
 
@@ -890,8 +882,8 @@ TEST_F(SdchFilterTest, FilterChaining) {
   EXPECT_EQ(output, expanded_);
 
   // Next try with a tiny input and output buffer to cover edge effects.
-  filter.reset(SdchFilterChainingTest::Factory(filter_types, filter_context,
-                                               kLargeInputBufferSize));
+  filter.reset(Filter::FactoryWithBufferSize(filter_types, filter_context,
+                                             kLargeInputBufferSize));
   EXPECT_EQ(static_cast<int>(kLargeInputBufferSize),
             filter->stream_buffer_size());
 
@@ -1284,21 +1276,96 @@ TEST_F(SdchFilterTest, CanStillSetExactMatchDictionary) {
               GURL("http://" + dictionary_domain)));
 }
 
-// Make sure the DOS protection precludes the addition of too many dictionaries.
+// Make sure the DOS protection bounds the number of dictionaries held, by
+// evicting old ones rather than refusing new ones.
 TEST_F(SdchFilterTest, TooManyDictionaries) {
   std::string dictionary_domain(".google.com");
   std::string dictionary_text(NewSdchDictionary(dictionary_domain));
+  const GURL url("http://www.google.com");
+
+  for (size_t i = 0; i < SdchManager::kMaxDictionaryCount + 2; ++i) {
+    EXPECT_TRUE(sdch_manager_->AddSdchDictionary(dictionary_text, url));
+    EXPECT_LE(sdch_manager_->dictionary_count(),
+              SdchManager::kMaxDictionaryCount);
+    dictionary_text += " ";  // Create dictionary with different SHA signature.
+  }
+  EXPECT_EQ(SdchManager::kMaxDictionaryCount,
+            sdch_manager_->dictionary_count());
+}
 
-  size_t count = 0;
-  while (count <= SdchManager::kMaxDictionaryCount + 1) {
-    if (!sdch_manager_->AddSdchDictionary(dictionary_text,
-                                          GURL("http://www.google.com")))
-      break;
+TEST_F(SdchFilterTest, LeastRecentlyUsedDictionaryIsEvicted) {
+  const GURL url("http://www.google.com");
+  sdch_manager_->set_max_dictionary_count(2);
 
+  std::string dictionary_text(NewSdchDictionary(".google.com"));
+  std::string server_hashes[3];
+  for (size_t i = 0; i < arraysize(server_hashes); ++i) {
+    std::string client_hash;
+    SdchManager::GenerateHash(dictionary_text, &client_hash,
+                              &server_hashes[i]);
     dictionary_text += " ";  // Create dictionary with different SHA signature.
-    ++count;
   }
-  EXPECT_EQ(SdchManager::kMaxDictionaryCount, count);
+
+  dictionary_text = NewSdchDictionary(".google.com");
+  EXPECT_TRUE(sdch_manager_->AddSdchDictionary(dictionary_text, url));
+  dictionary_text += " ";
+  EXPECT_TRUE(sdch_manager_->AddSdchDictionary(dictionary_text, url));
+
+  // Use the first dictionary, so that the second becomes the oldest.
+  SdchManager::Dictionary* dictionary = NULL;
+  sdch_manager_->GetVcdiffDictionary(server_hashes[0], url, &dictionary);
+  EXPECT_TRUE(dictionary != NULL);
+
+  dictionary_text += " ";
+  EXPECT_TRUE(sdch_manager_->AddSdchDictionary(dictionary_text, url));
+  EXPECT_EQ(2u, sdch_manager_->dictionary_count());
+
+  sdch_manager_->GetVcdiffDictionary(server_hashes[0], url, &dictionary);
+  EXPECT_TRUE(dictionary != NULL);
+  sdch_manager_->GetVcdiffDictionary(server_hashes[1], url, &dictionary);
+  EXPECT_TRUE(dictionary == NULL);
+  sdch_manager_->GetVcdiffDictionary(server_hashes[2], url, &dictionary);
+  EXPECT_TRUE(dictionary != NULL);
+
+  // Lowering the limit evicts down to the new size.
+  sdch_manager_->set_max_dictionary_count(1);
+  EXPECT_EQ(1u, sdch_manager_->dictionary_count());
+  sdch_manager_->GetVcdiffDictionary(server_hashes[2], url, &dictionary);
+  EXPECT_TRUE(dictionary != NULL);
+}
+
+// A filter that is already decoding keeps its dictionary alive even after the
+// manager evicts it.
+TEST_F(SdchFilterTest, EvictionDuringDecode) {
+  std::string dictionary_domain("x.y.z.google.com");
+  std::string dictionary(NewSdchDictionary(dictionary_domain));
+  std::string url_string = "http://" + dictionary_domain;
+  GURL url(url_string);
+  EXPECT_TRUE(sdch_manager_->AddSdchDictionary(dictionary, url));
+
+  std::string compressed(NewSdchCompressedData(dictionary));
+
+  std::vector<Filter::FilterType> filter_types;
+  filter_types.push_back(Filter::FILTER_TYPE_SDCH);
+  MockFilterContext filter_context;
+  filter_context.SetURL(url);
+  scoped_ptr<Filter> filter(Filter::Factory(filter_types, filter_context));
+
+  // Feed in just the server hash (8 characters plus a null), which is enough
+  // for the filter to select and reference the dictionary.
+  const size_t kHashLength = 9;
+  std::string output;
+  EXPECT_TRUE(FilterTestData(compressed.substr(0, kHashLength), kHashLength,
+                             100, filter.get(), &output));
+  EXPECT_TRUE(output.empty());
+
+  sdch_manager_->set_max_dictionary_count(0);
+  EXPECT_EQ(0u, sdch_manager_->dictionary_count());
+
+  std::string remainder(compressed.substr(kHashLength));
+  EXPECT_TRUE(FilterTestData(remainder, remainder.size(), 100, filter.get(),
+                             &output));
+  EXPECT_EQ(expanded_, output);
 }
 
 TEST_F(SdchFilterTest, DictionaryNotTooLarge) {
@@ -43,7 +43,8 @@ SdchManager::Dictionary::Dictionary(const std::string& dictionary_text,
       domain_(domain),
       path_(path),
       expiration_(expiration),
-      ports_(ports) {
+      ports_(ports),
+      last_used_(0) {
 }
 
 SdchManager::Dictionary::~Dictionary() {
@@ -206,7 +207,10 @@ bool SdchManager::Dictionary::DomainMatch(const GURL& gurl,
 }
 
 //------------------------------------------------------------------------------
-SdchManager::SdchManager() {
+SdchManager::SdchManager()
+    : max_dictionary_size_(kMaxDictionarySize),
+      max_dictionary_count_(kMaxDictionaryCount),
+      use_sequence_(0) {
   DCHECK(!global_);
   DCHECK(CalledOnValidThread());
   global_ = this;
@@ -447,18 +451,20 @@ bool SdchManager::AddSdchDictionary(const std::string& dictionary_text,
   if (!Dictionary::CanSet(domain, path, ports, dictionary_url))
     return false;
 
-  // TODO(jar): Remove these hacks to preclude a DOS attack involving piles of
-  // useless dictionaries.  We should probably have a cache eviction plan,
-  // instead of just blocking additions.  For now, with the spec in flux, it
-  // is probably not worth doing eviction handling.
-  if (kMaxDictionarySize < dictionary_text.size()) {
+  // Preclude a DOS attack involving piles of useless dictionaries: cap the
+  // size of each one, and recycle the least recently used slot when full.
+  if (max_dictionary_size_ < dictionary_text.size()) {
     SdchErrorRecovery(DICTIONARY_IS_TOO_LARGE);
     return false;
   }
-  if (kMaxDictionaryCount <= dictionaries_.size()) {
+  if (max_dictionary_count_ == 0) {
     SdchErrorRecovery(DICTIONARY_COUNT_EXCEEDED);
     return false;
   }
+  while (max_dictionary_count_ <= dictionaries_.size()) {
+    SdchErrorRecovery(DICTIONARY_EVICTED_TO_MAKE_ROOM);
+    EvictLeastRecentlyUsedDictionary();
+  }
 
   UMA_HISTOGRAM_COUNTS("Sdch3.Dictionary size loaded", dictionary_text.size());
   DVLOG(1) << "Loaded dictionary with client hash " << client_hash
@@ -467,6 +473,7 @@ bool SdchManager::AddSdchDictionary(const std::string& dictionary_text,
       new Dictionary(dictionary_text, header_end + 2, client_hash,
                      dictionary_url, domain, path, expiration, ports);
   dictionary->AddRef();
+  dictionary->set_last_used(++use_sequence_);
   dictionaries_[server_hash] = dictionary;
   return true;
 }
@@ -482,12 +489,27 @@ void SdchManager::GetVcdiffDictionary(const std::string& server_hash,
   Dictionary* matching_dictionary = it->second;
   if (!matching_dictionary->CanUse(referring_url))
     return;
+  matching_dictionary->set_last_used(++use_sequence_);
   *dictionary = matching_dictionary;
 }
 
-// TODO(jar): If we have evictions from the dictionaries_, then we need to
-// change this interface to return a list of reference counted Dictionary
-// instances that can be used if/when a server specifies one.
+void SdchManager::set_max_dictionary_size(size_t size) {
+  DCHECK(CalledOnValidThread());
+  // Dictionaries already loaded stay; the limit applies to later additions.
+  max_dictionary_size_ = size;
+}
+
+void SdchManager::set_max_dictionary_count(size_t count) {
+  DCHECK(CalledOnValidThread());
+  max_dictionary_count_ = count;
+  while (dictionaries_.size() > max_dictionary_count_)
+    EvictLeastRecentlyUsedDictionary();
+}
+
+// TODO(jar): Now that we have evictions from the dictionaries_, a dictionary
+// advertised here may be gone by the time the server references it.  We
+// should change this interface to return a list of reference counted
+// Dictionary instances that can be used if/when a server specifies one.
 void SdchManager::GetAvailDictionaryList(const GURL& target_url,
                                          std::string* list) {
   DCHECK(CalledOnValidThread());
@@ -543,6 +565,22 @@ void SdchManager::SetAllowLatencyExperiment(const GURL& url, bool enable) {
   allow_latency_experiment_.erase(it);
 }
 
+void SdchManager::EvictLeastRecentlyUsedDictionary() {
+  DCHECK(!dictionaries_.empty());
+  // The map is small (bounded by |max_dictionary_count_|), so a linear scan
+  // is cheaper than maintaining a separate recency list.
+  DictionaryMap::iterator oldest = dictionaries_.begin();
+  for (DictionaryMap::iterator it = dictionaries_.begin();
+       it != dictionaries_.end(); ++it) {
+    if (it->second->last_used() < oldest->second->last_used())
+      oldest = it;
+  }
+  DVLOG(1) << "Evicting dictionary with client hash "
+           << oldest->second->client_hash();
+  oldest->second->Release();
+  dictionaries_.erase(oldest);
+}
+
 // static
 void SdchManager::UrlSafeBase64Encode(const std::string& input,
                                       std::string* output) {
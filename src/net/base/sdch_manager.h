@@ -106,6 +106,7 @@ class NET_EXPORT SdchManager : public NON_EXPORTED_BASE(base::NonThreadSafe) {
     DICTIONARY_COUNT_EXCEEDED = 35,
     DICTIONARY_ALREADY_SCHEDULED_TO_DOWNLOAD = 36,
     DICTIONARY_ALREADY_TRIED_TO_DOWNLOAD = 37,
+    DICTIONARY_EVICTED_TO_MAKE_ROOM = 38,
 
     // Failsafe hack.
     ATTEMPT_TO_DECODE_NON_HTTP_DATA = 40,
@@ -155,8 +156,11 @@ class NET_EXPORT SdchManager : public NON_EXPORTED_BASE(base::NonThreadSafe) {
     MAX_PROBLEM_CODE  // Used to bound histogram.
   };
 
-  // Use the following static limits to block DOS attacks until we implement
-  // a cached dictionary evicition strategy.
+  // Default limits used to block DOS attacks.  Dictionaries larger than the
+  // size limit are rejected, and once the count limit is reached the least
+  // recently used dictionary is evicted to make room for a new one.  Both
+  // limits can be changed per instance with set_max_dictionary_size() and
+  // set_max_dictionary_count().
   static const size_t kMaxDictionarySize;
   static const size_t kMaxDictionaryCount;
 
@@ -188,6 +192,12 @@ class NET_EXPORT SdchManager : public NON_EXPORTED_BASE(base::NonThreadSafe) {
     const GURL& url() const { return url_; }
     const std::string& client_hash() const { return client_hash_; }
 
+    // Sequence number of the last time this dictionary was added or selected
+    // for decoding.  Used by the manager to find the least recently used
+    // dictionary when it needs to evict one.
+    int64 last_used() const { return last_used_; }
+    void set_last_used(int64 last_used) { last_used_ = last_used; }
+
     // Security method to check if we can advertise this dictionary for use
     // if the |target_url| returns SDCH compressed data.
     bool CanAdvertise(const GURL& target_url);
@@ -228,6 +238,8 @@ class NET_EXPORT SdchManager : public NON_EXPORTED_BASE(base::NonThreadSafe) {
     const base::Time expiration_;  // Implied by max-age.
     const std::set<int> ports_;
 
+    int64 last_used_;
+
     DISALLOW_COPY_AND_ASSIGN(Dictionary);
   };
 
@@ -312,6 +324,19 @@ class NET_EXPORT SdchManager : public NON_EXPORTED_BASE(base::NonThreadSafe) {
                            const GURL& referring_url,
                            Dictionary** dictionary);
 
+  // Limits on the size of any one dictionary, and on the number of
+  // dictionaries held in memory.  Lowering the count limit evicts the least
+  // recently used dictionaries until the new limit is met.  Filters that are
+  // already decoding with an evicted dictionary keep their own reference to
+  // it, so eviction never disturbs a response that is in flight.
+  size_t max_dictionary_size() const { return max_dictionary_size_; }
+  void set_max_dictionary_size(size_t size);
+  size_t max_dictionary_count() const { return max_dictionary_count_; }
+  void set_max_dictionary_count(size_t count);
+
+  // Number of dictionaries currently held in memory.
+  size_t dictionary_count() const { return dictionaries_.size(); }
+
   // Get list of available (pre-cached) dictionaries that we have already loaded
   // into memory.  The list is a comma separated list of (client) hashes per
   // the SDCH spec.
@@ -347,8 +372,21 @@ class NET_EXPORT SdchManager : public NON_EXPORTED_BASE(base::NonThreadSafe) {
   // A simple implementation of a RFC 3548 "URL safe" base64 encoder.
   static void UrlSafeBase64Encode(const std::string& input,
                                   std::string* output);
+
+  // Release the least recently used dictionary.  |dictionaries_| must not be
+  // empty.
+  void EvictLeastRecentlyUsedDictionary();
+
   DictionaryMap dictionaries_;
 
+  // See set_max_dictionary_size() and set_max_dictionary_count().
+  size_t max_dictionary_size_;
+  size_t max_dictionary_count_;
+
+  // Incremented each time a dictionary is added or used, and stamped on that
+  // dictionary to order |dictionaries_| by recency of use.
+  int64 use_sequence_;
+
   // An instance that can fetch a dictionary given a URL.
   scoped_ptr<SdchFetcher> fetcher_;
 
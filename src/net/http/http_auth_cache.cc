@@ -4,6 +4,8 @@
 
 #include "net/http/http_auth_cache.h"
 
+#include <algorithm>
+
 #include "base/logging.h"
 #include "base/string_util.h"
 
@@ -61,53 +63,81 @@ struct IsEnclosedBy {
 
 namespace net {
 
-HttpAuthCache::HttpAuthCache() {
+HttpAuthCache::HttpAuthCache()
+    : max_entries_(kMaxNumRealmEntries),
+      max_paths_per_entry_(kMaxNumPathsPerRealmEntry),
+      num_evicted_entries_(0),
+      num_evicted_paths_(0) {
+}
+
+HttpAuthCache::HttpAuthCache(size_t max_entries, size_t max_paths_per_entry)
+    : max_entries_(max_entries),
+      max_paths_per_entry_(max_paths_per_entry),
+      num_evicted_entries_(0),
+      num_evicted_paths_(0) {
+  DCHECK_GT(max_entries_, 0u);
+  DCHECK_GT(max_paths_per_entry_, 0u);
 }
 
 HttpAuthCache::~HttpAuthCache() {
 }
 
-// Performance: O(n), where n is the number of realm entries.
+// Performance: O(log n + k), where n is the number of origins and k is the
+// number of realm entries for |origin|.
 HttpAuthCache::Entry* HttpAuthCache::Lookup(const GURL& origin,
                                             const std::string& realm,
                                             HttpAuth::Scheme scheme) {
   CheckOriginIsValid(origin);
 
-  // Linear scan through the realm entries.
-  for (EntryList::iterator it = entries_.begin(); it != entries_.end(); ++it) {
-    if (it->origin() == origin && it->realm() == realm &&
-        it->scheme() == scheme)
-      return &(*it);
+  OriginIndex::iterator origin_it = index_.find(origin);
+  if (origin_it == index_.end())
+    return NULL;
+
+  // Linear scan through the origin's realm entries.
+  OriginEntries& origin_entries = origin_it->second;
+  for (OriginEntries::iterator it = origin_entries.begin();
+       it != origin_entries.end(); ++it) {
+    if ((*it)->realm() == realm && (*it)->scheme() == scheme)
+      return MarkUsed(&origin_entries, it);
   }
   return NULL;  // No realm entry found.
 }
 
-// Performance: O(n*m), where n is the number of realm entries, m is the number
-// of path entries per realm. Both n amd m are expected to be small; m is
-// kept small because AddPath() only keeps the shallowest entry.
+// Performance: O(log n + k*m), where n is the number of origins, k is the
+// number of realm entries for |origin| and m is the number of path entries
+// per realm. Both k and m are expected to be small; m is kept small because
+// AddPath() only keeps the shallowest entry.
 HttpAuthCache::Entry* HttpAuthCache::LookupByPath(const GURL& origin,
                                                   const std::string& path) {
-  HttpAuthCache::Entry* best_match = NULL;
-  size_t best_match_length = 0;
   CheckOriginIsValid(origin);
   CheckPathIsValid(path);
 
+  OriginIndex::iterator origin_it = index_.find(origin);
+  if (origin_it == index_.end())
+    return NULL;
+
   // RFC 2617 section 2:
   // A client SHOULD assume that all paths at or deeper than the depth of
   // the last symbolic element in the path field of the Request-URI also are
   // within the protection space ...
   std::string parent_dir = GetParentDirectory(path);
 
-  // Linear scan through the realm entries.
-  for (EntryList::iterator it = entries_.begin(); it != entries_.end(); ++it) {
+  // Linear scan through the origin's realm entries.
+  OriginEntries& origin_entries = origin_it->second;
+  OriginEntries::iterator best_match = origin_entries.end();
+  size_t best_match_length = 0;
+  for (OriginEntries::iterator it = origin_entries.begin();
+       it != origin_entries.end(); ++it) {
     size_t len = 0;
-    if (it->origin() == origin && it->HasEnclosingPath(parent_dir, &len) &&
-        (!best_match || len > best_match_length)) {
+    if ((*it)->HasEnclosingPath(parent_dir, &len) &&
+        (best_match == origin_entries.end() || len > best_match_length)) {
       best_match_length = len;
-      best_match = &(*it);
+      best_match = it;
     }
   }
-  return best_match;
+  if (best_match == origin_entries.end())
+    return NULL;
+  return MarkUsed(&origin_entries, best_match);
 }
 
 HttpAuthCache::Entry* HttpAuthCache::Add(const GURL& origin,
@@ -123,9 +153,10 @@ HttpAuthCache::Entry* HttpAuthCache::Add(const GURL& origin,
   HttpAuthCache::Entry* entry = Lookup(origin, realm, scheme);
   if (!entry) {
     // Failsafe to prevent unbounded memory growth of the cache.
-    if (entries_.size() >= kMaxNumRealmEntries) {
+    if (entries_.size() >= max_entries_) {
       LOG(WARNING) << "Num auth cache entries reached limit -- evicting";
-      entries_.pop_back();
+      RemoveEntry(--entries_.end());
+      ++num_evicted_entries_;
     }
 
     entries_.push_front(Entry());
@@ -133,6 +164,10 @@ HttpAuthCache::Entry* HttpAuthCache::Add(const GURL& origin,
     entry->origin_ = origin;
     entry->realm_ = realm;
     entry->scheme_ = scheme;
+    entry->max_paths_ = max_paths_per_entry_;
+
+    OriginEntries& origin_entries = index_[origin];
+    origin_entries.insert(origin_entries.begin(), entries_.begin());
   }
   DCHECK_EQ(origin, entry->origin_);
   DCHECK_EQ(realm, entry->realm_);
@@ -141,7 +176,7 @@ HttpAuthCache::Entry* HttpAuthCache::Add(const GURL& origin,
   entry->auth_challenge_ = auth_challenge;
   entry->credentials_ = credentials;
   entry->nonce_count_ = 1;
-  entry->AddPath(path);
+  AddPathToEntry(entry, path);
 
   return entry;
 }
@@ -157,25 +192,29 @@ void HttpAuthCache::Entry::UpdateStaleChallenge(
 
 HttpAuthCache::Entry::Entry()
     : scheme_(HttpAuth::AUTH_SCHEME_MAX),
-      nonce_count_(0) {
+      nonce_count_(0),
+      max_paths_(kMaxNumPathsPerRealmEntry) {
 }
 
-void HttpAuthCache::Entry::AddPath(const std::string& path) {
+bool HttpAuthCache::Entry::AddPath(const std::string& path) {
+  bool evicted = false;
   std::string parent_dir = GetParentDirectory(path);
   if (!HasEnclosingPath(parent_dir, NULL)) {
     // Remove any entries that have been subsumed by the new entry.
     paths_.remove_if(IsEnclosedBy(parent_dir));
 
     // Failsafe to prevent unbounded memory growth of the cache.
-    if (paths_.size() >= kMaxNumPathsPerRealmEntry) {
+    if (paths_.size() >= max_paths_) {
       LOG(WARNING) << "Num path entries for " << origin()
                    << " has grown too large -- evicting";
       paths_.pop_back();
+      evicted = true;
     }
 
     // Add new path.
     paths_.push_front(parent_dir);
   }
+  return evicted;
 }
 
 bool HttpAuthCache::Entry::HasEnclosingPath(const std::string& dir,
@@ -200,11 +239,16 @@ bool HttpAuthCache::Remove(const GURL& origin,
                            const std::string& realm,
                            HttpAuth::Scheme scheme,
                            const AuthCredentials& credentials) {
-  for (EntryList::iterator it = entries_.begin(); it != entries_.end(); ++it) {
-    if (it->origin() == origin && it->realm() == realm &&
-        it->scheme() == scheme) {
-      if (credentials.Equals(it->credentials())) {
-        entries_.erase(it);
+  OriginIndex::iterator origin_it = index_.find(origin);
+  if (origin_it == index_.end())
+    return false;
+
+  const OriginEntries& origin_entries = origin_it->second;
+  for (OriginEntries::const_iterator it = origin_entries.begin();
+       it != origin_entries.end(); ++it) {
+    if ((*it)->realm() == realm && (*it)->scheme() == scheme) {
+      if (credentials.Equals((*it)->credentials())) {
+        RemoveEntry(*it);
         return true;
       }
       return false;
@@ -225,8 +269,10 @@ bool HttpAuthCache::UpdateStaleChallenge(const GURL& origin,
 }
 
 void HttpAuthCache::UpdateAllFrom(const HttpAuthCache& other) {
-  for (EntryList::const_iterator it = other.entries_.begin();
-       it != other.entries_.end(); ++it) {
+  // Walk |other| from least to most recently used, so that each Add() leaves
+  // the copied entries in the same recency order as in |other|.
+  for (EntryList::const_reverse_iterator it = other.entries_.rbegin();
+       it != other.entries_.rend(); ++it) {
     // Add an Entry with one of the original entry's paths.
     DCHECK(it->paths_.size() > 0);
     Entry* entry = Add(it->origin(), it->realm(), it->scheme(),
@@ -235,10 +281,36 @@ void HttpAuthCache::UpdateAllFrom(const HttpAuthCache& other) {
     // Copy all other paths.
     for (Entry::PathList::const_reverse_iterator it2 = ++it->paths_.rbegin();
          it2 != it->paths_.rend(); ++it2)
-      entry->AddPath(*it2);
+      AddPathToEntry(entry, *it2);
     // Copy nonce count (for digest authentication).
     entry->nonce_count_ = it->nonce_count_;
   }
 }
 
+HttpAuthCache::Entry* HttpAuthCache::MarkUsed(OriginEntries* origin_entries,
+                                              OriginEntries::iterator it) {
+  EntryList::iterator entry = *it;
+  entries_.splice(entries_.begin(), entries_, entry);
+  std::rotate(origin_entries->begin(), it, it + 1);
+  return &(*entry);
+}
+
+void HttpAuthCache::RemoveEntry(EntryList::iterator entry) {
+  OriginIndex::iterator origin_it = index_.find(entry->origin());
+  DCHECK(origin_it != index_.end());
+  OriginEntries& origin_entries = origin_it->second;
+  OriginEntries::iterator it =
+      std::find(origin_entries.begin(), origin_entries.end(), entry);
+  DCHECK(it != origin_entries.end());
+  origin_entries.erase(it);
+  if (origin_entries.empty())
+    index_.erase(origin_it);
+  entries_.erase(entry);
+}
+
+void HttpAuthCache::AddPathToEntry(Entry* entry, const std::string& path) {
+  if (entry->AddPath(path))
+    ++num_evicted_paths_;
+}
+
 }  // namespace net
@@ -6,8 +6,11 @@
 #define NET_HTTP_HTTP_AUTH_CACHE_H_
 
 #include <list>
+#include <map>
 #include <string>
+#include <vector>
 
+#include "base/basictypes.h"
 #include "base/gtest_prod_util.h"
 #include "base/memory/ref_counted.h"
 #include "googleurl/src/gurl.h"
@@ -24,18 +27,24 @@ namespace net {
 //   - the last auth handler used (contains realm and authentication scheme)
 //   - the list of paths which used this realm
 // Entries can be looked up by either (origin, realm, scheme) or (origin, path).
+// Entries are indexed by origin, so lookups only consider the realms of the
+// requested server.  When the cache is full, the least recently used entry
+// is evicted.
 class NET_EXPORT_PRIVATE HttpAuthCache {
  public:
   class Entry;
 
-  // Prevent unbounded memory growth. These are safeguards for abuse; it is
-  // not expected that the limits will be reached in ordinary usage.
-  // This also defines the worst-case lookup times (which grow linearly
-  // with number of elements in the cache).
+  // Default limits, to prevent unbounded memory growth. These are safeguards
+  // for abuse; it is not expected that the limits will be reached in ordinary
+  // usage.  Clients that authenticate against many servers (e.g. through an
+  // authenticating proxy on a large intranet) can raise them.
   enum { kMaxNumPathsPerRealmEntry = 10 };
   enum { kMaxNumRealmEntries = 10 };
 
   HttpAuthCache();
+  // Creates a cache that holds at most |max_entries| realm entries, each of
+  // which remembers at most |max_paths_per_entry| paths.
+  HttpAuthCache(size_t max_entries, size_t max_paths_per_entry);
   ~HttpAuthCache();
 
   // Find the realm entry on server |origin| for realm |realm| and
@@ -100,9 +109,42 @@ class NET_EXPORT_PRIVATE HttpAuthCache {
   // Copies all entries from |other| cache.
   void UpdateAllFrom(const HttpAuthCache& other);
 
+  size_t max_entries() const { return max_entries_; }
+  size_t max_paths_per_entry() const { return max_paths_per_entry_; }
+
+  // The number of realm entries and paths evicted so far to stay within the
+  // limits above.  A steadily growing count means the limits are too small
+  // for the workload, and credentials are being re-requested as a result.
+  size_t num_evicted_entries() const { return num_evicted_entries_; }
+  size_t num_evicted_paths() const { return num_evicted_paths_; }
+
  private:
+  // All entries, most recently used first.
   typedef std::list<Entry> EntryList;
+  // The entries of a single origin, most recently used first.
+  typedef std::vector<EntryList::iterator> OriginEntries;
+  typedef std::map<GURL, OriginEntries> OriginIndex;
+
+  // Moves |*it| to the front of both |entries_| and |*origin_entries|, and
+  // returns the entry.
+  Entry* MarkUsed(OriginEntries* origin_entries, OriginEntries::iterator it);
+
+  // Removes |entry| from |entries_| and |index_|.
+  void RemoveEntry(EntryList::iterator entry);
+
+  // Adds |path| to |entry|, keeping track of any evicted paths.
+  void AddPathToEntry(Entry* entry, const std::string& path);
+
   EntryList entries_;
+  OriginIndex index_;
+
+  const size_t max_entries_;
+  const size_t max_paths_per_entry_;
+
+  size_t num_evicted_entries_;
+  size_t num_evicted_paths_;
+
+  DISALLOW_COPY_AND_ASSIGN(HttpAuthCache);
 };
 
 // An authentication realm entry.
@@ -150,8 +192,9 @@ class NET_EXPORT_PRIVATE HttpAuthCache::Entry {
   Entry();
 
   // Adds a path defining the realm's protection space. If the path is
-  // already contained in the protection space, is a no-op.
-  void AddPath(const std::string& path);
+  // already contained in the protection space, is a no-op.  Returns true if
+  // an older path had to be evicted to make room for it.
+  bool AddPath(const std::string& path);
 
   // Returns true if |dir| is contained within the realm's protection
   // space.  |*path_len| is set to the length of the enclosing path if
@@ -176,6 +219,9 @@ class NET_EXPORT_PRIVATE HttpAuthCache::Entry {
 
   // List of paths that define the realm's protection space.
   PathList paths_;
+
+  // The maximum size of |paths_|.
+  size_t max_paths_;
 };
 
 }  // namespace net
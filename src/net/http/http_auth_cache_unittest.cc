@@ -621,6 +621,96 @@ TEST_F(HttpAuthCacheEvictionTest, RealmPathEviction) {
 
   for (int i = 0; i < kMaxRealms; ++i)
     CheckRealmExistence(i, true);
+
+  EXPECT_EQ(0u, cache_.num_evicted_entries());
+  EXPECT_EQ(3u, cache_.num_evicted_paths());
+}
+
+// Entries that are looked up are kept in the cache in preference to entries
+// that haven't been used recently.
+TEST_F(HttpAuthCacheEvictionTest, RealmEntryLRUEviction) {
+  for (int i = 0; i < kMaxRealms; ++i)
+    AddRealm(i);
+
+  // Use the oldest entry, by realm and by path.
+  CheckRealmExistence(0, true);
+  CheckPathExistence(1, 0, true);
+
+  AddRealm(kMaxRealms);
+
+  CheckRealmExistence(0, true);
+  CheckRealmExistence(1, true);
+  CheckRealmExistence(2, false);
+  CheckRealmExistence(kMaxRealms, true);
+  EXPECT_EQ(1u, cache_.num_evicted_entries());
+}
+
+// Entries copied by UpdateAllFrom() keep their recency order, so the least
+// recently used entry of the source cache is the first one evicted.
+TEST_F(HttpAuthCacheEvictionTest, UpdateAllFromKeepsLRUOrder) {
+  HttpAuthCache other;
+  for (int i = 0; i < kMaxRealms; ++i) {
+    other.Add(origin_, GenerateRealm(i), HttpAuth::AUTH_SCHEME_BASIC,
+              std::string(), AuthCredentials(kUsername, kPassword),
+              GeneratePath(i, 0));
+  }
+
+  cache_.UpdateAllFrom(other);
+  AddRealm(kMaxRealms);
+
+  CheckRealmExistence(0, false);
+  for (int i = 1; i <= kMaxRealms; ++i)
+    CheckRealmExistence(i, true);
+  EXPECT_EQ(1u, cache_.num_evicted_entries());
+}
+
+// Test that the limits passed to the constructor are honored.
+TEST(HttpAuthCacheTest, ConfigurableLimits) {
+  const size_t kMaxEntries = 50;
+  const size_t kMaxPaths = 2;
+  HttpAuthCache cache(kMaxEntries, kMaxPaths);
+  EXPECT_EQ(kMaxEntries, cache.max_entries());
+  EXPECT_EQ(kMaxPaths, cache.max_paths_per_entry());
+
+  // Spread the entries over many origins.
+  for (size_t i = 0; i < kMaxEntries; ++i) {
+    GURL origin(base::StringPrintf("http://host%d.example.com",
+                                   static_cast<int>(i)));
+    cache.Add(origin, kRealm1, HttpAuth::AUTH_SCHEME_BASIC,
+              "basic realm=Realm1", CreateASCIICredentials("foo", "bar"),
+              "/a/x");
+  }
+  EXPECT_EQ(0u, cache.num_evicted_entries());
+
+  for (size_t i = 0; i < kMaxEntries; ++i) {
+    GURL origin(base::StringPrintf("http://host%d.example.com",
+                                   static_cast<int>(i)));
+    EXPECT_TRUE(cache.Lookup(origin, kRealm1, HttpAuth::AUTH_SCHEME_BASIC));
+    EXPECT_TRUE(cache.LookupByPath(origin, "/a/y"));
+    EXPECT_FALSE(cache.Lookup(origin, kRealm2, HttpAuth::AUTH_SCHEME_BASIC));
+  }
+
+  GURL origin("http://host0.example.com");
+  HttpAuthCache::Entry* entry = cache.Add(
+      origin, kRealm1, HttpAuth::AUTH_SCHEME_BASIC, "basic realm=Realm1",
+      CreateASCIICredentials("foo", "bar"), "/b/x");
+  ASSERT_TRUE(entry);
+  cache.Add(origin, kRealm1, HttpAuth::AUTH_SCHEME_BASIC, "basic realm=Realm1",
+            CreateASCIICredentials("foo", "bar"), "/c/x");
+  EXPECT_EQ(1u, cache.num_evicted_paths());
+  EXPECT_FALSE(cache.LookupByPath(origin, "/a/y"));
+  EXPECT_EQ(entry, cache.LookupByPath(origin, "/b/y"));
+  EXPECT_EQ(entry, cache.LookupByPath(origin, "/c/y"));
+
+  // Adding a realm to a new origin evicts the least recently used entry,
+  // which is now host1's.
+  cache.Add(GURL("http://other.example.com"), kRealm1,
+            HttpAuth::AUTH_SCHEME_BASIC, "basic realm=Realm1",
+            CreateASCIICredentials("foo", "bar"), "/");
+  EXPECT_EQ(1u, cache.num_evicted_entries());
+  EXPECT_FALSE(cache.Lookup(GURL("http://host1.example.com"), kRealm1,
+                            HttpAuth::AUTH_SCHEME_BASIC));
+  EXPECT_TRUE(cache.Lookup(origin, kRealm1, HttpAuth::AUTH_SCHEME_BASIC));
 }
 
 }  // namespace net
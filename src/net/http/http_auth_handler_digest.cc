@@ -12,15 +12,36 @@
 #include "base/rand_util.h"
 #include "base/string_util.h"
 #include "base/stringprintf.h"
+#include "base/strings/string_piece.h"
 #include "base/utf_string_conversions.h"
 #include "net/base/net_errors.h"
 #include "net/base/net_util.h"
+#include "net/base/zap.h"
 #include "net/http/http_auth.h"
 #include "net/http/http_request_info.h"
 #include "net/http/http_util.h"
 
 namespace net {
 
+namespace {
+
+// Returns the hex-encoded MD5 of |parts| joined with ':'.  The parts are fed
+// to MD5 one at a time rather than being concatenated first.
+std::string MD5OfJoinedParts(const base::StringPiece* parts, size_t count) {
+  base::MD5Context ctx;
+  base::MD5Init(&ctx);
+  for (size_t i = 0; i < count; ++i) {
+    if (i > 0)
+      base::MD5Update(&ctx, ":");
+    base::MD5Update(&ctx, parts[i]);
+  }
+  base::MD5Digest digest;
+  base::MD5Final(&digest, &ctx);
+  return base::MD5DigestToBase16(digest);
+}
+
+}  // namespace
+
 // Digest authentication is specified in RFC 2617.
 // The expanded derivations are listed in the tables below.
 
@@ -164,6 +185,10 @@ HttpAuthHandlerDigest::HttpAuthHandlerDigest(
 }
 
 HttpAuthHandlerDigest::~HttpAuthHandlerDigest() {
+  // H(A1) is as good as the password for Digest, so don't leave it behind in
+  // freed memory either.
+  ZapString(&user_realm_password_hash_);
+  hashed_credentials_.Zap();
 }
 
 // The digest challenge header looks like:
@@ -195,6 +220,8 @@ bool HttpAuthHandlerDigest::ParseChallenge(
   algorithm_ = ALGORITHM_UNSPECIFIED;
   qop_ = QOP_UNSPECIFIED;
   realm_ = original_realm_ = nonce_ = domain_ = opaque_ = std::string();
+  ZapString(&user_realm_password_hash_);
+  user_realm_password_hash_.clear();
 
   // FAIL -- Couldn't match auth-scheme.
   if (!LowerCaseEqualsASCII(challenge->scheme(), "digest"))
@@ -313,6 +340,21 @@ void HttpAuthHandlerDigest::GetRequestMethodAndPath(
   }
 }
 
+const std::string& HttpAuthHandlerDigest::GetUserRealmPasswordHash(
+    const AuthCredentials& credentials) const {
+  if (user_realm_password_hash_.empty() ||
+      !hashed_credentials_.Equals(credentials)) {
+    // TODO(eroman): is this the right encoding?
+    std::string username = UTF16ToUTF8(credentials.username());
+    std::string password = UTF16ToUTF8(credentials.password());
+    const base::StringPiece parts[] = { username, original_realm_, password };
+    ZapString(&user_realm_password_hash_);
+    user_realm_password_hash_ = MD5OfJoinedParts(parts, arraysize(parts));
+    hashed_credentials_ = credentials;
+  }
+  return user_realm_password_hash_;
+}
+
 std::string HttpAuthHandlerDigest::AssembleResponseDigest(
     const std::string& method,
     const std::string& path,
@@ -320,23 +362,24 @@ std::string HttpAuthHandlerDigest::AssembleResponseDigest(
     const std::string& cnonce,
     const std::string& nc) const {
   // ha1 = MD5(A1)
-  // TODO(eroman): is this the right encoding?
-  std::string ha1 = base::MD5String(UTF16ToUTF8(credentials.username()) + ":" +
-                                    original_realm_ + ":" +
-                                    UTF16ToUTF8(credentials.password()));
-  if (algorithm_ == HttpAuthHandlerDigest::ALGORITHM_MD5_SESS)
-    ha1 = base::MD5String(ha1 + ":" + nonce_ + ":" + cnonce);
+  std::string ha1 = GetUserRealmPasswordHash(credentials);
+  if (algorithm_ == HttpAuthHandlerDigest::ALGORITHM_MD5_SESS) {
+    const base::StringPiece parts[] = { ha1, nonce_, cnonce };
+    ha1 = MD5OfJoinedParts(parts, arraysize(parts));
+  }
 
   // ha2 = MD5(A2)
   // TODO(eroman): need to add MD5(req-entity-body) for qop=auth-int.
-  std::string ha2 = base::MD5String(method + ":" + path);
+  const base::StringPiece a2_parts[] = { method, path };
+  std::string ha2 = MD5OfJoinedParts(a2_parts, arraysize(a2_parts));
 
-  std::string nc_part;
   if (qop_ != HttpAuthHandlerDigest::QOP_UNSPECIFIED) {
-    nc_part = nc + ":" + cnonce + ":" + QopToString(qop_) + ":";
+    const std::string qop = QopToString(qop_);
+    const base::StringPiece parts[] = { ha1, nonce_, nc, cnonce, qop, ha2 };
+    return MD5OfJoinedParts(parts, arraysize(parts));
   }
-
-  return base::MD5String(ha1 + ":" + nonce_ + ":" + nc_part + ha2);
+  const base::StringPiece parts[] = { ha1, nonce_, ha2 };
+  return MD5OfJoinedParts(parts, arraysize(parts));
 }
 
 std::string HttpAuthHandlerDigest::AssembleCredentials(
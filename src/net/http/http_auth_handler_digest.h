@@ -10,6 +10,7 @@
 #include "base/basictypes.h"
 #include "base/gtest_prod_util.h"
 #include "base/memory/scoped_ptr.h"
+#include "net/base/auth.h"
 #include "net/base/net_export.h"
 #include "net/http/http_auth_handler.h"
 #include "net/http/http_auth_handler_factory.h"
@@ -91,6 +92,8 @@ class NET_EXPORT_PRIVATE HttpAuthHandlerDigest : public HttpAuthHandler {
  private:
   FRIEND_TEST_ALL_PREFIXES(HttpAuthHandlerDigestTest, ParseChallenge);
   FRIEND_TEST_ALL_PREFIXES(HttpAuthHandlerDigestTest, AssembleCredentials);
+  FRIEND_TEST_ALL_PREFIXES(HttpAuthHandlerDigestTest,
+                           AssembleCredentialsReusesHash);
   FRIEND_TEST_ALL_PREFIXES(HttpNetworkTransactionTest, DigestPreAuthNonceCount);
 
   // Possible values for the "algorithm" property.
@@ -143,6 +146,12 @@ class NET_EXPORT_PRIVATE HttpAuthHandlerDigest : public HttpAuthHandler {
                                std::string* method,
                                std::string* path) const;
 
+  // Returns MD5(username:realm:password), the part of MD5(A1) that doesn't
+  // depend on the nonces.  It is computed once and reused for as long as the
+  // handler is asked for tokens with the same |credentials|.
+  const std::string& GetUserRealmPasswordHash(
+      const AuthCredentials& credentials) const;
+
   // Build up  the 'response' production.
   std::string AssembleResponseDigest(const std::string& method,
                                      const std::string& path,
@@ -172,6 +181,11 @@ class NET_EXPORT_PRIVATE HttpAuthHandlerDigest : public HttpAuthHandler {
 
   int nonce_count_;
   const NonceGenerator* nonce_generator_;
+
+  // Cached result of GetUserRealmPasswordHash(), and the credentials it was
+  // computed from.
+  mutable std::string user_realm_password_hash_;
+  mutable AuthCredentials hashed_credentials_;
 };
 
 }  // namespace net
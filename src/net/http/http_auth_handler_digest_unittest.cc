@@ -539,6 +539,54 @@ TEST(HttpAuthHandlerDigestTest, AssembleCredentials) {
   }
 }
 
+// The hash of the credentials is reused across tokens, but must not leak
+// into tokens generated for different credentials.
+TEST(HttpAuthHandlerDigestTest, AssembleCredentialsReusesHash) {
+  static const char kChallenge[] =
+      "Digest realm=\"DRealm1\", "
+      "nonce=\"claGgoRXBAA=7583377687842fdb7b56ba0555d175baa0b800e3\", "
+      "algorithm=MD5, qop=\"auth\"";
+  static const char kExpectedFooBar[] =
+      "Digest username=\"foo\", realm=\"DRealm1\", "
+      "nonce=\"claGgoRXBAA=7583377687842fdb7b56ba0555d175baa0b800e3\", "
+      "uri=\"/test/drealm1\", algorithm=MD5, "
+      "response=\"bcfaa62f1186a31ff1b474a19a17cf57\", "
+      "qop=auth, nc=00000001, cnonce=\"082c875dcb2ca740\"";
+
+  GURL origin("http://www.example.com");
+  HttpAuthHandlerDigest::Factory factory;
+  scoped_ptr<HttpAuthHandler> handler;
+  ASSERT_EQ(OK, factory.CreateAuthHandlerFromString(
+      kChallenge, HttpAuth::AUTH_SERVER, origin, BoundNetLog(), &handler));
+  HttpAuthHandlerDigest* digest =
+      static_cast<HttpAuthHandlerDigest*>(handler.get());
+
+  scoped_ptr<HttpAuthHandler> other_handler;
+  ASSERT_EQ(OK, factory.CreateAuthHandlerFromString(
+      kChallenge, HttpAuth::AUTH_SERVER, origin, BoundNetLog(),
+      &other_handler));
+  HttpAuthHandlerDigest* other_digest =
+      static_cast<HttpAuthHandlerDigest*>(other_handler.get());
+
+  const AuthCredentials foo_bar(ASCIIToUTF16("foo"), ASCIIToUTF16("bar"));
+  const AuthCredentials foo_baz(ASCIIToUTF16("foo"), ASCIIToUTF16("baz"));
+
+  EXPECT_EQ(kExpectedFooBar,
+            digest->AssembleCredentials("GET", "/test/drealm1", foo_bar,
+                                        "082c875dcb2ca740", 1));
+  EXPECT_EQ(kExpectedFooBar,
+            digest->AssembleCredentials("GET", "/test/drealm1", foo_bar,
+                                        "082c875dcb2ca740", 1));
+
+  std::string foo_baz_creds =
+      digest->AssembleCredentials("GET", "/test/drealm1", foo_baz,
+                                  "082c875dcb2ca740", 1);
+  EXPECT_NE(kExpectedFooBar, foo_baz_creds);
+  EXPECT_EQ(other_digest->AssembleCredentials("GET", "/test/drealm1", foo_baz,
+                                              "082c875dcb2ca740", 1),
+            foo_baz_creds);
+}
+
 TEST(HttpAuthHandlerDigest, HandleAnotherChallenge) {
   scoped_ptr<HttpAuthHandlerDigest::Factory> factory(
       new HttpAuthHandlerDigest::Factory());
@@ -65,6 +65,9 @@ HttpNetworkSession::Params::Params()
       http_server_properties(NULL),
       net_log(NULL),
       host_mapping_rules(NULL),
+      max_http_auth_cache_entries(HttpAuthCache::kMaxNumRealmEntries),
+      max_http_auth_cache_paths_per_entry(
+          HttpAuthCache::kMaxNumPathsPerRealmEntry),
       force_http_pipelining(false),
       ignore_certificate_errors(false),
       http_pipelining_enabled(false),
@@ -99,6 +102,8 @@ HttpNetworkSession::HttpNetworkSession(const Params& params)
       force_http_pipelining_(params.force_http_pipelining),
       proxy_service_(params.proxy_service),
       ssl_config_service_(params.ssl_config_service),
+      http_auth_cache_(params.max_http_auth_cache_entries,
+                       params.max_http_auth_cache_paths_per_entry),
       normal_socket_pool_manager_(
           CreateSocketPoolManager(NORMAL_SOCKET_POOL, params)),
       websocket_socket_pool_manager_(
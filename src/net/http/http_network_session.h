@@ -65,6 +65,9 @@ class NET_EXPORT HttpNetworkSession
     HttpServerProperties* http_server_properties;
     NetLog* net_log;
     HostMappingRules* host_mapping_rules;
+    // Limits for |http_auth_cache_|.  See HttpAuthCache.
+    size_t max_http_auth_cache_entries;
+    size_t max_http_auth_cache_paths_per_entry;
     bool force_http_pipelining;
     bool ignore_certificate_errors;
     bool http_pipelining_enabled;
@@ -4,6 +4,8 @@
 
 #include "net/http/http_pipelined_host_impl.h"
 
+#include <algorithm>
+
 #include "base/stl_util.h"
 #include "base/values.h"
 #include "net/http/http_pipelined_connection_impl.h"
@@ -19,6 +21,24 @@ namespace net {
 // costing too much performance. Until then, this is just a bad guess.
 static const int kNumKnownSuccessesThreshold = 3;
 
+// A response that takes more than this many times the host's usual response
+// time is taken as a sign that deep pipelining is hurting.
+static const int kSlowResponseFactor = 2;
+
+// The depth grows by one after this many timely responses per unit of depth.
+static const int kTimelyResponsesPerDepthIncrease = 2;
+
+// Weight (out of 8) given to the previous estimate when smoothing response
+// times, as for TCP's round trip time.
+static const int kResponseTimeSmoothingWeight = 7;
+
+static base::TimeDelta SmoothResponseTime(base::TimeDelta smoothed,
+                                          base::TimeDelta sample) {
+  if (smoothed == base::TimeDelta())
+    return sample;
+  return (smoothed * kResponseTimeSmoothingWeight + sample) / 8;
+}
+
 HttpPipelinedHostImpl::HttpPipelinedHostImpl(
     HttpPipelinedHost::Delegate* delegate,
     const HttpPipelinedHost::Key& key,
@@ -27,7 +47,12 @@ HttpPipelinedHostImpl::HttpPipelinedHostImpl(
     : delegate_(delegate),
       key_(key),
       factory_(factory),
-      capability_(capability) {
+      capability_(capability),
+      adaptive_pipeline_depth_(max_pipeline_depth()),
+      num_timely_responses_(0),
+      num_depth_increases_(0),
+      num_depth_decreases_(0),
+      time_func_(&base::TimeTicks::Now) {
   if (!factory) {
     factory_.reset(new HttpPipelinedConnectionImpl::Factory());
   }
@@ -51,24 +76,95 @@ HttpPipelinedStream* HttpPipelinedHostImpl::CreateStreamOnNewPipeline(
       connection, this, key_.origin(), used_ssl_config, used_proxy_info,
       net_log, was_npn_negotiated, protocol_negotiated);
   PipelineInfo info;
+  info.num_streams = 1;
+  info.last_response_time = time_func_();
   pipelines_.insert(std::make_pair(pipeline, info));
   return pipeline->CreateNewStream();
 }
 
 HttpPipelinedStream* HttpPipelinedHostImpl::CreateStreamOnExistingPipeline() {
-  HttpPipelinedConnection* available_pipeline = NULL;
+  PipelineInfoMap::iterator available_pipeline = pipelines_.end();
+  base::TimeDelta best_completion_time;
   for (PipelineInfoMap::iterator it = pipelines_.begin();
        it != pipelines_.end(); ++it) {
-    if (CanPipelineAcceptRequests(it->first) &&
-        (!available_pipeline ||
-         it->first->depth() < available_pipeline->depth())) {
-      available_pipeline = it->first;
+    if (!CanPipelineAcceptRequests(it->first)) {
+      continue;
+    }
+    base::TimeDelta completion_time =
+        GetExpectedCompletionTime(it->first, it->second);
+    if (available_pipeline == pipelines_.end() ||
+        completion_time < best_completion_time) {
+      available_pipeline = it;
+      best_completion_time = completion_time;
     }
   }
-  if (!available_pipeline) {
+  if (available_pipeline == pipelines_.end()) {
     return NULL;
   }
-  return available_pipeline->CreateNewStream();
+  // An idle pipeline's next response time is measured from this request, not
+  // from its last response, so time spent idle isn't counted as latency.
+  if (available_pipeline->first->depth() == 0) {
+    available_pipeline->second.last_response_time = time_func_();
+  }
+  ++available_pipeline->second.num_streams;
+  return available_pipeline->first->CreateNewStream();
+}
+
+base::TimeDelta HttpPipelinedHostImpl::GetExpectedCompletionTime(
+    HttpPipelinedConnection* pipeline,
+    const PipelineInfo& info) const {
+  // Pipelines that haven't reported a response yet are assumed to be as fast
+  // as the host's others.  Without any measurements, this compares depths.
+  base::TimeDelta response_time = info.smoothed_response_time;
+  if (response_time == base::TimeDelta()) {
+    response_time = smoothed_response_time_;
+  }
+  if (response_time == base::TimeDelta()) {
+    response_time = base::TimeDelta::FromMilliseconds(1);
+  }
+  return response_time * (pipeline->depth() + 1);
+}
+
+void HttpPipelinedHostImpl::RecordResponse(PipelineInfo* info) {
+  base::TimeTicks now = time_func_();
+  base::TimeDelta sample = now - info->last_response_time;
+  info->last_response_time = now;
+  info->smoothed_response_time =
+      SmoothResponseTime(info->smoothed_response_time, sample);
+
+  base::TimeDelta usual_response_time = smoothed_response_time_;
+  smoothed_response_time_ = SmoothResponseTime(smoothed_response_time_,
+                                               sample);
+  if (capability_ != PIPELINE_CAPABLE ||
+      usual_response_time == base::TimeDelta()) {
+    return;
+  }
+
+  if (sample > usual_response_time * kSlowResponseFactor) {
+    ReducePipelineDepth();
+    return;
+  }
+  ++num_timely_responses_;
+  if (adaptive_pipeline_depth_ < max_adaptive_pipeline_depth() &&
+      num_timely_responses_ >=
+          adaptive_pipeline_depth_ * kTimelyResponsesPerDepthIncrease) {
+    ++adaptive_pipeline_depth_;
+    ++num_depth_increases_;
+    num_timely_responses_ = 0;
+    if (IsExistingPipelineAvailable()) {
+      delegate_->OnHostHasAdditionalCapacity(this);
+    }
+  }
+}
+
+void HttpPipelinedHostImpl::ReducePipelineDepth() {
+  num_timely_responses_ = 0;
+  if (adaptive_pipeline_depth_ <= min_adaptive_pipeline_depth()) {
+    return;
+  }
+  adaptive_pipeline_depth_ = std::max(adaptive_pipeline_depth_ / 2,
+                                      min_adaptive_pipeline_depth());
+  ++num_depth_decreases_;
 }
 
 bool HttpPipelinedHostImpl::IsExistingPipelineAvailable() const {
@@ -114,6 +210,7 @@ void HttpPipelinedHostImpl::OnPipelineFeedback(
   switch (feedback) {
     case HttpPipelinedConnection::OK:
       ++pipelines_[pipeline].num_successes;
+      RecordResponse(&pipelines_[pipeline]);
       if (capability_ == PIPELINE_UNKNOWN) {
         capability_ = PIPELINE_PROBABLY_CAPABLE;
         NotifyAllPipelinesHaveCapacity();
@@ -145,6 +242,10 @@ void HttpPipelinedHostImpl::OnPipelineFeedback(
       break;
 
     case HttpPipelinedConnection::MUST_CLOSE_CONNECTION:
+      // Requests pipelined behind this one will have to be retried.
+      if (capability_ == PIPELINE_CAPABLE && pipeline->depth() > 1) {
+        ReducePipelineDepth();
+      }
       break;
   }
 }
@@ -153,6 +254,9 @@ int HttpPipelinedHostImpl::GetPipelineCapacity() const {
   int capacity = 0;
   switch (capability_) {
     case PIPELINE_CAPABLE:
+      capacity = adaptive_pipeline_depth_;
+      break;
+
     case PIPELINE_PROBABLY_CAPABLE:
       capacity = max_pipeline_depth();
       break;
@@ -202,13 +306,25 @@ Value* HttpPipelinedHostImpl::PipelineInfoToValue() const {
     pipeline_dict->SetBoolean("usable", it->first->usable());
     pipeline_dict->SetBoolean("active", it->first->active());
     pipeline_dict->SetInteger("source_id", it->first->net_log().source().id);
+    pipeline_dict->SetInteger("num_successes", it->second.num_successes);
+    pipeline_dict->SetInteger("num_streams", it->second.num_streams);
+    pipeline_dict->SetInteger(
+        "response_time_ms",
+        it->second.smoothed_response_time.InMilliseconds());
+    // Host-wide values are repeated in each pipeline's entry, since the
+    // per-host summary is just the list of its pipelines.
+    pipeline_dict->SetInteger("host_response_time_ms",
+                              smoothed_response_time_.InMilliseconds());
+    pipeline_dict->SetInteger("depth_increases", num_depth_increases_);
+    pipeline_dict->SetInteger("depth_decreases", num_depth_decreases_);
     list_value->Append(pipeline_dict);
   }
   return list_value;
 }
 
 HttpPipelinedHostImpl::PipelineInfo::PipelineInfo()
-    : num_successes(0) {
+    : num_successes(0),
+      num_streams(0) {
 }
 
 }  // namespace net
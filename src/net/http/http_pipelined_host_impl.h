@@ -10,6 +10,7 @@
 
 #include "base/basictypes.h"
 #include "base/memory/scoped_ptr.h"
+#include "base/time.h"
 #include "net/base/host_port_pair.h"
 #include "net/base/net_export.h"
 #include "net/http/http_pipelined_connection.h"
@@ -30,11 +31,18 @@ struct SSLConfig;
 
 // Manages all of the pipelining state for specific host with active pipelined
 // HTTP requests. Manages connection jobs, constructs pipelined streams, and
-// assigns requests to the least loaded pipelined connection.
+// assigns requests to the pipelined connection expected to finish them first.
+//
+// Once a host is known to be capable of pipelining, its pipeline depth adapts:
+// it grows while responses keep arriving at a steady pace, and is halved when
+// a response is much slower than usual (suggesting head-of-line blocking) or
+// the server closes a pipelined connection.
 class NET_EXPORT_PRIVATE HttpPipelinedHostImpl
     : public HttpPipelinedHost,
       public HttpPipelinedConnection::Delegate {
  public:
+  typedef base::TimeTicks (*TimeFunc)(void);
+
   HttpPipelinedHostImpl(HttpPipelinedHost::Delegate* delegate,
                         const HttpPipelinedHost::Key& key,
                         HttpPipelinedConnection::Factory* factory,
@@ -71,15 +79,33 @@ class NET_EXPORT_PRIVATE HttpPipelinedHostImpl
   // ownership of the returned Value.
   virtual base::Value* PipelineInfoToValue() const OVERRIDE;
 
-  // Returns the maximum number of in-flight pipelined requests we'll allow on a
-  // single connection.
+  // Returns the number of in-flight pipelined requests we'll allow on a single
+  // connection when we first start pipelining to a host.
   static int max_pipeline_depth() { return 3; }
 
+  // Bounds for the adaptive pipeline depth of a PIPELINE_CAPABLE host.
+  static int min_adaptive_pipeline_depth() { return 2; }
+  static int max_adaptive_pipeline_depth() { return 8; }
+
+  // Returns the current pipeline depth for a PIPELINE_CAPABLE host.
+  int adaptive_pipeline_depth() const { return adaptive_pipeline_depth_; }
+
+  void set_time_func_for_testing(TimeFunc time_func) {
+    time_func_ = time_func;
+  }
+
  private:
   struct PipelineInfo {
     PipelineInfo();
 
     int num_successes;
+    // Number of streams this host has placed on the pipeline.
+    int num_streams;
+    // When the pipeline was created or last reported a response.
+    base::TimeTicks last_response_time;
+    // Smoothed time between responses on this pipeline, or zero if it hasn't
+    // reported any yet.
+    base::TimeDelta smoothed_response_time;
   };
   typedef std::map<HttpPipelinedConnection*, PipelineInfo> PipelineInfoMap;
 
@@ -90,6 +116,19 @@ class NET_EXPORT_PRIVATE HttpPipelinedHostImpl
   // Adds the next pending request to the pipeline if it's still usuable.
   void AddRequestToPipeline(HttpPipelinedConnection* pipeline);
 
+  // Returns how long a request added to |pipeline| now should take to
+  // complete: its position in line times the pipeline's response time.
+  base::TimeDelta GetExpectedCompletionTime(
+      HttpPipelinedConnection* pipeline,
+      const PipelineInfo& info) const;
+
+  // Updates the response time estimates with a response just received on
+  // |info|'s pipeline, and adapts the pipeline depth to it.
+  void RecordResponse(PipelineInfo* info);
+
+  // Halves the adaptive pipeline depth, down to the minimum.
+  void ReducePipelineDepth();
+
   // Returns the current pipeline capacity based on |capability_|. This should
   // not be called if |capability_| is INCAPABLE.
   int GetPipelineCapacity() const;
@@ -109,6 +148,16 @@ class NET_EXPORT_PRIVATE HttpPipelinedHostImpl
   scoped_ptr<HttpPipelinedConnection::Factory> factory_;
   HttpPipelinedHostCapability capability_;
 
+  // Adaptive depth state, used once |capability_| is PIPELINE_CAPABLE.
+  int adaptive_pipeline_depth_;
+  // Consecutive timely responses seen at the current depth.
+  int num_timely_responses_;
+  int num_depth_increases_;
+  int num_depth_decreases_;
+  // Smoothed time between responses across all of this host's pipelines.
+  base::TimeDelta smoothed_response_time_;
+  TimeFunc time_func_;
+
   DISALLOW_COPY_AND_ASSIGN(HttpPipelinedHostImpl);
 };
 
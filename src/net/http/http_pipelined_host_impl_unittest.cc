@@ -5,6 +5,7 @@
 #include "net/http/http_pipelined_host_impl.h"
 
 #include "base/memory/scoped_ptr.h"
+#include "base/values.h"
 #include "net/http/http_pipelined_connection.h"
 #include "net/http/http_pipelined_host_test_util.h"
 #include "net/proxy/proxy_info.h"
@@ -27,6 +28,16 @@ ClientSocketHandle* kDummyConnection =
 HttpPipelinedStream* kDummyStream =
     reinterpret_cast<HttpPipelinedStream*>(42);
 
+base::TimeTicks g_now;
+
+base::TimeTicks TheNearFuture() {
+  return g_now;
+}
+
+void AdvanceTime(int milliseconds) {
+  g_now += base::TimeDelta::FromMilliseconds(milliseconds);
+}
+
 class HttpPipelinedHostImplTest : public testing::Test {
  public:
   HttpPipelinedHostImplTest()
@@ -303,6 +314,99 @@ TEST_F(HttpPipelinedHostImplTest, HeedsSocketErrorOnFirstRequestWithPipeline) {
   ClearTestPipeline(pipeline);
 }
 
+TEST_F(HttpPipelinedHostImplTest, PicksFastestPipeline) {
+  host_->set_time_func_for_testing(&TheNearFuture);
+  MockPipeline* slow_pipeline = AddTestPipeline(1, true, true);
+  AdvanceTime(500);
+  host_->OnPipelineFeedback(slow_pipeline, HttpPipelinedConnection::OK);
+  MockPipeline* fast_pipeline = AddTestPipeline(1, true, true);
+  AdvanceTime(100);
+  host_->OnPipelineFeedback(fast_pipeline, HttpPipelinedConnection::OK);
+
+  // The fast pipeline is deeper, but should still finish a new request first.
+  fast_pipeline->SetState(2, true, true);
+  EXPECT_CALL(*fast_pipeline, CreateNewStream())
+      .Times(1)
+      .WillOnce(Return(kDummyStream));
+  EXPECT_EQ(kDummyStream, host_->CreateStreamOnExistingPipeline());
+
+  ClearTestPipeline(slow_pipeline);
+  ClearTestPipeline(fast_pipeline);
+}
+
+TEST_F(HttpPipelinedHostImplTest, AdaptsPipelineDepth) {
+  host_->set_time_func_for_testing(&TheNearFuture);
+  MockPipeline* pipeline = AddTestPipeline(1, true, true);
+  const int initial_depth = HttpPipelinedHostImpl::max_pipeline_depth();
+  EXPECT_EQ(initial_depth, host_->adaptive_pipeline_depth());
+
+  // The first response only establishes a baseline.  After that, steady
+  // responses deepen the pipeline by one for every two per unit of depth.
+  for (int i = 0; i <= initial_depth * 2; ++i) {
+    AdvanceTime(100);
+    host_->OnPipelineFeedback(pipeline, HttpPipelinedConnection::OK);
+  }
+  EXPECT_EQ(initial_depth + 1, host_->adaptive_pipeline_depth());
+
+  // A response that's much slower than usual halves the depth.
+  AdvanceTime(1000);
+  host_->OnPipelineFeedback(pipeline, HttpPipelinedConnection::OK);
+  EXPECT_EQ(HttpPipelinedHostImpl::min_adaptive_pipeline_depth(),
+            host_->adaptive_pipeline_depth());
+
+  // It never drops below the minimum.
+  pipeline->SetState(2, true, true);
+  host_->OnPipelineFeedback(pipeline,
+                            HttpPipelinedConnection::MUST_CLOSE_CONNECTION);
+  EXPECT_EQ(HttpPipelinedHostImpl::min_adaptive_pipeline_depth(),
+            host_->adaptive_pipeline_depth());
+  EXPECT_FALSE(host_->IsExistingPipelineAvailable());
+
+  scoped_ptr<base::Value> value(host_->PipelineInfoToValue());
+  base::ListValue* list;
+  ASSERT_TRUE(value->GetAsList(&list));
+  EXPECT_EQ(1u, list->GetSize());
+  base::DictionaryValue* pipeline_dict;
+  ASSERT_TRUE(list->GetDictionary(0, &pipeline_dict));
+  int counter;
+  EXPECT_TRUE(pipeline_dict->GetInteger("depth_increases", &counter));
+  EXPECT_EQ(1, counter);
+  EXPECT_TRUE(pipeline_dict->GetInteger("depth_decreases", &counter));
+  EXPECT_EQ(1, counter);
+  EXPECT_TRUE(pipeline_dict->GetInteger("num_successes", &counter));
+  EXPECT_EQ(initial_depth * 2 + 2, counter);
+  EXPECT_TRUE(pipeline_dict->GetInteger("capacity", &counter));
+  EXPECT_EQ(HttpPipelinedHostImpl::min_adaptive_pipeline_depth(), counter);
+
+  ClearTestPipeline(pipeline);
+}
+
+TEST_F(HttpPipelinedHostImplTest, IdleTimeIsNotResponseTime) {
+  host_->set_time_func_for_testing(&TheNearFuture);
+  MockPipeline* pipeline = AddTestPipeline(1, true, true);
+  const int initial_depth = HttpPipelinedHostImpl::max_pipeline_depth();
+  for (int i = 0; i < 3; ++i) {
+    AdvanceTime(100);
+    host_->OnPipelineFeedback(pipeline, HttpPipelinedConnection::OK);
+  }
+
+  // The pipeline sits idle for a long time before its next request, which
+  // is then answered as quickly as usual.
+  pipeline->SetState(0, true, true);
+  AdvanceTime(5000);
+  EXPECT_CALL(*pipeline, CreateNewStream())
+      .Times(1)
+      .WillOnce(Return(kDummyStream));
+  EXPECT_EQ(kDummyStream, host_->CreateStreamOnExistingPipeline());
+  pipeline->SetState(1, true, true);
+  AdvanceTime(100);
+  host_->OnPipelineFeedback(pipeline, HttpPipelinedConnection::OK);
+
+  EXPECT_EQ(initial_depth, host_->adaptive_pipeline_depth());
+
+  ClearTestPipeline(pipeline);
+}
+
 }  // anonymous namespace
 
 }  // namespace net
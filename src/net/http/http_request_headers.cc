@@ -170,17 +170,35 @@ void HttpRequestHeaders::MergeFrom(const HttpRequestHeaders& other) {
 
 std::string HttpRequestHeaders::ToString() const {
   std::string output;
+  AppendToString(&output);
+  return output;
+}
+
+void HttpRequestHeaders::AppendToString(std::string* output) const {
+  // Each header is "key: value\r\n", or "key:\r\n" if the value is empty,
+  // followed by a final "\r\n".
+  size_t size = output->size() + 2;
+  for (HeaderVector::const_iterator it = headers_.begin();
+       it != headers_.end(); ++it) {
+    size += it->key.size() + 3;
+    if (!it->value.empty())
+      size += it->value.size() + 1;
+  }
+  output->reserve(size);
+
   for (HeaderVector::const_iterator it = headers_.begin();
        it != headers_.end(); ++it) {
+    output->append(it->key);
     if (!it->value.empty()) {
-      base::StringAppendF(&output, "%s: %s\r\n",
-                          it->key.c_str(), it->value.c_str());
+      output->append(": ", 2);
+      output->append(it->value);
     } else {
-      base::StringAppendF(&output, "%s:\r\n", it->key.c_str());
+      output->push_back(':');
     }
+    output->append("\r\n", 2);
   }
-  output.append("\r\n");
-  return output;
+  output->append("\r\n", 2);
+  DCHECK_EQ(size, output->size());
 }
 
 Value* HttpRequestHeaders::NetLogCallback(
@@ -145,6 +145,10 @@ class NET_EXPORT HttpRequestHeaders {
   // line, and adds the trailing "\r\n".
   std::string ToString() const;
 
+  // Same as ToString(), but appends the serialized headers to |output|.  The
+  // serialized length is computed up front so |output| grows at most once.
+  void AppendToString(std::string* output) const;
+
   // Takes in the request line and returns a Value for use with the NetLog
   // containing both the request line and all headers fields.
   base::Value* NetLogCallback(const std::string* request_line,
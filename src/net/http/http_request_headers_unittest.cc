@@ -165,6 +165,23 @@ TEST(HttpRequestHeaders, CopyFrom) {
   EXPECT_EQ("B: b\r\nC: c\r\n\r\n", headers.ToString());
 }
 
+TEST(HttpRequestHeaders, AppendToString) {
+  HttpRequestHeaders headers;
+  headers.SetHeader("Foo", "bar");
+  headers.SetHeader("Empty", "");
+  headers.SetHeader("Host", "www.example.com");
+
+  std::string output("GET / HTTP/1.1\r\n");
+  headers.AppendToString(&output);
+  EXPECT_EQ("GET / HTTP/1.1\r\n"
+            "Foo: bar\r\n"
+            "Empty:\r\n"
+            "Host: www.example.com\r\n"
+            "\r\n",
+            output);
+  EXPECT_EQ(output.substr(strlen("GET / HTTP/1.1\r\n")), headers.ToString());
+}
+
 TEST(HttpRequestHeaders, ToNetLogParamAndBackAgain) {
   HttpRequestHeaders headers;
   headers.SetHeader("B", "b");
@@ -24,6 +24,10 @@ namespace {
 const size_t kMaxMergedHeaderAndBodySize = 1400;
 const size_t kRequestBodyBufferSize = 1 << 14;  // 16KB
 
+// The end-of-headers marker is at most LF CR LF, so a search that stopped
+// short of it can have consumed at most two of its bytes.
+const int kEndOfHeadersCarryOver = 2;
+
 std::string GetResponseHeaderLines(const net::HttpResponseHeaders& headers) {
   std::string raw_headers = headers.raw_headers();
   const char* null_separated_headers = raw_headers.c_str();
@@ -178,6 +182,7 @@ HttpStreamParser::HttpStreamParser(ClientSocketHandle* connection,
       read_buf_(read_buffer),
       read_buf_unused_offset_(0),
       response_header_start_offset_(-1),
+      response_header_scan_offset_(-1),
       response_body_length_(-1),
       response_body_read_(0),
       chunked_decoder_(NULL),
@@ -221,7 +226,8 @@ int HttpStreamParser::SendRequest(const std::string& request_line,
     return result;
   response_->socket_address = HostPortPair::FromIPEndPoint(ip_endpoint);
 
-  std::string request = request_line + headers.ToString();
+  std::string request(request_line);
+  headers.AppendToString(&request);
 
   if (request_->upload_data_stream != NULL) {
     request_body_send_buf_ = new SeekableIOBuffer(kRequestBodyBufferSize);
@@ -592,6 +598,7 @@ int HttpStreamParser::DoReadHeadersComplete(int result) {
       // tunnel.
       io_state_ = STATE_REQUEST_SENT;
       response_header_start_offset_ = -1;
+      response_header_scan_offset_ = -1;
     } else {
       io_state_ = STATE_BODY_PENDING;
       CalculateResponseBodySize();
@@ -757,10 +764,19 @@ int HttpStreamParser::ParseResponseHeaders() {
   }
 
   if (response_header_start_offset_ >= 0) {
+    // Resume the search where the previous read left off rather than from
+    // the start of the status line.  Backing up over the last
+    // |kEndOfHeadersCarryOver| bytes restores the newline state of a marker
+    // split across reads.
+    int search_offset = response_header_start_offset_;
+    if (response_header_scan_offset_ - kEndOfHeadersCarryOver > search_offset)
+      search_offset = response_header_scan_offset_ - kEndOfHeadersCarryOver;
+    int buf_len = read_buf_->offset() - read_buf_unused_offset_;
     end_offset = HttpUtil::LocateEndOfHeaders(
         read_buf_->StartOfBuffer() + read_buf_unused_offset_,
-        read_buf_->offset() - read_buf_unused_offset_,
-        response_header_start_offset_);
+        buf_len,
+        search_offset);
+    response_header_scan_offset_ = buf_len;
   } else if (read_buf_->offset() - read_buf_unused_offset_ >= 8) {
     // Enough data to decide that this is an HTTP/0.9 response.
     // 8 bytes = (4 bytes of junk) + "http".length()
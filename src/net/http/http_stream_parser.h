@@ -185,6 +185,12 @@ class NET_EXPORT_PRIVATE HttpStreamParser {
   // -1 if not found yet.
   int response_header_start_offset_;
 
+  // The amount beyond |read_buf_unused_offset_| up to which the response has
+  // already been searched for the end of the headers; -1 if no search has
+  // been done yet.  Lets headers that arrive over many reads be scanned in
+  // linear rather than quadratic time.
+  int response_header_scan_offset_;
+
   // The parsed response headers.  Owned by the caller.
   HttpResponseInfo* response_;
 
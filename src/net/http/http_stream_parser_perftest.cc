@@ -0,0 +1,113 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/http/http_stream_parser.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "base/memory/ref_counted.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/perftimer.h"
+#include "base/stringprintf.h"
+#include "googleurl/src/gurl.h"
+#include "net/base/address_list.h"
+#include "net/base/io_buffer.h"
+#include "net/base/net_errors.h"
+#include "net/base/test_completion_callback.h"
+#include "net/http/http_request_headers.h"
+#include "net/http/http_request_info.h"
+#include "net/http/http_response_headers.h"
+#include "net/http/http_response_info.h"
+#include "net/socket/client_socket_handle.h"
+#include "net/socket/socket_test_util.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace net {
+
+namespace {
+
+const int kNumIterations = 20;
+
+// A typical Ethernet TCP payload size.
+const size_t kMtuPayloadSize = 1460;
+
+// Builds a response whose headers are roughly |header_size| bytes long.
+std::string MakeResponse(size_t header_size) {
+  std::string response = "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n";
+  for (int i = 0; response.size() < header_size; ++i) {
+    response += base::StringPrintf(
+        "X-Header-%d: some moderately long header value %d\r\n", i, i);
+  }
+  response += "\r\n";
+  return response;
+}
+
+// Runs a single request through an HttpStreamParser, with the response
+// delivered |chunk_size| bytes per socket read.
+void ParseResponse(const std::string& response, size_t chunk_size) {
+  MockWrite writes[] = {
+    MockWrite(SYNCHRONOUS, "GET / HTTP/1.1\r\n\r\n"),
+  };
+  std::vector<MockRead> reads;
+  for (size_t i = 0; i < response.size(); i += chunk_size) {
+    reads.push_back(MockRead(SYNCHRONOUS, response.data() + i,
+                             std::min(chunk_size, response.size() - i)));
+  }
+  reads.push_back(MockRead(SYNCHRONOUS, OK));
+
+  StaticSocketDataProvider data(&reads[0], reads.size(),
+                                writes, arraysize(writes));
+  data.set_connect_data(MockConnect(SYNCHRONOUS, OK));
+  scoped_ptr<MockTCPClientSocket> transport(
+      new MockTCPClientSocket(AddressList(), NULL, &data));
+  TestCompletionCallback callback;
+  ASSERT_EQ(OK, transport->Connect(callback.callback()));
+
+  ClientSocketHandle socket_handle;
+  socket_handle.set_socket(transport.release());
+
+  HttpRequestInfo request_info;
+  request_info.method = "GET";
+  request_info.url = GURL("http://localhost");
+
+  scoped_refptr<GrowableIOBuffer> read_buffer(new GrowableIOBuffer);
+  HttpStreamParser parser(&socket_handle, &request_info, read_buffer,
+                          BoundNetLog());
+  HttpResponseInfo response_info;
+  ASSERT_EQ(OK, parser.SendRequest("GET / HTTP/1.1\r\n", HttpRequestHeaders(),
+                                   &response_info, callback.callback()));
+  ASSERT_EQ(OK, parser.ReadResponseHeaders(callback.callback()));
+  ASSERT_EQ(200, response_info.headers->response_code());
+}
+
+void RunTest(const char* name, size_t header_size, size_t chunk_size) {
+  std::string response = MakeResponse(header_size);
+  PerfTimeLogger timer(name);
+  for (int i = 0; i < kNumIterations; ++i)
+    ParseResponse(response, chunk_size);
+  timer.Done();
+}
+
+}  // namespace
+
+TEST(HttpStreamParserPerfTest, SmallHeadersByteByByte) {
+  RunTest("HttpStreamParser_4K_headers_1_byte_reads", 4 * 1024, 1);
+}
+
+TEST(HttpStreamParserPerfTest, LargeHeadersByteByByte) {
+  RunTest("HttpStreamParser_128K_headers_1_byte_reads", 128 * 1024, 1);
+}
+
+TEST(HttpStreamParserPerfTest, SmallHeadersMtuChunks) {
+  RunTest("HttpStreamParser_4K_headers_mtu_reads", 4 * 1024, kMtuPayloadSize);
+}
+
+TEST(HttpStreamParserPerfTest, LargeHeadersMtuChunks) {
+  RunTest("HttpStreamParser_128K_headers_mtu_reads", 128 * 1024,
+          kMtuPayloadSize);
+}
+
+}  // namespace net
@@ -4,6 +4,9 @@
 
 #include "net/http/http_stream_parser.h"
 
+#include <string>
+#include <vector>
+
 #include "base/file_util.h"
 #include "base/files/file_path.h"
 #include "base/files/scoped_temp_dir.h"
@@ -11,6 +14,7 @@
 #include "base/stringprintf.h"
 #include "base/strings/string_piece.h"
 #include "googleurl/src/gurl.h"
+#include "net/base/address_list.h"
 #include "net/base/io_buffer.h"
 #include "net/base/net_errors.h"
 #include "net/base/test_completion_callback.h"
@@ -19,6 +23,7 @@
 #include "net/base/upload_file_element_reader.h"
 #include "net/http/http_request_headers.h"
 #include "net/http/http_request_info.h"
+#include "net/http/http_response_headers.h"
 #include "net/http/http_response_info.h"
 #include "net/socket/client_socket_handle.h"
 #include "net/socket/socket_test_util.h"
@@ -301,4 +306,62 @@ TEST(HttpStreamParser, AsyncChunkAndAsyncSocket) {
   ASSERT_EQ(kBodySize, rv);
 }
 
+// Test that the end of the headers is found when the response headers arrive
+// one byte at a time, including when the end-of-headers marker itself is
+// split across reads.
+TEST(HttpStreamParser, ReadHeadersOneByteAtATime) {
+  static const char kRequest[] = "GET / HTTP/1.1\r\n\r\n";
+  static const char* const kResponses[] = {
+    "HTTP/1.1 200 OK\r\nContent-Length: 4\r\nFoo: bar\r\n\r\nbody",
+    "HTTP/1.1 200 OK\nContent-Length: 4\nFoo: bar\n\nbody",
+    "HTTP/1.1 200 OK\nContent-Length: 4\nFoo: bar\n\r\nbody",
+  };
+
+  for (size_t i = 0; i < arraysize(kResponses); ++i) {
+    const std::string response(kResponses[i]);
+
+    MockWrite writes[] = {
+      MockWrite(SYNCHRONOUS, kRequest),
+    };
+    std::vector<MockRead> reads;
+    for (size_t j = 0; j < response.size(); ++j)
+      reads.push_back(MockRead(SYNCHRONOUS, response.data() + j, 1));
+    reads.push_back(MockRead(SYNCHRONOUS, OK));
+
+    StaticSocketDataProvider data(&reads[0], reads.size(),
+                                  writes, arraysize(writes));
+    data.set_connect_data(MockConnect(SYNCHRONOUS, OK));
+    scoped_ptr<MockTCPClientSocket> transport(
+        new MockTCPClientSocket(AddressList(), NULL, &data));
+
+    TestCompletionCallback callback;
+    ASSERT_EQ(OK, transport->Connect(callback.callback()));
+
+    scoped_ptr<ClientSocketHandle> socket_handle(new ClientSocketHandle);
+    socket_handle->set_socket(transport.release());
+
+    HttpRequestInfo request_info;
+    request_info.method = "GET";
+    request_info.url = GURL("http://localhost");
+    request_info.load_flags = LOAD_NORMAL;
+
+    scoped_refptr<GrowableIOBuffer> read_buffer(new GrowableIOBuffer);
+    HttpStreamParser parser(socket_handle.get(), &request_info, read_buffer,
+                            BoundNetLog());
+
+    HttpResponseInfo response_info;
+    ASSERT_EQ(OK, parser.SendRequest("GET / HTTP/1.1\r\n",
+                                     HttpRequestHeaders(), &response_info,
+                                     callback.callback()));
+    ASSERT_EQ(OK, parser.ReadResponseHeaders(callback.callback()));
+    ASSERT_TRUE(response_info.headers);
+    EXPECT_EQ(200, response_info.headers->response_code());
+    EXPECT_EQ(4, response_info.headers->GetContentLength());
+    EXPECT_TRUE(response_info.headers->HasHeaderValue("Foo", "bar"));
+    // The body hasn't been read yet, since the headers were complete as soon
+    // as the last byte of the end-of-headers marker arrived.
+    EXPECT_FALSE(parser.IsMoreDataBuffered());
+  }
+}
+
 }  // namespace net
@@ -7,6 +7,8 @@
 
 #include "net/http/http_util.h"
 
+#include <string.h>
+
 #include <algorithm>
 
 #include "base/basictypes.h"
@@ -521,18 +523,19 @@ int HttpUtil::LocateStartOfStatusLine(const char* buf, int buf_len) {
 }
 
 int HttpUtil::LocateEndOfHeaders(const char* buf, int buf_len, int i) {
-  bool was_lf = false;
-  char last_c = '\0';
-  for (; i < buf_len; ++i) {
-    char c = buf[i];
-    if (c == '\n') {
-      if (was_lf)
-        return i + 1;
-      was_lf = true;
-    } else if (c != '\r' || last_c != '\n') {
-      was_lf = false;
-    }
-    last_c = c;
+  // The end-of-headers marker is LF[CR]LF, so only positions following a LF
+  // need to be examined.  Let memchr() (which is vectorized on all the
+  // platforms we care about) skip over everything else.
+  while (i < buf_len) {
+    const char* lf = static_cast<const char*>(
+        memchr(buf + i, '\n', buf_len - i));
+    if (!lf)
+      break;
+    i = lf - buf + 1;
+    if (i < buf_len && buf[i] == '\n')
+      return i + 1;
+    if (i + 1 < buf_len && buf[i] == '\r' && buf[i + 1] == '\n')
+      return i + 2;
   }
   return -1;
 }
@@ -562,13 +565,46 @@ static bool IsLineSegmentContinuable(const char* begin, const char* end) {
   return true;
 }
 
-// Helper used by AssembleRawHeaders, to find the end of the status line.
-static const char* FindStatusLineEnd(const char* begin, const char* end) {
-  size_t i = base::StringPiece(begin, end - begin).find_first_of("\r\n");
-  if (i == base::StringPiece::npos)
-    return end;
-  return begin + i;
-}
+namespace {
+
+// Helper used by AssembleRawHeaders, to find the end of each line segment,
+// i.e. the next CR or LF, using memchr(), which the C library vectorizes.
+// The next CR and the next LF found are remembered across calls, so input
+// that uses only one of the two delimiters is still scanned just once.
+class LineSegmentFinder {
+ public:
+  explicit LineSegmentFinder(const char* end)
+      : end_(end),
+        next_cr_(NULL),
+        next_lf_(NULL) {
+  }
+
+  // Returns the end of the line segment starting at |begin|, or |end_| if the
+  // segment is not terminated.  |begin| must not precede the |begin| of the
+  // previous call.
+  const char* FindEnd(const char* begin) {
+    next_cr_ = FindNext(begin, '\r', next_cr_);
+    next_lf_ = FindNext(begin, '\n', next_lf_);
+    return std::min(next_cr_, next_lf_);
+  }
+
+ private:
+  const char* FindNext(const char* begin, char c, const char* cached) const {
+    if (cached && cached >= begin)
+      return cached;
+    const char* found =
+        static_cast<const char*>(memchr(begin, c, end_ - begin));
+    return found ? found : end_;
+  }
+
+  const char* const end_;
+  const char* next_cr_;
+  const char* next_lf_;
+
+  DISALLOW_COPY_AND_ASSIGN(LineSegmentFinder);
+};
+
+}  // namespace
 
 // Helper used by AssembleRawHeaders, to skip past leading LWS.
 static const char* FindFirstNonLWS(const char* begin, const char* end) {
@@ -579,6 +615,23 @@ static const char* FindFirstNonLWS(const char* begin, const char* end) {
   return end;  // Not found.
 }
 
+// Helper used by AssembleRawHeaders, to append [begin, end) to |output|
+// without any embedded '\0', since that is the canonical line terminator.
+static void AppendWithoutNulls(const char* begin,
+                               const char* end,
+                               std::string* output) {
+  while (begin != end) {
+    const char* nul =
+        static_cast<const char*>(memchr(begin, '\0', end - begin));
+    if (!nul) {
+      output->append(begin, end);
+      return;
+    }
+    output->append(begin, nul);
+    begin = nul + 1;
+  }
+}
+
 std::string HttpUtil::AssembleRawHeaders(const char* input_begin,
                                          int input_len) {
   std::string raw_headers;
@@ -593,48 +646,51 @@ std::string HttpUtil::AssembleRawHeaders(const char* input_begin,
     input_begin += status_begin_offset;
 
   // Copy the status line.
-  const char* status_line_end = FindStatusLineEnd(input_begin, input_end);
-  raw_headers.append(input_begin, status_line_end);
+  LineSegmentFinder line_segment_finder(input_end);
+  const char* status_line_end = line_segment_finder.FindEnd(input_begin);
+  AppendWithoutNulls(input_begin, status_line_end, &raw_headers);
 
   // After the status line, every subsequent line is a header line segment.
   // Should a segment start with LWS, it is a continuation of the previous
   // line's field-value.
-
-  // TODO(ericroman): is this too permissive? (delimits on [\r\n]+)
-  base::CStringTokenizer lines(status_line_end, input_end, "\r\n");
+  //
+  // Use '\0' as the canonical line terminator. If the input already contained
+  // any embeded '\0' characters they are stripped to avoid interpreting them
+  // as line breaks.
 
   // This variable is true when the previous line was continuable.
   bool prev_line_continuable = false;
 
-  while (lines.GetNext()) {
-    const char* line_begin = lines.token_begin();
-    const char* line_end = lines.token_end();
+  const char* cur = status_line_end;
+  while (true) {
+    // TODO(ericroman): is this too permissive? (delimits on [\r\n]+)
+    while (cur != input_end && (*cur == '\r' || *cur == '\n'))
+      ++cur;
+    if (cur == input_end)
+      break;
+
+    const char* line_begin = cur;
+    const char* line_end = line_segment_finder.FindEnd(line_begin);
+    cur = line_end;
 
     if (prev_line_continuable && IsLWS(*line_begin)) {
       // Join continuation; reduce the leading LWS to a single SP.
       raw_headers.push_back(' ');
-      raw_headers.append(FindFirstNonLWS(line_begin, line_end), line_end);
+      AppendWithoutNulls(FindFirstNonLWS(line_begin, line_end), line_end,
+                         &raw_headers);
     } else {
       // Terminate the previous line.
-      raw_headers.push_back('\n');
+      raw_headers.push_back('\0');
 
       // Copy the raw data to output.
-      raw_headers.append(line_begin, line_end);
+      AppendWithoutNulls(line_begin, line_end, &raw_headers);
 
       // Check if the current line can be continued.
       prev_line_continuable = IsLineSegmentContinuable(line_begin, line_end);
     }
   }
 
-  raw_headers.append("\n\n", 2);
-
-  // Use '\0' as the canonical line terminator. If the input already contained
-  // any embeded '\0' characters we will strip them first to avoid interpreting
-  // them as line breaks.
-  raw_headers.erase(std::remove(raw_headers.begin(), raw_headers.end(), '\0'),
-                    raw_headers.end());
-  std::replace(raw_headers.begin(), raw_headers.end(), '\n', '\0');
-
+  raw_headers.append(2, '\0');
   return raw_headers;
 }
 
@@ -778,9 +834,13 @@ bool HttpUtil::HeadersIterator::GetNext() {
     name_begin_ = lines_.token_begin();
     values_end_ = lines_.token_end();
 
-    string::const_iterator colon = std::find(name_begin_, values_end_, ':');
-    if (colon == values_end_)
+    // Tokens are never empty, so |name_begin_| can be dereferenced.
+    const char* line = &*name_begin_;
+    const char* colon_ptr = static_cast<const char*>(
+        memchr(line, ':', values_end_ - name_begin_));
+    if (!colon_ptr)
       continue;  // skip malformed header
+    string::const_iterator colon = name_begin_ + (colon_ptr - line);
 
     name_end_ = colon;
 
@@ -0,0 +1,133 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/http/http_util.h"
+
+#include <string>
+
+#include "base/basictypes.h"
+#include "base/memory/ref_counted.h"
+#include "base/perftimer.h"
+#include "net/http/http_response_headers.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace net {
+
+namespace {
+
+const int kNumIterations = 20000;
+
+// Response headers captured from a handful of popular sites, covering a
+// search results page, a CDN-served image, a static script behind a
+// reverse proxy and a JSON API with several cookies.
+const char* const kResponseHeaders[] = {
+  "HTTP/1.1 200 OK\r\n"
+  "Date: Tue, 05 Feb 2013 19:21:43 GMT\r\n"
+  "Expires: -1\r\n"
+  "Cache-Control: private, max-age=0\r\n"
+  "Content-Type: text/html; charset=UTF-8\r\n"
+  "Set-Cookie: PREF=ID=3c4d2a1b:FF=0:TM=1360092103:LM=1360092103:S=abcdef; "
+  "expires=Thu, 05-Feb-2015 19:21:43 GMT; path=/; domain=.example.com\r\n"
+  "Set-Cookie: NID=67=Xyz0123456789abcdefghijklmnop; "
+  "expires=Wed, 07-Aug-2013 19:21:43 GMT; path=/; domain=.example.com; "
+  "HttpOnly\r\n"
+  "P3P: CP=\"This is not a P3P policy! See http://www.example.com/p3p\"\r\n"
+  "Content-Encoding: gzip\r\n"
+  "Server: gws\r\n"
+  "X-XSS-Protection: 1; mode=block\r\n"
+  "X-Frame-Options: SAMEORIGIN\r\n"
+  "Transfer-Encoding: chunked\r\n"
+  "\r\n",
+
+  "HTTP/1.1 200 OK\r\n"
+  "Accept-Ranges: bytes\r\n"
+  "Cache-Control: max-age=31536000, public\r\n"
+  "Content-Type: image/png\r\n"
+  "Date: Tue, 05 Feb 2013 19:21:44 GMT\r\n"
+  "ETag: \"4f2a7b1c-3e8\"\r\n"
+  "Expires: Wed, 05 Feb 2014 19:21:44 GMT\r\n"
+  "Last-Modified: Thu, 02 Feb 2012 11:32:44 GMT\r\n"
+  "Server: ECS (iad/19AB)\r\n"
+  "X-Cache: HIT\r\n"
+  "Content-Length: 1000\r\n"
+  "\r\n",
+
+  "HTTP/1.1 200 OK\r\n"
+  "Server: nginx/1.2.6\r\n"
+  "Date: Tue, 05 Feb 2013 19:21:45 GMT\r\n"
+  "Content-Type: application/javascript\r\n"
+  "Content-Length: 93636\r\n"
+  "Connection: keep-alive\r\n"
+  "Vary: Accept-Encoding\r\n"
+  "Last-Modified: Mon, 04 Feb 2013 22:10:01 GMT\r\n"
+  "Cache-Control: public,\r\n"
+  "  max-age=86400\r\n"
+  "Access-Control-Allow-Origin: *\r\n"
+  "\r\n",
+
+  "HTTP/1.1 200 OK\n"
+  "Content-Type: application/json;charset=utf-8\n"
+  "Cache-Control: no-cache, no-store, must-revalidate, pre-check=0, "
+  "post-check=0\n"
+  "Pragma: no-cache\n"
+  "Set-Cookie: _session_id=BAh7CDoPY3JlYXRlZF9hdGwrCNo; path=/; "
+  "expires=Tue, 05 Feb 2013 20:21:46 GMT; HttpOnly\n"
+  "Set-Cookie: guest_id=v1%3A136009210612345678; Domain=.example.com; Path=/; "
+  "Expires=Thu, 05-Feb-2015 19:21:46 UTC\n"
+  "Set-Cookie: lang=en; path=/\n"
+  "Status: 200 OK\n"
+  "X-Runtime: 0.01234\n"
+  "X-Transaction: 4a5b6c7d8e9f0a1b\n"
+  "Strict-Transport-Security: max-age=631138519\n"
+  "\n",
+};
+
+}  // namespace
+
+TEST(HttpUtilPerfTest, AssembleRawHeaders) {
+  PerfTimeLogger timer("HttpUtil_AssembleRawHeaders");
+  for (int i = 0; i < kNumIterations; ++i) {
+    for (size_t j = 0; j < arraysize(kResponseHeaders); ++j) {
+      const std::string headers(kResponseHeaders[j]);
+      std::string raw = HttpUtil::AssembleRawHeaders(headers.data(),
+                                                     headers.size());
+      ASSERT_FALSE(raw.empty());
+    }
+  }
+  timer.Done();
+}
+
+TEST(HttpUtilPerfTest, HeadersIterator) {
+  std::string headers;
+  for (size_t j = 0; j < arraysize(kResponseHeaders); ++j)
+    headers += kResponseHeaders[j];
+
+  PerfTimeLogger timer("HttpUtil_HeadersIterator");
+  for (int i = 0; i < kNumIterations; ++i) {
+    HttpUtil::HeadersIterator it(headers.begin(), headers.end(), "\r\n");
+    int count = 0;
+    while (it.GetNext()) {
+      HttpUtil::ValuesIterator values(it.values_begin(), it.values_end(), ',');
+      while (values.GetNext())
+        ++count;
+    }
+    ASSERT_GT(count, 0);
+  }
+  timer.Done();
+}
+
+TEST(HttpUtilPerfTest, ParseResponseHeaders) {
+  PerfTimeLogger timer("HttpResponseHeaders_Parse");
+  for (int i = 0; i < kNumIterations; ++i) {
+    for (size_t j = 0; j < arraysize(kResponseHeaders); ++j) {
+      const std::string headers(kResponseHeaders[j]);
+      scoped_refptr<HttpResponseHeaders> parsed(new HttpResponseHeaders(
+          HttpUtil::AssembleRawHeaders(headers.data(), headers.size())));
+      ASSERT_EQ(200, parsed->response_code());
+    }
+  }
+  timer.Done();
+}
+
+}  // namespace net
@@ -279,6 +279,31 @@ TEST(HttpUtilTest, LocateEndOfHeaders) {
   }
 }
 
+TEST(HttpUtilTest, LocateEndOfHeadersWithOffset) {
+  struct {
+    const char* input;
+    int offset;
+    int expected_result;
+  } tests[] = {
+    { "foo\r\nbar\r\n\r\n", 0, 12 },
+    { "foo\r\nbar\r\n\r\n", 8, 12 },
+    { "foo\r\nbar\r\n\r\n", 10, -1 },
+    { "foo\nbar\n\r\njunk", 7, 10 },
+    { "foo\nbar\n\r\njunk", 8, -1 },
+    { "foo\nbar\n", 0, -1 },
+    { "foo\nbar\n\r", 0, -1 },
+    { "\n\n", 0, 2 },
+    { "\n\r\n", 0, 3 },
+    { "\r\n", 0, -1 },
+  };
+  for (size_t i = 0; i < ARRAYSIZE_UNSAFE(tests); ++i) {
+    int input_len = static_cast<int>(strlen(tests[i].input));
+    int eoh = HttpUtil::LocateEndOfHeaders(tests[i].input, input_len,
+                                           tests[i].offset);
+    EXPECT_EQ(tests[i].expected_result, eoh) << tests[i].input;
+  }
+}
+
 TEST(HttpUtilTest, AssembleRawHeaders) {
   struct {
     const char* input;  // with '|' representing '\0'
@@ -581,6 +606,13 @@ TEST(HttpUtilTest, AssembleRawHeaders) {
       "HTTP/1.0 200 OK\nFoo: 1|Foo2: 3\nBar: 2\n\n",
       "HTTP/1.0 200 OK|Foo: 1Foo2: 3|Bar: 2||"
     },
+
+    // Embed NULLs in a continuation line.  They should be stripped after
+    // the continuation is joined.
+    {
+      "HTTP/1.0 200 OK\nFoo: 1\n  a|b|\nBar: 2\n\n",
+      "HTTP/1.0 200 OK|Foo: 1 ab|Bar: 2||"
+    },
   };
   for (size_t i = 0; i < ARRAYSIZE_UNSAFE(tests); ++i) {
     std::string input = tests[i].input;
@@ -591,6 +623,24 @@ TEST(HttpUtilTest, AssembleRawHeaders) {
   }
 }
 
+// Headers delimited only by CR are split in a single pass over the input,
+// not with a search for LF to the end of the input on every line.
+TEST(HttpUtilTest, AssembleRawHeadersManyCROnlyLines) {
+  const int kNumLines = 100000;
+  std::string input("HTTP/1.0 200 OK\r");
+  std::string expected("HTTP/1.0 200 OK");
+  for (int i = 0; i < kNumLines; ++i) {
+    input.append("Foo: 1\r");
+    expected.append(1, '\0');
+    expected.append("Foo: 1");
+  }
+  input.append("\r");
+  expected.append(2, '\0');
+
+  EXPECT_EQ(expected,
+            HttpUtil::AssembleRawHeaders(input.data(), input.size()));
+}
+
 // Test SpecForRequest() and PathForRequest().
 TEST(HttpUtilTest, RequestUrlSanitize) {
   struct {
@@ -2067,13 +2067,26 @@
         '../base/base.gyp:test_support_perf',
         '../build/temp_gyp/googleurl.gyp:googleurl',
         '../testing/gtest.gyp:gtest',
+        '../third_party/zlib/zlib.gyp:zlib',
         'net',
         'net_test_support',
       ],
       'sources': [
+        'base/directory_lister_perftest.cc',
+        'base/dns_reloader_perftest.cc',
+        'base/file_stream_perftest.cc',
+        'base/gzip_filter_perftest.cc',
+        'base/host_mapping_rules_perftest.cc',
+        'base/mime_sniffer_perftest.cc',
+        'base/mock_filter_context.cc',
+        'base/mock_filter_context.h',
+        'base/sdch_filter_perftest.cc',
         'cookies/cookie_monster_perftest.cc',
         'disk_cache/disk_cache_perftest.cc',
+        'http/http_stream_parser_perftest.cc',
+        'http/http_util_perftest.cc',
         'proxy/proxy_resolver_perftest.cc',
+        'socket/ssl_server_socket_perftest.cc',
       ],
       'conditions': [
         [ 'use_v8_in_net==1', {
@@ -2149,6 +2162,8 @@
         'proxy/mock_proxy_script_fetcher.h',
         'proxy/proxy_config_service_common_unittest.cc',
         'proxy/proxy_config_service_common_unittest.h',
+        'socket/fake_stream_socket.cc',
+        'socket/fake_stream_socket.h',
         'socket/socket_test_util.cc',
         'socket/socket_test_util.h',
         'test/cert_test_util.cc',
@@ -8,6 +8,7 @@
 #include "base/format_macros.h"
 #include "base/logging.h"
 #include "base/message_loop.h"
+#include "base/metrics/histogram.h"
 #include "base/metrics/stats_counters.h"
 #include "base/stl_util.h"
 #include "base/string_util.h"
@@ -17,6 +18,10 @@
 #include "net/base/net_errors.h"
 #include "net/socket/client_socket_handle.h"
 
+#if defined(OS_LINUX)
+#include "net/base/address_tracker_linux.h"
+#endif
+
 using base::TimeDelta;
 
 namespace {
@@ -37,6 +42,40 @@ const int kCleanupInterval = 10;  // DO NOT INCREASE THIS TIMEOUT.
 // after a certain timeout has passed without receiving an ACK.
 bool g_connect_backup_jobs_enabled = true;
 
+// Fills |addresses| with the host's local addresses and the interfaces they
+// are on.  Returns false if the platform can't tell us.
+bool GetLocalAddresses(std::map<net::IPAddressNumber, int>* addresses) {
+#if defined(OS_LINUX)
+  const net::internal::AddressTrackerLinux* tracker =
+      net::NetworkChangeNotifier::GetAddressTracker();
+  if (!tracker)
+    return false;
+  net::internal::AddressTrackerLinux::AddressMap address_map =
+      tracker->GetAddressMap();
+  addresses->clear();
+  for (net::internal::AddressTrackerLinux::AddressMap::const_iterator it =
+           address_map.begin();
+       it != address_map.end(); ++it) {
+    (*addresses)[it->first] = it->second.ifa_index;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+// Returns true if |socket| may be bound to one of |addresses|.  Sockets whose
+// local address can't be determined are assumed to be.
+bool IsBoundToLocalAddress(const net::StreamSocket* socket,
+                           const std::set<net::IPAddressNumber>& addresses) {
+  if (addresses.empty())
+    return false;
+  net::IPEndPoint local_address;
+  if (socket->GetLocalAddress(&local_address) != net::OK)
+    return true;
+  return addresses.count(local_address.address()) > 0;
+}
+
 }  // namespace
 
 namespace net {
@@ -155,10 +194,13 @@ ClientSocketPoolBaseHelper::ClientSocketPoolBaseHelper(
       connect_job_factory_(connect_job_factory),
       connect_backup_jobs_enabled_(false),
       pool_generation_number_(0),
+      have_local_addresses_(false),
       weak_factory_(this) {
   DCHECK_LE(0, max_sockets_per_group);
   DCHECK_LE(max_sockets_per_group, max_sockets);
 
+  have_local_addresses_ = GetLocalAddresses(&local_addresses_);
+
   NetworkChangeNotifier::AddIPAddressObserver(this);
 }
 
@@ -744,7 +786,8 @@ void ClientSocketPoolBaseHelper::ReleaseSocket(const std::string& group_name,
   group->DecrementActiveSocketCount();
 
   const bool can_reuse = socket->IsConnectedAndIdle() &&
-      id == pool_generation_number_;
+      id == pool_generation_number_ &&
+      !IsBoundToLocalAddress(socket, invalid_local_addresses_);
   if (can_reuse) {
     // Add it to the idle list.
     AddIdleSocket(socket, group);
@@ -881,16 +924,82 @@ void ClientSocketPoolBaseHelper::OnConnectJobComplete(
 }
 
 void ClientSocketPoolBaseHelper::OnIPAddressChanged() {
-  FlushWithError(ERR_NETWORK_CHANGED);
+  LocalAddressMap old_local_addresses;
+  old_local_addresses.swap(local_addresses_);
+  bool had_local_addresses = have_local_addresses_;
+  have_local_addresses_ = GetLocalAddresses(&local_addresses_);
+  if (!had_local_addresses || !have_local_addresses_) {
+    FlushWithError(ERR_NETWORK_CHANGED);
+    return;
+  }
+
+  // Only addresses that went away, or moved to another interface, can break
+  // sockets bound to them.  Sockets bound to addresses that are still there
+  // keep working, so there's no need to throw away those warm connections.
+  std::set<IPAddressNumber> removed_addresses;
+  for (LocalAddressMap::const_iterator it = old_local_addresses.begin();
+       it != old_local_addresses.end(); ++it) {
+    LocalAddressMap::const_iterator current = local_addresses_.find(it->first);
+    if (current == local_addresses_.end() || current->second != it->second)
+      removed_addresses.insert(it->first);
+  }
+  FlushWithErrorForLocalAddresses(removed_addresses, ERR_NETWORK_CHANGED);
 }
 
 void ClientSocketPoolBaseHelper::FlushWithError(int error) {
   pool_generation_number_++;
+  invalid_local_addresses_.clear();
   CancelAllConnectJobs();
   CloseIdleSockets();
   CancelAllRequestsWithError(error);
 }
 
+void ClientSocketPoolBaseHelper::FlushWithErrorForLocalAddresses(
+    const std::set<IPAddressNumber>& addresses,
+    int error) {
+  // Addresses that have come back are usable again.
+  for (std::set<IPAddressNumber>::iterator it =
+           invalid_local_addresses_.begin();
+       it != invalid_local_addresses_.end();) {
+    if (ContainsKey(local_addresses_, *it))
+      invalid_local_addresses_.erase(it++);
+    else
+      ++it;
+  }
+
+  int idle_sockets_kept = idle_socket_count_;
+  if (!addresses.empty()) {
+    invalid_local_addresses_.insert(addresses.begin(), addresses.end());
+    CancelAllConnectJobs();
+
+    GroupMap::iterator i = group_map_.begin();
+    while (i != group_map_.end()) {
+      Group* group = i->second;
+      std::list<IdleSocket>::iterator j =
+          group->mutable_idle_sockets()->begin();
+      while (j != group->idle_sockets().end()) {
+        if (IsBoundToLocalAddress(j->socket, addresses)) {
+          delete j->socket;
+          j = group->mutable_idle_sockets()->erase(j);
+          DecrementIdleCount();
+        } else {
+          ++j;
+        }
+      }
+      if (group->IsEmpty())
+        RemoveGroup(i++);
+      else
+        ++i;
+    }
+    idle_sockets_kept = idle_socket_count_;
+
+    CancelAllRequestsWithError(error);
+  }
+  // Each of these would have had to reconnect under a full flush.
+  UMA_HISTOGRAM_COUNTS_1000("Net.SocketPool.IdleSocketsKeptOnIPAddressChange",
+                            idle_sockets_kept);
+}
+
 bool ClientSocketPoolBaseHelper::IsStalled() const {
   // If we are not using |max_sockets_|, then clearly we are not stalled
   if ((handed_out_socket_count_ + connecting_socket_count_) < max_sockets_)
@@ -42,6 +42,7 @@
 #include "net/base/net_errors.h"
 #include "net/base/net_export.h"
 #include "net/base/net_log.h"
+#include "net/base/net_util.h"
 #include "net/base/network_change_notifier.h"
 #include "net/base/request_priority.h"
 #include "net/socket/client_socket_pool.h"
@@ -235,6 +236,16 @@ class NET_EXPORT_PRIVATE ClientSocketPoolBaseHelper
   // See ClientSocketPool::FlushWithError for documentation on this function.
   void FlushWithError(int error);
 
+  // Like FlushWithError(), but spares sockets that can't be bound to any of
+  // the local |addresses|: idle sockets bound elsewhere stay idle, and sockets
+  // handed out now are only discarded on release if they're bound to one of
+  // them.  Connect jobs and pending requests are still failed with |error|,
+  // as there is no telling which address a connect job will end up using.
+  // Does nothing if |addresses| is empty.
+  void FlushWithErrorForLocalAddresses(
+      const std::set<IPAddressNumber>& addresses,
+      int error);
+
   // See ClientSocketPool::IsStalled for documentation on this function.
   bool IsStalled() const;
 
@@ -319,6 +330,9 @@ class NET_EXPORT_PRIVATE ClientSocketPoolBaseHelper
  private:
   friend class base::RefCounted<ClientSocketPoolBaseHelper>;
 
+  // Maps each local address to the index of the interface it's on.
+  typedef std::map<IPAddressNumber, int> LocalAddressMap;
+
   // Entry for a persistent socket which became idle at time |start_time|.
   struct IdleSocket {
     IdleSocket() : socket(NULL) {}
@@ -584,6 +598,16 @@ class NET_EXPORT_PRIVATE ClientSocketPoolBaseHelper
   // to the pool, we can make sure that they are discarded rather than reused.
   int pool_generation_number_;
 
+  // The local addresses as of the last IP address change, where the platform
+  // can tell us (see NetworkChangeNotifier::GetAddressTracker()).  Used to
+  // work out which addresses the next change removed.
+  LocalAddressMap local_addresses_;
+  bool have_local_addresses_;
+
+  // Local addresses removed since the last full flush.  Sockets bound to one
+  // of these are discarded when released rather than reused.
+  std::set<IPAddressNumber> invalid_local_addresses_;
+
   std::set<LayeredPool*> higher_layer_pools_;
 
   base::WeakPtrFactory<ClientSocketPoolBaseHelper> weak_factory_;
@@ -705,6 +729,12 @@ class ClientSocketPoolBase {
 
   void FlushWithError(int error) { helper_.FlushWithError(error); }
 
+  void FlushWithErrorForLocalAddresses(
+      const std::set<IPAddressNumber>& addresses,
+      int error) {
+    helper_.FlushWithErrorForLocalAddresses(addresses, error);
+  }
+
   bool IsStalled() const { return helper_.IsStalled(); }
 
   void CloseIdleSockets() { return helper_.CloseIdleSockets(); }
@@ -23,6 +23,7 @@
 #include "net/base/net_errors.h"
 #include "net/base/net_log.h"
 #include "net/base/net_log_unittest.h"
+#include "net/base/net_util.h"
 #include "net/base/request_priority.h"
 #include "net/base/test_completion_callback.h"
 #include "net/http/http_response_headers.h"
@@ -43,6 +44,8 @@ namespace {
 
 const int kDefaultMaxSockets = 4;
 const int kDefaultMaxSocketsPerGroup = 2;
+// The local address every MockClientSocket claims to be bound to.
+const char kLocalAddress[] = "127.0.0.1";
 const net::RequestPriority kDefaultPriority = MEDIUM;
 
 // Make sure |handle| sets load times correctly when it has been assigned a
@@ -151,8 +154,11 @@ class MockClientSocket : public StreamSocket {
     return ERR_UNEXPECTED;
   }
 
-  virtual int GetLocalAddress(IPEndPoint* /* address */) const OVERRIDE {
-    return ERR_UNEXPECTED;
+  virtual int GetLocalAddress(IPEndPoint* address) const OVERRIDE {
+    IPAddressNumber ip;
+    CHECK(ParseIPLiteralToNumber(kLocalAddress, &ip));
+    *address = IPEndPoint(ip, 1234);
+    return OK;
   }
 
   virtual const BoundNetLog& NetLog() const OVERRIDE {
@@ -532,6 +538,12 @@ class TestClientSocketPool : public ClientSocketPool {
     base_.FlushWithError(error);
   }
 
+  void FlushWithErrorForLocalAddresses(
+      const std::set<IPAddressNumber>& addresses,
+      int error) {
+    base_.FlushWithErrorForLocalAddresses(addresses, error);
+  }
+
   virtual bool IsStalled() const OVERRIDE {
     return base_.IsStalled();
   }
@@ -2525,6 +2537,49 @@ TEST_F(ClientSocketPoolBaseTest, DoNotReuseSocketAfterFlush) {
   EXPECT_EQ(ClientSocketHandle::UNUSED, handle.reuse_type());
 }
 
+// Only idle sockets bound to an address that went away should be closed, and
+// only sockets bound to it should be discarded when released.
+TEST_F(ClientSocketPoolBaseTest, FlushWithErrorForLocalAddresses) {
+  CreatePool(kDefaultMaxSockets, kDefaultMaxSocketsPerGroup);
+  connect_job_factory_->set_job_type(TestConnectJob::kMockJob);
+
+  ClientSocketHandle handle;
+  TestCompletionCallback callback;
+  EXPECT_EQ(OK, handle.Init("a", params_, kDefaultPriority,
+                            callback.callback(), pool_.get(), BoundNetLog()));
+  handle.Reset();
+  EXPECT_EQ(1, pool_->IdleSocketCount());
+
+  // Some other address went away.  The idle socket is kept.
+  std::set<IPAddressNumber> addresses;
+  IPAddressNumber other_address;
+  ASSERT_TRUE(ParseIPLiteralToNumber("10.0.0.1", &other_address));
+  addresses.insert(other_address);
+  pool_->FlushWithErrorForLocalAddresses(addresses, ERR_NETWORK_CHANGED);
+  EXPECT_EQ(1, pool_->IdleSocketCount());
+
+  EXPECT_EQ(OK, handle.Init("a", params_, kDefaultPriority,
+                            callback.callback(), pool_.get(), BoundNetLog()));
+  EXPECT_EQ(ClientSocketHandle::REUSED_IDLE, handle.reuse_type());
+
+  handle.Reset();
+  EXPECT_EQ(1, pool_->IdleSocketCount());
+
+  // The socket's own address went away.  The idle socket is closed.
+  IPAddressNumber local_address;
+  ASSERT_TRUE(ParseIPLiteralToNumber(kLocalAddress, &local_address));
+  addresses.insert(local_address);
+  pool_->FlushWithErrorForLocalAddresses(addresses, ERR_NETWORK_CHANGED);
+  EXPECT_EQ(0, pool_->IdleSocketCount());
+
+  // Until the address comes back, sockets bound to it aren't reused.
+  EXPECT_EQ(OK, handle.Init("a", params_, kDefaultPriority,
+                            callback.callback(), pool_.get(), BoundNetLog()));
+  EXPECT_EQ(ClientSocketHandle::UNUSED, handle.reuse_type());
+  handle.Reset();
+  EXPECT_EQ(0, pool_->IdleSocketCount());
+}
+
 class ConnectWithinCallback : public TestCompletionCallbackBase {
  public:
   ConnectWithinCallback(
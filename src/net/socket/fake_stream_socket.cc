@@ -0,0 +1,188 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/socket/fake_stream_socket.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "base/bind.h"
+#include "base/message_loop.h"
+#include "net/base/io_buffer.h"
+#include "net/base/ip_endpoint.h"
+#include "net/base/net_errors.h"
+
+namespace net {
+
+FakeDataChannel::FakeDataChannel()
+    : read_buf_len_(0),
+      weak_factory_(this),
+      closed_(false),
+      write_called_after_close_(false) {
+}
+
+FakeDataChannel::~FakeDataChannel() {}
+
+int FakeDataChannel::Read(IOBuffer* buf, int buf_len,
+                          const CompletionCallback& callback) {
+  if (closed_)
+    return 0;
+  if (data_.empty()) {
+    read_callback_ = callback;
+    read_buf_ = buf;
+    read_buf_len_ = buf_len;
+    return ERR_IO_PENDING;
+  }
+  return PropagateData(buf, buf_len);
+}
+
+int FakeDataChannel::Write(IOBuffer* buf, int buf_len,
+                           const CompletionCallback& callback) {
+  if (closed_) {
+    if (write_called_after_close_)
+      return ERR_CONNECTION_RESET;
+    write_called_after_close_ = true;
+    write_callback_ = callback;
+    base::MessageLoop::current()->PostTask(
+        FROM_HERE, base::Bind(&FakeDataChannel::DoWriteCallback,
+                              weak_factory_.GetWeakPtr()));
+    return ERR_IO_PENDING;
+  }
+  data_.push(new DrainableIOBuffer(buf, buf_len));
+  base::MessageLoop::current()->PostTask(
+      FROM_HERE, base::Bind(&FakeDataChannel::DoReadCallback,
+                            weak_factory_.GetWeakPtr()));
+  return buf_len;
+}
+
+void FakeDataChannel::Close() {
+  closed_ = true;
+}
+
+void FakeDataChannel::DoReadCallback() {
+  if (read_callback_.is_null() || data_.empty())
+    return;
+
+  int copied = PropagateData(read_buf_, read_buf_len_);
+  CompletionCallback callback = read_callback_;
+  read_callback_.Reset();
+  read_buf_ = NULL;
+  read_buf_len_ = 0;
+  callback.Run(copied);
+}
+
+void FakeDataChannel::DoWriteCallback() {
+  if (write_callback_.is_null())
+    return;
+
+  CompletionCallback callback = write_callback_;
+  write_callback_.Reset();
+  callback.Run(ERR_CONNECTION_RESET);
+}
+
+int FakeDataChannel::PropagateData(scoped_refptr<IOBuffer> read_buf,
+                                   int read_buf_len) {
+  scoped_refptr<DrainableIOBuffer> buf = data_.front();
+  int copied = std::min(buf->BytesRemaining(), read_buf_len);
+  memcpy(read_buf->data(), buf->data(), copied);
+  buf->DidConsume(copied);
+
+  if (!buf->BytesRemaining())
+    data_.pop();
+  return copied;
+}
+
+FakeSocket::FakeSocket(FakeDataChannel* incoming_channel,
+                       FakeDataChannel* outgoing_channel)
+    : incoming_(incoming_channel),
+      outgoing_(outgoing_channel),
+      random_io_sizes_(true) {
+}
+
+FakeSocket::~FakeSocket() {}
+
+int FakeSocket::Read(IOBuffer* buf, int buf_len,
+                     const CompletionCallback& callback) {
+  // Read random number of bytes.
+  if (random_io_sizes_)
+    buf_len = rand() % buf_len + 1;
+  return incoming_->Read(buf, buf_len, callback);
+}
+
+int FakeSocket::Write(IOBuffer* buf, int buf_len,
+                      const CompletionCallback& callback) {
+  // Write random number of bytes.
+  if (random_io_sizes_)
+    buf_len = rand() % buf_len + 1;
+  return outgoing_->Write(buf, buf_len, callback);
+}
+
+bool FakeSocket::SetReceiveBufferSize(int32 size) {
+  return true;
+}
+
+bool FakeSocket::SetSendBufferSize(int32 size) {
+  return true;
+}
+
+int FakeSocket::Connect(const CompletionCallback& callback) {
+  return OK;
+}
+
+void FakeSocket::Disconnect() {
+  incoming_->Close();
+  outgoing_->Close();
+}
+
+bool FakeSocket::IsConnected() const {
+  return true;
+}
+
+bool FakeSocket::IsConnectedAndIdle() const {
+  return true;
+}
+
+int FakeSocket::GetPeerAddress(IPEndPoint* address) const {
+  IPAddressNumber ip_address(kIPv4AddressSize);
+  *address = IPEndPoint(ip_address, 0 /*port*/);
+  return OK;
+}
+
+int FakeSocket::GetLocalAddress(IPEndPoint* address) const {
+  IPAddressNumber ip_address(kIPv4AddressSize);
+  *address = IPEndPoint(ip_address, 0 /*port*/);
+  return OK;
+}
+
+const BoundNetLog& FakeSocket::NetLog() const {
+  return net_log_;
+}
+
+void FakeSocket::SetSubresourceSpeculation() {}
+
+void FakeSocket::SetOmniboxSpeculation() {}
+
+bool FakeSocket::WasEverUsed() const {
+  return true;
+}
+
+bool FakeSocket::UsingTCPFastOpen() const {
+  return false;
+}
+
+bool FakeSocket::WasNpnNegotiated() const {
+  return false;
+}
+
+NextProto FakeSocket::GetNegotiatedProtocol() const {
+  return kProtoUnknown;
+}
+
+bool FakeSocket::GetSSLInfo(SSLInfo* ssl_info) {
+  return false;
+}
+
+}  // namespace net
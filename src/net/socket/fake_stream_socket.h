@@ -0,0 +1,120 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef NET_SOCKET_FAKE_STREAM_SOCKET_H_
+#define NET_SOCKET_FAKE_STREAM_SOCKET_H_
+
+#include <queue>
+
+#include "base/basictypes.h"
+#include "base/compiler_specific.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/weak_ptr.h"
+#include "net/base/completion_callback.h"
+#include "net/base/net_log.h"
+#include "net/socket/stream_socket.h"
+
+namespace net {
+
+class DrainableIOBuffer;
+class IOBuffer;
+
+// Test helpers for connecting two StreamSockets, such as an SSLClientSocket
+// and an SSLServerSocket, in memory:
+// 1. FakeDataChannel
+//    Implements the actual exchange of data in one direction.
+//
+// 2. FakeSocket
+//    Connects a socket to a pair of FakeDataChannels. This class is just a
+//    stub.
+
+class FakeDataChannel {
+ public:
+  FakeDataChannel();
+  ~FakeDataChannel();
+
+  // Writes always complete synchronously. A Read() with no data available
+  // completes once the next Write() arrives.
+  int Read(IOBuffer* buf, int buf_len, const CompletionCallback& callback);
+  int Write(IOBuffer* buf, int buf_len, const CompletionCallback& callback);
+
+  // Closes the FakeDataChannel. After Close() is called, Read() returns 0,
+  // indicating EOF, and Write() fails with ERR_CONNECTION_RESET. Note that
+  // after the FakeDataChannel is closed, the first Write() call completes
+  // asynchronously, which is necessary to reproduce bug 127822.
+  void Close();
+
+ private:
+  void DoReadCallback();
+  void DoWriteCallback();
+  int PropagateData(scoped_refptr<IOBuffer> read_buf, int read_buf_len);
+
+  CompletionCallback read_callback_;
+  scoped_refptr<IOBuffer> read_buf_;
+  int read_buf_len_;
+
+  CompletionCallback write_callback_;
+
+  std::queue<scoped_refptr<DrainableIOBuffer> > data_;
+
+  base::WeakPtrFactory<FakeDataChannel> weak_factory_;
+
+  // True if Close() has been called.
+  bool closed_;
+
+  // Controls the completion of Write() after the FakeDataChannel is closed.
+  // After the FakeDataChannel is closed, the first Write() call completes
+  // asynchronously.
+  bool write_called_after_close_;
+
+  DISALLOW_COPY_AND_ASSIGN(FakeDataChannel);
+};
+
+class FakeSocket : public StreamSocket {
+ public:
+  FakeSocket(FakeDataChannel* incoming_channel,
+             FakeDataChannel* outgoing_channel);
+  virtual ~FakeSocket();
+
+  // By default each Read() and Write() handles a random number of bytes, to
+  // exercise callers' handling of partial I/O. Tests that measure throughput
+  // can turn that off so every call uses the whole buffer.
+  void set_random_io_sizes(bool random_io_sizes) {
+    random_io_sizes_ = random_io_sizes;
+  }
+
+  // StreamSocket implementation:
+  virtual int Read(IOBuffer* buf, int buf_len,
+                   const CompletionCallback& callback) OVERRIDE;
+  virtual int Write(IOBuffer* buf, int buf_len,
+                    const CompletionCallback& callback) OVERRIDE;
+  virtual bool SetReceiveBufferSize(int32 size) OVERRIDE;
+  virtual bool SetSendBufferSize(int32 size) OVERRIDE;
+  virtual int Connect(const CompletionCallback& callback) OVERRIDE;
+  virtual void Disconnect() OVERRIDE;
+  virtual bool IsConnected() const OVERRIDE;
+  virtual bool IsConnectedAndIdle() const OVERRIDE;
+  virtual int GetPeerAddress(IPEndPoint* address) const OVERRIDE;
+  virtual int GetLocalAddress(IPEndPoint* address) const OVERRIDE;
+  virtual const BoundNetLog& NetLog() const OVERRIDE;
+  virtual void SetSubresourceSpeculation() OVERRIDE;
+  virtual void SetOmniboxSpeculation() OVERRIDE;
+  virtual bool WasEverUsed() const OVERRIDE;
+  virtual bool UsingTCPFastOpen() const OVERRIDE;
+  virtual bool WasNpnNegotiated() const OVERRIDE;
+  virtual NextProto GetNegotiatedProtocol() const OVERRIDE;
+  virtual bool GetSSLInfo(SSLInfo* ssl_info) OVERRIDE;
+
+ private:
+  BoundNetLog net_log_;
+  FakeDataChannel* incoming_;
+  FakeDataChannel* outgoing_;
+  bool random_io_sizes_;
+
+  DISALLOW_COPY_AND_ASSIGN(FakeSocket);
+};
+
+}  // namespace net
+
+#endif  // NET_SOCKET_FAKE_STREAM_SOCKET_H_
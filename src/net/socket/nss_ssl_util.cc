@@ -19,6 +19,7 @@
 #include "base/values.h"
 #include "build/build_config.h"
 #include "crypto/nss_util.h"
+#include "net/base/io_buffer.h"
 #include "net/base/net_errors.h"
 #include "net/base/net_log.h"
 
@@ -250,4 +251,14 @@ void LogFailedNSSFunction(const BoundNetLog& net_log,
                  function, param, PR_GetError()));
 }
 
+scoped_refptr<IOBuffer> LendMemioBuffer(IOBuffer* storage,
+                                        const char* data,
+                                        int len) {
+  int offset = static_cast<int>(data - storage->data());
+  scoped_refptr<DrainableIOBuffer> buffer(
+      new DrainableIOBuffer(storage, offset + len));
+  buffer->SetOffset(offset);
+  return buffer;
+}
+
 }  // namespace net
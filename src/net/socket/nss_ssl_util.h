@@ -10,11 +10,13 @@
 
 #include <prerror.h>
 
+#include "base/memory/ref_counted.h"
 #include "net/base/net_export.h"
 
 namespace net {
 
 class BoundNetLog;
+class IOBuffer;
 
 // Initalize NSS SSL library.
 NET_EXPORT void EnsureNSSSSLInit();
@@ -30,6 +32,14 @@ PRErrorCode MapErrorToNSS(int result);
 // Map NSS error code to network error code.
 int MapNSSError(PRErrorCode err);
 
+// Returns an IOBuffer for the |len| bytes at |data|, which lie within
+// |storage|, the memory lent to memio for one of its circular buffers. The
+// returned buffer holds a reference to |storage|, so transport reads and
+// writes can use memio's memory directly and keep it alive while pending.
+scoped_refptr<IOBuffer> LendMemioBuffer(IOBuffer* storage,
+                                        const char* data,
+                                        int len);
+
 }  // namespace net
 
 #endif  // NET_SOCKET_NSS_SSL_UTIL_H_
@@ -610,9 +610,14 @@ class SSLClientSocketNSS::Core : public base::RefCountedThreadSafe<Core> {
 
   // Called on the network task runner.
   // Transfers ownership of |socket|, an NSS SSL socket, and |buffers|, the
-  // underlying memio implementation, to the Core. Returns true if the Core
-  // was successfully registered with the socket.
-  bool Init(PRFileDesc* socket, memio_Private* buffers);
+  // underlying memio implementation, to the Core. |recv_storage| and
+  // |send_storage| are the memory memio was created with for its read and
+  // write buffers. Returns true if the Core was successfully registered with
+  // the socket.
+  bool Init(PRFileDesc* socket,
+            memio_Private* buffers,
+            IOBuffer* recv_storage,
+            IOBuffer* send_storage);
 
   // Called on the network task runner.
   // Sets the predicted certificate chain that the peer will send, for use
@@ -852,6 +857,11 @@ class SSLClientSocketNSS::Core : public base::RefCountedThreadSafe<Core> {
   // Buffers for the network end of the SSL state machine
   memio_Private* nss_bufs_;
 
+  // The memory behind |nss_bufs_|. Transport reads go straight into
+  // |recv_storage_| and transport writes straight out of |send_storage_|.
+  scoped_refptr<IOBuffer> recv_storage_;
+  scoped_refptr<IOBuffer> send_storage_;
+
   // Used by DoPayloadRead() when attempting to fill the caller's buffer with
   // as much data as possible, without blocking.
   // If DoPayloadRead() encounters an error after having read some data, stores
@@ -965,13 +975,17 @@ SSLClientSocketNSS::Core::~Core() {
 }
 
 bool SSLClientSocketNSS::Core::Init(PRFileDesc* socket,
-                                    memio_Private* buffers) {
+                                    memio_Private* buffers,
+                                    IOBuffer* recv_storage,
+                                    IOBuffer* send_storage) {
   DCHECK(OnNetworkTaskRunner());
   DCHECK(!nss_fd_);
   DCHECK(!nss_bufs_);
 
   nss_fd_ = socket;
   nss_bufs_ = buffers;
+  recv_storage_ = recv_storage;
+  send_storage_ = send_storage;
 
   SECStatus rv = SECSuccess;
 
@@ -2155,7 +2169,10 @@ int SSLClientSocketNSS::Core::BufferRecv() {
     // buffer too full to read into, so no I/O possible at moment
     rv = ERR_IO_PENDING;
   } else {
-    scoped_refptr<IOBuffer> read_buffer(new IOBuffer(nb));
+    // Read straight into |nss_bufs_|. memio leaves that region alone until
+    // memio_PutReadResult() is called, once the read completes.
+    scoped_refptr<IOBuffer> read_buffer(
+        LendMemioBuffer(recv_storage_, buf, nb));
     if (OnNetworkTaskRunner()) {
       rv = DoBufferRecv(read_buffer, nb);
     } else {
@@ -2169,11 +2186,8 @@ int SSLClientSocketNSS::Core::BufferRecv() {
     if (rv == ERR_IO_PENDING) {
       transport_recv_busy_ = true;
     } else {
-      if (rv > 0) {
-        memcpy(buf, read_buffer->data(), rv);
-      } else if (rv == 0) {
+      if (rv == 0)
         transport_recv_eof_ = true;
-      }
       memio_PutReadResult(nss_bufs_, MapErrorToNSS(rv));
     }
   }
@@ -2193,13 +2207,16 @@ int SSLClientSocketNSS::Core::BufferSend() {
   const char* buf2;
   unsigned int len1, len2;
   memio_GetWriteParams(nss_bufs_, &buf1, &len1, &buf2, &len2);
-  const unsigned int len = len1 + len2;
+  // Send straight out of |nss_bufs_|, which memio leaves alone until
+  // memio_PutWriteResult() is called. If the data wraps around the end of
+  // the buffer, only the first part goes out now; the rest is sent by the
+  // next call, just as after a partial write.
+  const int len = len1;
 
   int rv = 0;
   if (len) {
-    scoped_refptr<IOBuffer> send_buffer(new IOBuffer(len));
-    memcpy(send_buffer->data(), buf1, len1);
-    memcpy(send_buffer->data() + len1, buf2, len2);
+    scoped_refptr<IOBuffer> send_buffer(
+        LendMemioBuffer(send_storage_, buf1, len));
 
     if (OnNetworkTaskRunner()) {
       rv = DoBufferSend(send_buffer, len);
@@ -2747,10 +2764,11 @@ void SSLClientSocketNSS::Core::BufferRecvComplete(
   DCHECK(OnNSSTaskRunner());
 
   if (result > 0) {
+    // |read_buffer| is the region of |nss_bufs_| handed out by BufferRecv().
     char* buf;
     int nb = memio_GetReadParams(nss_bufs_, &buf);
     CHECK_GE(nb, result);
-    memcpy(buf, read_buffer->data(), result);
+    DCHECK(buf == read_buffer->data());
   } else if (result == 0) {
     transport_recv_eof_ = true;
   }
@@ -3118,7 +3136,11 @@ void SSLClientSocketNSS::InitCore() {
 
 int SSLClientSocketNSS::InitializeSSLOptions() {
   // Transport connected, now hook it up to nss
-  nss_fd_ = memio_CreateIOLayer(kRecvBufferSize, kSendBufferSize);
+  scoped_refptr<IOBuffer> recv_storage(new IOBuffer(kRecvBufferSize));
+  scoped_refptr<IOBuffer> send_storage(new IOBuffer(kSendBufferSize));
+  nss_fd_ = memio_CreateIOLayerWithBuffers(
+      recv_storage->data(), kRecvBufferSize,
+      send_storage->data(), kSendBufferSize);
   if (nss_fd_ == NULL) {
     return ERR_OUT_OF_MEMORY;  // TODO(port): map NSPR error code.
   }
@@ -3234,7 +3256,7 @@ int SSLClientSocketNSS::InitializeSSLOptions() {
     return ERR_UNEXPECTED;
   }
 
-  if (!core_->Init(nss_fd_, nss_bufs))
+  if (!core_->Init(nss_fd_, nss_bufs, recv_storage, send_storage))
     return ERR_UNEXPECTED;
 
   // Tell SSL the hostname we're trying to connect to.
@@ -5,6 +5,8 @@
 #ifndef NET_SOCKET_SSL_SERVER_SOCKET_H_
 #define NET_SOCKET_SSL_SERVER_SOCKET_H_
 
+#include <vector>
+
 #include "base/basictypes.h"
 #include "net/base/completion_callback.h"
 #include "net/base/net_export.h"
@@ -41,6 +43,27 @@ class SSLServerSocket : public SSLSocket {
 // omitted.
 NET_EXPORT void EnableSSLServerSockets();
 
+// A key protecting the TLS session tickets issued by SSL server sockets.
+// Servers, in this or other processes, that use the same keys can resume
+// each other's sessions.
+struct NET_EXPORT SessionTicketKey {
+  // Sent in each ticket so the key can be found when the ticket comes back.
+  uint8 name[16];
+  uint8 aes_key[32];
+  uint8 hmac_key[32];
+};
+
+// Sets the keys that SSL server sockets use for session tickets, and enables
+// tickets on server sockets created from then on. New tickets are issued
+// under |keys[0]| and tickets issued under any of |keys| are accepted, so to
+// rotate keys, pass the new key first followed by the keys that outstanding
+// tickets were issued under. An empty |keys| disables tickets again.
+//
+// May be called at any time and from any thread. Returns false, leaving the
+// previous keys in place, on failure.
+NET_EXPORT bool SetSSLServerSessionTicketKeys(
+    const std::vector<SessionTicketKey>& keys);
+
 // Creates an SSL server socket over an already-connected transport socket.
 // The caller must provide the server certificate and private key to use.
 //
@@ -29,6 +29,7 @@
 
 #include <limits>
 
+#include "base/atomicops.h"
 #include "base/lazy_instance.h"
 #include "base/memory/ref_counted.h"
 #include "crypto/rsa_private_key.h"
@@ -54,6 +55,9 @@ namespace {
 
 bool g_nss_server_sockets_init = false;
 
+// Non-zero once SetSSLServerSessionTicketKeys() has installed ticket keys.
+base::subtle::Atomic32 g_session_tickets_enabled = 0;
+
 class NSSSSLServerInitSingleton {
  public:
   NSSSSLServerInitSingleton() {
@@ -78,6 +82,34 @@ void EnableSSLServerSockets() {
   g_nss_ssl_server_init_singleton.Get();
 }
 
+bool SetSSLServerSessionTicketKeys(
+    const std::vector<SessionTicketKey>& keys) {
+  EnsureNSSSSLInit();
+
+  COMPILE_ASSERT(sizeof(SessionTicketKey) == sizeof(::SSLSessionTicketKey),
+                 session_ticket_key_size_mismatch);
+  std::vector< ::SSLSessionTicketKey> nss_keys(keys.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    memcpy(nss_keys[i].name, keys[i].name, sizeof(nss_keys[i].name));
+    memcpy(nss_keys[i].aesKey, keys[i].aes_key, sizeof(nss_keys[i].aesKey));
+    memcpy(nss_keys[i].macKey, keys[i].hmac_key, sizeof(nss_keys[i].macKey));
+  }
+
+  // Stop new sockets from using tickets before the keys go away, and only
+  // start once the keys are in place.
+  if (keys.empty())
+    base::subtle::Release_Store(&g_session_tickets_enabled, 0);
+  SECStatus rv = SSL_SetSessionTicketKeys(
+      nss_keys.empty() ? NULL : &nss_keys[0], nss_keys.size());
+  if (!nss_keys.empty())
+    memset(&nss_keys[0], 0, nss_keys.size() * sizeof(nss_keys[0]));
+  if (rv != SECSuccess)
+    return false;
+  if (!keys.empty())
+    base::subtle::Release_Store(&g_session_tickets_enabled, 1);
+  return true;
+}
+
 SSLServerSocket* CreateSSLServerSocket(
     StreamSocket* socket,
     X509Certificate* cert,
@@ -308,8 +340,13 @@ bool SSLServerSocketNSS::GetSSLInfo(SSLInfo* ssl_info) {
 }
 
 int SSLServerSocketNSS::InitializeSSLOptions() {
-  // Transport connected, now hook it up to nss
-  nss_fd_ = memio_CreateIOLayer(kRecvBufferSize, kSendBufferSize);
+  // Transport connected, now hook it up to nss. Transport reads and writes
+  // go straight into and out of memio's buffers, so that memory is ours.
+  recv_storage_ = new IOBuffer(kRecvBufferSize);
+  send_storage_ = new IOBuffer(kSendBufferSize);
+  nss_fd_ = memio_CreateIOLayerWithBuffers(
+      recv_storage_->data(), kRecvBufferSize,
+      send_storage_->data(), kSendBufferSize);
   if (nss_fd_ == NULL) {
     return ERR_OUT_OF_MEMORY;  // TODO(port): map NSPR error code.
   }
@@ -357,8 +394,11 @@ int SSLServerSocketNSS::InitializeSSLOptions() {
     SSL_CipherPrefSet(nss_fd_, *it, PR_FALSE);
   }
 
-  // Server socket doesn't need session tickets.
-  rv = SSL_OptionSet(nss_fd_, SSL_ENABLE_SESSION_TICKETS, PR_FALSE);
+  // Session tickets are only issued under keys installed with
+  // SetSSLServerSessionTicketKeys(), so that they can be shared and rotated.
+  PRBool enable_tickets =
+      base::subtle::Acquire_Load(&g_session_tickets_enabled) != 0;
+  rv = SSL_OptionSet(nss_fd_, SSL_ENABLE_SESSION_TICKETS, enable_tickets);
   if (rv != SECSuccess) {
     LogFailedNSSFunction(
         net_log_, "SSL_OptionSet", "SSL_ENABLE_SESSION_TICKETS");
@@ -533,13 +573,14 @@ int SSLServerSocketNSS::BufferSend(void) {
   const char* buf2;
   unsigned int len1, len2;
   memio_GetWriteParams(nss_bufs_, &buf1, &len1, &buf2, &len2);
-  const unsigned int len = len1 + len2;
+  // Send straight out of |nss_bufs_|. Data that wraps around the end of the
+  // buffer is sent by the next call, as after a partial write.
+  const int len = len1;
 
   int rv = 0;
   if (len) {
-    scoped_refptr<IOBuffer> send_buffer(new IOBuffer(len));
-    memcpy(send_buffer->data(), buf1, len1);
-    memcpy(send_buffer->data() + len1, buf2, len2);
+    scoped_refptr<IOBuffer> send_buffer(
+        LendMemioBuffer(send_storage_, buf1, len));
     rv = transport_socket_->Write(
         send_buffer, len,
         base::Bind(&SSLServerSocketNSS::BufferSendComplete,
@@ -570,7 +611,8 @@ int SSLServerSocketNSS::BufferRecv(void) {
     // buffer too full to read into, so no I/O possible at moment
     rv = ERR_IO_PENDING;
   } else {
-    recv_buffer_ = new IOBuffer(nb);
+    // Read straight into |nss_bufs_|.
+    recv_buffer_ = LendMemioBuffer(recv_storage_, buf, nb);
     rv = transport_socket_->Read(
         recv_buffer_, nb,
         base::Bind(&SSLServerSocketNSS::BufferRecvComplete,
@@ -578,8 +620,6 @@ int SSLServerSocketNSS::BufferRecv(void) {
     if (rv == ERR_IO_PENDING) {
       transport_recv_busy_ = true;
     } else {
-      if (rv > 0)
-        memcpy(buf, recv_buffer_->data(), rv);
       memio_PutReadResult(nss_bufs_, MapErrorToNSS(rv));
       recv_buffer_ = NULL;
     }
@@ -588,11 +628,6 @@ int SSLServerSocketNSS::BufferRecv(void) {
 }
 
 void SSLServerSocketNSS::BufferRecvComplete(int result) {
-  if (result > 0) {
-    char* buf;
-    memio_GetReadParams(nss_bufs_, &buf);
-    memcpy(buf, recv_buffer_->data(), result);
-  }
   recv_buffer_ = NULL;
   memio_PutReadResult(nss_bufs_, MapErrorToNSS(result));
   transport_recv_busy_ = false;
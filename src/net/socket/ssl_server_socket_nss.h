@@ -127,6 +127,11 @@ class SSLServerSocketNSS : public SSLServerSocket {
   // Buffers for the network end of the SSL state machine
   memio_Private* nss_bufs_;
 
+  // The memory behind |nss_bufs_|, which transport reads and writes use
+  // directly.
+  scoped_refptr<IOBuffer> recv_storage_;
+  scoped_refptr<IOBuffer> send_storage_;
+
   // StreamSocket for sending and receiving data.
   scoped_ptr<StreamSocket> transport_socket_;
 
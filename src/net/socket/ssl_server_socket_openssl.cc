@@ -16,6 +16,12 @@ void EnableSSLServerSockets() {
   NOTIMPLEMENTED();
 }
 
+bool SetSSLServerSessionTicketKeys(
+    const std::vector<SessionTicketKey>& keys) {
+  NOTIMPLEMENTED();
+  return false;
+}
+
 SSLServerSocket* CreateSSLServerSocket(StreamSocket* socket,
                                        X509Certificate* certificate,
                                        crypto::RSAPrivateKey* key,
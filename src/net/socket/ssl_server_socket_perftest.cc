@@ -0,0 +1,260 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Measures SSLClientSocket connected to SSLServerSocket: bulk transfer for
+// each of the commonly negotiated cipher suites, so that the record
+// protection cost of each suite can be compared, and handshakes as the
+// client session cache grows.  The sockets are connected by in-memory
+// FakeSockets, so the time is all spent in the SSL library.
+
+#include "net/socket/ssl_server_socket.h"
+
+#include <string>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/compiler_specific.h"
+#include "base/file_util.h"
+#include "base/files/file_path.h"
+#include "base/message_loop.h"
+#include "base/perftimer.h"
+#include "base/stringprintf.h"
+#include "crypto/rsa_private_key.h"
+#include "net/base/host_port_pair.h"
+#include "net/base/io_buffer.h"
+#include "net/base/net_errors.h"
+#include "net/base/test_completion_callback.h"
+#include "net/base/test_data_directory.h"
+#include "net/cert/cert_status_flags.h"
+#include "net/cert/mock_cert_verifier.h"
+#include "net/cert/x509_certificate.h"
+#include "net/socket/client_socket_factory.h"
+#include "net/socket/fake_stream_socket.h"
+#include "net/socket/ssl_client_socket.h"
+#include "net/ssl/ssl_config_service.h"
+#include "net/ssl/ssl_connection_status_flags.h"
+#include "net/ssl/ssl_info.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace net {
+
+namespace {
+
+const int kTransferSize = 32 * 1024 * 1024;
+const int kChunkSize = 16 * 1024;
+
+// The number of client sessions cached before timing handshakes against a
+// full session cache, and the number of handshakes timed.
+const int kCachedSessions = 10000;
+const int kTimedHandshakes = 200;
+
+// The suites that an RSA server may negotiate with the default client
+// configuration.  All but the one being measured are disabled on the client.
+const uint16 kRSAServerCipherSuites[] = {
+  0x0004,  // TLS_RSA_WITH_RC4_128_MD5
+  0x0005,  // TLS_RSA_WITH_RC4_128_SHA
+  0x000A,  // TLS_RSA_WITH_3DES_EDE_CBC_SHA
+  0x0016,  // TLS_DHE_RSA_WITH_3DES_EDE_CBC_SHA
+  0x002F,  // TLS_RSA_WITH_AES_128_CBC_SHA
+  0x0033,  // TLS_DHE_RSA_WITH_AES_128_CBC_SHA
+  0x0035,  // TLS_RSA_WITH_AES_256_CBC_SHA
+  0x0039,  // TLS_DHE_RSA_WITH_AES_256_CBC_SHA
+  0x0041,  // TLS_RSA_WITH_CAMELLIA_128_CBC_SHA
+  0x0045,  // TLS_DHE_RSA_WITH_CAMELLIA_128_CBC_SHA
+  0x0084,  // TLS_RSA_WITH_CAMELLIA_256_CBC_SHA
+  0x0088,  // TLS_DHE_RSA_WITH_CAMELLIA_256_CBC_SHA
+  0x0096,  // TLS_RSA_WITH_SEED_CBC_SHA
+  0xC011,  // TLS_ECDHE_RSA_WITH_RC4_128_SHA
+  0xC012,  // TLS_ECDHE_RSA_WITH_3DES_EDE_CBC_SHA
+  0xC013,  // TLS_ECDHE_RSA_WITH_AES_128_CBC_SHA
+  0xC014,  // TLS_ECDHE_RSA_WITH_AES_256_CBC_SHA
+  0xFEFF,  // SSL_RSA_FIPS_WITH_3DES_EDE_CBC_SHA
+};
+
+const struct {
+  uint16 cipher_suite;
+  const char* name;
+} kMeasuredCipherSuites[] = {
+  { 0x0005, "RC4_128_SHA" },
+  { 0x000A, "3DES_EDE_CBC_SHA" },
+  { 0x002F, "AES_128_CBC_SHA" },
+  { 0x0035, "AES_256_CBC_SHA" },
+  { 0xC013, "ECDHE_RSA_AES_128_CBC_SHA" },
+};
+
+class SSLServerSocketPerfTest : public testing::Test {
+ protected:
+  SSLServerSocketPerfTest() : cert_verifier_(new MockCertVerifier()) {
+    cert_verifier_->set_default_result(CERT_STATUS_AUTHORITY_INVALID);
+  }
+
+  virtual void SetUp() OVERRIDE {
+    base::FilePath certs_dir(GetTestCertsDirectory());
+    ASSERT_TRUE(file_util::ReadFileToString(
+        certs_dir.AppendASCII("unittest.selfsigned.der"), &cert_der_));
+    cert_ = X509Certificate::CreateFromBytes(cert_der_.data(),
+                                             cert_der_.size());
+
+    std::string key_string;
+    ASSERT_TRUE(file_util::ReadFileToString(
+        certs_dir.AppendASCII("unittest.key.bin"), &key_string));
+    std::vector<uint8> key_vector(key_string.begin(), key_string.end());
+    private_key_.reset(
+        crypto::RSAPrivateKey::CreateFromPrivateKeyInfo(key_vector));
+    ASSERT_TRUE(private_key_.get());
+  }
+
+  // Creates a client for |host| that only offers |cipher_suite|, or the
+  // default suites if |cipher_suite| is zero, and a server for it to talk to
+  // over |client_to_server| and |server_to_client|.
+  void CreateSockets(const std::string& host,
+                     uint16 cipher_suite,
+                     FakeDataChannel* client_to_server,
+                     FakeDataChannel* server_to_client,
+                     scoped_ptr<SSLClientSocket>* client,
+                     scoped_ptr<SSLServerSocket>* server) {
+    SSLConfig ssl_config;
+    ssl_config.cached_info_enabled = false;
+    ssl_config.false_start_enabled = false;
+    ssl_config.channel_id_enabled = false;
+    for (size_t i = 0; cipher_suite && i < arraysize(kRSAServerCipherSuites);
+         ++i) {
+      if (kRSAServerCipherSuites[i] != cipher_suite)
+        ssl_config.disabled_cipher_suites.push_back(kRSAServerCipherSuites[i]);
+    }
+    SSLConfig::CertAndStatus cert_and_status;
+    cert_and_status.cert_status = CERT_STATUS_AUTHORITY_INVALID;
+    cert_and_status.der_cert = cert_der_;
+    ssl_config.allowed_bad_certs.push_back(cert_and_status);
+
+    SSLClientSocketContext context;
+    context.cert_verifier = cert_verifier_.get();
+    FakeSocket* client_transport =
+        new FakeSocket(server_to_client, client_to_server);
+    client_transport->set_random_io_sizes(false);
+    FakeSocket* server_transport =
+        new FakeSocket(client_to_server, server_to_client);
+    server_transport->set_random_io_sizes(false);
+    client->reset(
+        ClientSocketFactory::GetDefaultFactory()->CreateSSLClientSocket(
+            client_transport, HostPortPair(host, 443), ssl_config, context));
+    server->reset(CreateSSLServerSocket(
+        server_transport, cert_, private_key_.get(), SSLConfig()));
+  }
+
+  // Connects a new client for |host| to a new server.
+  void Handshake(const std::string& host) {
+    FakeDataChannel client_to_server;
+    FakeDataChannel server_to_client;
+    scoped_ptr<SSLClientSocket> client;
+    scoped_ptr<SSLServerSocket> server;
+    CreateSockets(host, 0, &client_to_server, &server_to_client, &client,
+                  &server);
+
+    TestCompletionCallback connect_callback;
+    TestCompletionCallback handshake_callback;
+    int client_rv = client->Connect(connect_callback.callback());
+    int server_rv = server->Handshake(handshake_callback.callback());
+    ASSERT_EQ(OK, connect_callback.GetResult(client_rv));
+    ASSERT_EQ(OK, handshake_callback.GetResult(server_rv));
+  }
+
+  // Times |count| handshakes, each for a host the client has no session for,
+  // so that every one looks through the client session cache and misses.
+  void TimeNewHostHandshakes(const char* name, int count) {
+    PerfTimeLogger timer(name);
+    for (int i = 0; i < count; ++i)
+      Handshake(base::StringPrintf("%s-%d.example.com", name, i));
+    timer.Done();
+  }
+
+  // Connects a client that only offers |cipher_suite| to a server, then
+  // sends kTransferSize bytes from the client to the server.
+  void Transfer(uint16 cipher_suite, const char* name) {
+    FakeDataChannel client_to_server;
+    FakeDataChannel server_to_client;
+    scoped_ptr<SSLClientSocket> client;
+    scoped_ptr<SSLServerSocket> server;
+    CreateSockets("unittest", cipher_suite, &client_to_server,
+                  &server_to_client, &client, &server);
+
+    TestCompletionCallback connect_callback;
+    TestCompletionCallback handshake_callback;
+    int client_rv = client->Connect(connect_callback.callback());
+    int server_rv = server->Handshake(handshake_callback.callback());
+    ASSERT_EQ(OK, connect_callback.GetResult(client_rv));
+    ASSERT_EQ(OK, handshake_callback.GetResult(server_rv));
+
+    SSLInfo ssl_info;
+    ASSERT_TRUE(client->GetSSLInfo(&ssl_info));
+    ASSERT_EQ(cipher_suite,
+              SSLConnectionStatusToCipherSuite(ssl_info.connection_status));
+
+    // Only the transfer is timed, so the numbers reflect record protection
+    // rather than the handshake.
+    PerfTimeLogger timer(base::StringPrintf("SSL_BulkTransfer_%s",
+                                            name).c_str());
+
+    scoped_refptr<IOBuffer> write_buf(new IOBuffer(kChunkSize));
+    memset(write_buf->data(), 'x', kChunkSize);
+    scoped_refptr<IOBuffer> read_buf(new IOBuffer(kChunkSize));
+    TestCompletionCallback write_callback;
+    TestCompletionCallback read_callback;
+    for (int sent = 0; sent < kTransferSize; sent += kChunkSize) {
+      scoped_refptr<DrainableIOBuffer> chunk(
+          new DrainableIOBuffer(write_buf, kChunkSize));
+      while (chunk->BytesRemaining() > 0) {
+        int rv = write_callback.GetResult(client->Write(
+            chunk, chunk->BytesRemaining(), write_callback.callback()));
+        ASSERT_GT(rv, 0);
+        chunk->DidConsume(rv);
+      }
+      for (int received = 0; received < kChunkSize;) {
+        int rv = read_callback.GetResult(server->Read(
+            read_buf, kChunkSize, read_callback.callback()));
+        ASSERT_GT(rv, 0);
+        received += rv;
+      }
+    }
+    timer.Done();
+  }
+
+  scoped_ptr<MockCertVerifier> cert_verifier_;
+  std::string cert_der_;
+  scoped_refptr<X509Certificate> cert_;
+  scoped_ptr<crypto::RSAPrivateKey> private_key_;
+  base::MessageLoopForIO message_loop_;
+};
+
+}  // namespace
+
+// SSLServerSocket is only implemented using NSS.
+#if defined(USE_NSS) || defined(OS_WIN) || defined(OS_MACOSX)
+
+TEST_F(SSLServerSocketPerfTest, BulkTransfer) {
+  for (size_t i = 0; i < arraysize(kMeasuredCipherSuites); ++i) {
+    Transfer(kMeasuredCipherSuites[i].cipher_suite,
+             kMeasuredCipherSuites[i].name);
+  }
+}
+
+// Compares handshakes against an empty client session cache with handshakes
+// against one holding kCachedSessions sessions for other hosts.
+TEST_F(SSLServerSocketPerfTest, HandshakeWithFullSessionCache) {
+  ClientSocketFactory::GetDefaultFactory()->ClearSSLSessionCache();
+  TimeNewHostHandshakes("SSL_Handshake_EmptySessionCache", kTimedHandshakes);
+
+  for (int i = 0; i < kCachedSessions; ++i)
+    Handshake(base::StringPrintf("cached-%d.example.com", i));
+  TimeNewHostHandshakes(
+      base::StringPrintf("SSL_Handshake_%dCachedSessions",
+                         kCachedSessions).c_str(),
+      kTimedHandshakes);
+
+  ClientSocketFactory::GetDefaultFactory()->ClearSSLSessionCache();
+}
+
+#endif
+
+}  // namespace net
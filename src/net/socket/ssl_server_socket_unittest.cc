@@ -3,25 +3,15 @@
 // found in the LICENSE file.
 
 // This test suite uses SSLClientSocket to test the implementation of
-// SSLServerSocket. In order to establish connections between the sockets
-// we need two additional classes:
-// 1. FakeSocket
-//    Connects SSL socket to FakeDataChannel. This class is just a stub.
-//
-// 2. FakeDataChannel
-//    Implements the actual exchange of data between two FakeSockets.
-//
-// Implementations of these two classes are included in this file.
+// SSLServerSocket. The sockets are connected by the in-memory FakeSocket and
+// FakeDataChannel classes from fake_stream_socket.h.
 
 #include "net/socket/ssl_server_socket.h"
 
-#include <stdlib.h>
-
-#include <queue>
-
 #include "base/compiler_specific.h"
 #include "base/file_util.h"
 #include "base/files/file_path.h"
+#include "base/memory/scoped_ptr.h"
 #include "base/message_loop.h"
 #include "base/path_service.h"
 #include "crypto/nss_util.h"
@@ -38,6 +28,7 @@
 #include "net/cert/mock_cert_verifier.h"
 #include "net/cert/x509_certificate.h"
 #include "net/socket/client_socket_factory.h"
+#include "net/socket/fake_stream_socket.h"
 #include "net/socket/socket_test_util.h"
 #include "net/socket/ssl_client_socket.h"
 #include "net/socket/stream_socket.h"
@@ -49,209 +40,6 @@
 
 namespace net {
 
-namespace {
-
-class FakeDataChannel {
- public:
-  FakeDataChannel()
-      : read_buf_len_(0),
-        weak_factory_(this),
-        closed_(false),
-        write_called_after_close_(false) {
-  }
-
-  int Read(IOBuffer* buf, int buf_len, const CompletionCallback& callback) {
-    if (closed_)
-      return 0;
-    if (data_.empty()) {
-      read_callback_ = callback;
-      read_buf_ = buf;
-      read_buf_len_ = buf_len;
-      return net::ERR_IO_PENDING;
-    }
-    return PropogateData(buf, buf_len);
-  }
-
-  int Write(IOBuffer* buf, int buf_len, const CompletionCallback& callback) {
-    if (closed_) {
-      if (write_called_after_close_)
-        return net::ERR_CONNECTION_RESET;
-      write_called_after_close_ = true;
-      write_callback_ = callback;
-      base::MessageLoop::current()->PostTask(
-          FROM_HERE, base::Bind(&FakeDataChannel::DoWriteCallback,
-                                weak_factory_.GetWeakPtr()));
-      return net::ERR_IO_PENDING;
-    }
-    data_.push(new net::DrainableIOBuffer(buf, buf_len));
-    base::MessageLoop::current()->PostTask(
-        FROM_HERE, base::Bind(&FakeDataChannel::DoReadCallback,
-                              weak_factory_.GetWeakPtr()));
-    return buf_len;
-  }
-
-  // Closes the FakeDataChannel. After Close() is called, Read() returns 0,
-  // indicating EOF, and Write() fails with ERR_CONNECTION_RESET. Note that
-  // after the FakeDataChannel is closed, the first Write() call completes
-  // asynchronously, which is necessary to reproduce bug 127822.
-  void Close() {
-    closed_ = true;
-  }
-
- private:
-  void DoReadCallback() {
-    if (read_callback_.is_null() || data_.empty())
-      return;
-
-    int copied = PropogateData(read_buf_, read_buf_len_);
-    CompletionCallback callback = read_callback_;
-    read_callback_.Reset();
-    read_buf_ = NULL;
-    read_buf_len_ = 0;
-    callback.Run(copied);
-  }
-
-  void DoWriteCallback() {
-    if (write_callback_.is_null())
-      return;
-
-    CompletionCallback callback = write_callback_;
-    write_callback_.Reset();
-    callback.Run(net::ERR_CONNECTION_RESET);
-  }
-
-  int PropogateData(scoped_refptr<net::IOBuffer> read_buf, int read_buf_len) {
-    scoped_refptr<net::DrainableIOBuffer> buf = data_.front();
-    int copied = std::min(buf->BytesRemaining(), read_buf_len);
-    memcpy(read_buf->data(), buf->data(), copied);
-    buf->DidConsume(copied);
-
-    if (!buf->BytesRemaining())
-      data_.pop();
-    return copied;
-  }
-
-  CompletionCallback read_callback_;
-  scoped_refptr<net::IOBuffer> read_buf_;
-  int read_buf_len_;
-
-  CompletionCallback write_callback_;
-
-  std::queue<scoped_refptr<net::DrainableIOBuffer> > data_;
-
-  base::WeakPtrFactory<FakeDataChannel> weak_factory_;
-
-  // True if Close() has been called.
-  bool closed_;
-
-  // Controls the completion of Write() after the FakeDataChannel is closed.
-  // After the FakeDataChannel is closed, the first Write() call completes
-  // asynchronously.
-  bool write_called_after_close_;
-
-  DISALLOW_COPY_AND_ASSIGN(FakeDataChannel);
-};
-
-class FakeSocket : public StreamSocket {
- public:
-  FakeSocket(FakeDataChannel* incoming_channel,
-             FakeDataChannel* outgoing_channel)
-      : incoming_(incoming_channel),
-        outgoing_(outgoing_channel) {
-  }
-
-  virtual ~FakeSocket() {
-  }
-
-  virtual int Read(IOBuffer* buf, int buf_len,
-                   const CompletionCallback& callback) OVERRIDE {
-    // Read random number of bytes.
-    buf_len = rand() % buf_len + 1;
-    return incoming_->Read(buf, buf_len, callback);
-  }
-
-  virtual int Write(IOBuffer* buf, int buf_len,
-                    const CompletionCallback& callback) OVERRIDE {
-    // Write random number of bytes.
-    buf_len = rand() % buf_len + 1;
-    return outgoing_->Write(buf, buf_len, callback);
-  }
-
-  virtual bool SetReceiveBufferSize(int32 size) OVERRIDE {
-    return true;
-  }
-
-  virtual bool SetSendBufferSize(int32 size) OVERRIDE {
-    return true;
-  }
-
-  virtual int Connect(const CompletionCallback& callback) OVERRIDE {
-    return net::OK;
-  }
-
-  virtual void Disconnect() OVERRIDE {
-    incoming_->Close();
-    outgoing_->Close();
-  }
-
-  virtual bool IsConnected() const OVERRIDE {
-    return true;
-  }
-
-  virtual bool IsConnectedAndIdle() const OVERRIDE {
-    return true;
-  }
-
-  virtual int GetPeerAddress(IPEndPoint* address) const OVERRIDE {
-      net::IPAddressNumber ip_address(net::kIPv4AddressSize);
-    *address = net::IPEndPoint(ip_address, 0 /*port*/);
-    return net::OK;
-  }
-
-  virtual int GetLocalAddress(IPEndPoint* address) const OVERRIDE {
-    net::IPAddressNumber ip_address(4);
-    *address = net::IPEndPoint(ip_address, 0);
-    return net::OK;
-  }
-
-  virtual const BoundNetLog& NetLog() const OVERRIDE {
-    return net_log_;
-  }
-
-  virtual void SetSubresourceSpeculation() OVERRIDE {}
-  virtual void SetOmniboxSpeculation() OVERRIDE {}
-
-  virtual bool WasEverUsed() const OVERRIDE {
-    return true;
-  }
-
-  virtual bool UsingTCPFastOpen() const OVERRIDE {
-    return false;
-  }
-
-
-  virtual bool WasNpnNegotiated() const OVERRIDE {
-    return false;
-  }
-
-  virtual NextProto GetNegotiatedProtocol() const OVERRIDE {
-    return kProtoUnknown;
-  }
-
-  virtual bool GetSSLInfo(SSLInfo* ssl_info) OVERRIDE {
-    return false;
-  }
-
- private:
-  net::BoundNetLog net_log_;
-  FakeDataChannel* incoming_;
-  FakeDataChannel* outgoing_;
-
-  DISALLOW_COPY_AND_ASSIGN(FakeSocket);
-};
-
-}  // namespace
-
 // Verify the correctness of the test helper classes first.
 TEST(FakeSocketTest, DataTransfer) {
   // Establish channels between two sockets.
@@ -300,9 +88,19 @@ class SSLServerSocketTest : public PlatformTest {
   }
 
  protected:
+  // May be called more than once to make a new connection. Each connection
+  // gets fresh channels, since tearing down the previous sockets closes the
+  // old ones.
   void Initialize() {
-    FakeSocket* fake_client_socket = new FakeSocket(&channel_1_, &channel_2_);
-    FakeSocket* fake_server_socket = new FakeSocket(&channel_2_, &channel_1_);
+    client_socket_.reset();
+    server_socket_.reset();
+    channel_1_.reset(new FakeDataChannel());
+    channel_2_.reset(new FakeDataChannel());
+
+    FakeSocket* fake_client_socket =
+        new FakeSocket(channel_1_.get(), channel_2_.get());
+    FakeSocket* fake_server_socket =
+        new FakeSocket(channel_2_.get(), channel_1_.get());
 
     base::FilePath certs_dir(GetTestCertsDirectory());
 
@@ -348,8 +146,32 @@ class SSLServerSocketTest : public PlatformTest {
                                                     net::SSLConfig()));
   }
 
-  FakeDataChannel channel_1_;
-  FakeDataChannel channel_2_;
+  // Completes the handshake between |client_socket_| and |server_socket_| and
+  // returns whether the client resumed a session.
+  SSLInfo::HandshakeType Handshake() {
+    TestCompletionCallback connect_callback;
+    TestCompletionCallback handshake_callback;
+
+    int server_ret = server_socket_->Handshake(handshake_callback.callback());
+    EXPECT_TRUE(server_ret == net::OK || server_ret == net::ERR_IO_PENDING);
+
+    int client_ret = client_socket_->Connect(connect_callback.callback());
+    EXPECT_TRUE(client_ret == net::OK || client_ret == net::ERR_IO_PENDING);
+
+    if (client_ret == net::ERR_IO_PENDING) {
+      EXPECT_EQ(net::OK, connect_callback.WaitForResult());
+    }
+    if (server_ret == net::ERR_IO_PENDING) {
+      EXPECT_EQ(net::OK, handshake_callback.WaitForResult());
+    }
+
+    SSLInfo ssl_info;
+    client_socket_->GetSSLInfo(&ssl_info);
+    return ssl_info.handshake_type;
+  }
+
+  scoped_ptr<FakeDataChannel> channel_1_;
+  scoped_ptr<FakeDataChannel> channel_2_;
   scoped_ptr<net::SSLClientSocket> client_socket_;
   scoped_ptr<net::SSLServerSocket> server_socket_;
   net::ClientSocketFactory* socket_factory_;
@@ -575,6 +397,47 @@ TEST_F(SSLServerSocketTest, ExportKeyingMaterial) {
   ASSERT_EQ(rv, net::OK);
   EXPECT_NE(0, memcmp(server_out, client_bad, sizeof(server_out)));
 }
+
+namespace {
+
+// Returns a session ticket key filled in from |seed|.
+SessionTicketKey MakeSessionTicketKey(uint8 seed) {
+  SessionTicketKey key;
+  memset(key.name, seed, sizeof(key.name));
+  memset(key.aes_key, seed + 1, sizeof(key.aes_key));
+  memset(key.hmac_key, seed + 2, sizeof(key.hmac_key));
+  return key;
+}
+
+}  // namespace
+
+// This test checks that a session ticket is accepted while the key it was
+// issued under is installed, including after a new key is rotated in ahead
+// of it, and is rejected once that key is removed.
+TEST_F(SSLServerSocketTest, SessionTicketKeyRotation) {
+  std::vector<SessionTicketKey> keys;
+  keys.push_back(MakeSessionTicketKey(1));
+  ASSERT_TRUE(SetSSLServerSessionTicketKeys(keys));
+  // Don't let sessions from other tests resume by session ID.
+  socket_factory_->ClearSSLSessionCache();
+
+  Initialize();
+  EXPECT_EQ(SSLInfo::HANDSHAKE_FULL, Handshake());
+  Initialize();
+  EXPECT_EQ(SSLInfo::HANDSHAKE_RESUME, Handshake());
+
+  keys.insert(keys.begin(), MakeSessionTicketKey(2));
+  ASSERT_TRUE(SetSSLServerSessionTicketKeys(keys));
+  Initialize();
+  EXPECT_EQ(SSLInfo::HANDSHAKE_RESUME, Handshake());
+
+  keys.assign(1, MakeSessionTicketKey(3));
+  ASSERT_TRUE(SetSSLServerSessionTicketKeys(keys));
+  Initialize();
+  EXPECT_EQ(SSLInfo::HANDSHAKE_FULL, Handshake());
+
+  EXPECT_TRUE(SetSSLServerSessionTicketKeys(std::vector<SessionTicketKey>()));
+}
 #endif
 
 }  // namespace net
@@ -734,6 +734,28 @@ SSL_IMPORT SECStatus SSL_SetMaxServerCacheLocks(PRUint32 maxLocks);
  */
 SSL_IMPORT SECStatus SSL_InheritMPServerSIDCache(const char * envString);
 
+/*
+** A key protecting session tickets.  Servers that install the same keys can
+** resume each other's sessions.
+*/
+typedef struct SSLSessionTicketKeyStr {
+    unsigned char name[16];    /* sent in each ticket to select its key */
+    unsigned char aesKey[32];  /* AES-256-CBC key for the session state */
+    unsigned char macKey[32];  /* HMAC-SHA256 key over the ticket */
+} SSLSessionTicketKey;
+
+/*
+** Set the session ticket keys used by all server sockets in this process,
+** replacing any set before.  New tickets are issued under keys[0], and
+** tickets issued under any of the numKeys keys are accepted, so keys can be
+** rotated at runtime by installing the new key first, followed by the keys
+** that tickets still in use were issued under.  If numKeys is 0, keys
+** generated by NSS for this process are used, as when this is never called.
+** Ticket processing must still be enabled with SSL_ENABLE_SESSION_TICKETS.
+*/
+SSL_IMPORT SECStatus SSL_SetSessionTicketKeys(const SSLSessionTicketKey *keys,
+                                              unsigned int numKeys);
+
 /*
 ** Set the callback on a particular socket that gets called when we finish
 ** performing a handshake.
@@ -33,6 +33,26 @@ static PRBool         session_ticket_keys_initialized = PR_FALSE;
 #endif
 static PRCallOnceType generate_session_keys_once;
 
+/* Session ticket keys installed by SSL_SetSessionTicketKeys.  While any are
+ * installed they are used instead of the keys generated above.  A copy
+ * handed out by ssl3_GetTicketKey holds its own references to the PKCS#11
+ * keys, so the set can be replaced while a handshake is using one of them.
+ */
+typedef struct ssl3TicketKeyStr {
+    unsigned char  name[SESS_TICKET_KEY_NAME_LEN];
+    PK11SymKey    *aes_key_pkcs11;
+    PK11SymKey    *mac_key_pkcs11;
+#ifndef NO_PKCS11_BYPASS
+    unsigned char  aes_key[AES_256_KEY_LENGTH];
+    unsigned char  mac_key[SHA256_LENGTH];
+#endif
+} ssl3TicketKey;
+
+static PZLock        *ticket_keys_lock = NULL;
+static ssl3TicketKey *ticket_keys = NULL;
+static unsigned int   num_ticket_keys = 0;
+static PRCallOnceType ticket_keys_lock_once;
+
 /* forward static function declarations */
 static SECStatus ssl3_ParseEncryptedSessionTicket(sslSocket *ss,
     SECItem *data, EncryptedSessionTicket *enc_session_ticket);
@@ -47,6 +67,9 @@ static SECStatus ssl3_GetSessionTicketKeys(const unsigned char **aes_key,
     PRUint32 *aes_key_length, const unsigned char **mac_key,
     PRUint32 *mac_key_length);
 #endif
+static SECStatus ssl3_GetTicketKey(sslSocket *ss, const unsigned char *name,
+    ssl3TicketKey *key, PRBool *found);
+static void ssl3_ReleaseTicketKey(ssl3TicketKey *key);
 static PRInt32 ssl3_SendRenegotiationInfoXtn(sslSocket * ss,
     PRBool append, PRUint32 maxBytes);
 static SECStatus ssl3_HandleRenegotiationInfoXtn(sslSocket *ss, 
@@ -220,6 +243,205 @@ ssl3_GetSessionTicketKeys(const unsigned char **aes_key,
 }
 #endif
 
+/* Releases the PKCS#11 keys referenced by |key| and clears it. */
+static void
+ssl3_ReleaseTicketKey(ssl3TicketKey *key)
+{
+    if (key->aes_key_pkcs11)
+	PK11_FreeSymKey(key->aes_key_pkcs11);
+    if (key->mac_key_pkcs11)
+	PK11_FreeSymKey(key->mac_key_pkcs11);
+    PORT_Memset(key, 0, sizeof(*key));
+}
+
+static void
+ssl3_FreeTicketKeys(ssl3TicketKey *keys, unsigned int num_keys)
+{
+    unsigned int i;
+
+    if (!keys)
+	return;
+    for (i = 0; i < num_keys; i++)
+	ssl3_ReleaseTicketKey(&keys[i]);
+    PORT_Free(keys);
+}
+
+static SECStatus
+ssl3_TicketKeysShutdown(void *appData, void *nssData)
+{
+    ssl3_FreeTicketKeys(ticket_keys, num_ticket_keys);
+    ticket_keys = NULL;
+    num_ticket_keys = 0;
+    if (ticket_keys_lock) {
+	PZ_DestroyLock(ticket_keys_lock);
+	ticket_keys_lock = NULL;
+    }
+    PORT_Memset(&ticket_keys_lock_once, 0, sizeof(ticket_keys_lock_once));
+    return SECSuccess;
+}
+
+static PRStatus
+ssl3_InitTicketKeysLock(void)
+{
+    ticket_keys_lock = PZ_NewLock(nssILockOther);
+    if (!ticket_keys_lock)
+	return PR_FAILURE;
+    if (NSS_RegisterShutdown(ssl3_TicketKeysShutdown, NULL) != SECSuccess) {
+	PZ_DestroyLock(ticket_keys_lock);
+	ticket_keys_lock = NULL;
+	return PR_FAILURE;
+    }
+    return PR_SUCCESS;
+}
+
+/* Gets the keys to encrypt a new ticket under if |name| is NULL, or else the
+ * keys for decrypting a ticket with that key_name, setting *found to PR_FALSE
+ * if there are none.  The caller must release |key| with
+ * ssl3_ReleaseTicketKey.
+ */
+static SECStatus
+ssl3_GetTicketKey(sslSocket *ss, const unsigned char *name,
+                  ssl3TicketKey *key, PRBool *found)
+{
+    unsigned int i;
+    SECStatus rv;
+
+    PORT_Memset(key, 0, sizeof(*key));
+    *found = PR_FALSE;
+
+    if (PR_CallOnce(&ticket_keys_lock_once,
+	    ssl3_InitTicketKeysLock) != PR_SUCCESS)
+	return SECFailure;
+
+    PZ_Lock(ticket_keys_lock);
+    if (num_ticket_keys > 0) {
+	for (i = 0; i < num_ticket_keys; i++) {
+	    if (name == NULL || PORT_Memcmp(name, ticket_keys[i].name,
+		    SESS_TICKET_KEY_NAME_LEN) == 0) {
+		*key = ticket_keys[i];
+		PK11_ReferenceSymKey(key->aes_key_pkcs11);
+		PK11_ReferenceSymKey(key->mac_key_pkcs11);
+		*found = PR_TRUE;
+		break;
+	    }
+	}
+	PZ_Unlock(ticket_keys_lock);
+	return SECSuccess;
+    }
+    PZ_Unlock(ticket_keys_lock);
+
+    /* None installed: use the keys generated for this process. */
+#ifndef NO_PKCS11_BYPASS
+    if (ss->opt.bypassPKCS11) {
+	const unsigned char *aes_key;
+	const unsigned char *mac_key;
+	PRUint32             aes_key_length;
+	PRUint32             mac_key_length;
+
+	rv = ssl3_GetSessionTicketKeys(&aes_key, &aes_key_length,
+	    &mac_key, &mac_key_length);
+	if (rv != SECSuccess)
+	    return rv;
+	PORT_Memcpy(key->aes_key, aes_key, sizeof(key->aes_key));
+	PORT_Memcpy(key->mac_key, mac_key, sizeof(key->mac_key));
+    } else
+#endif
+    {
+	PK11SymKey *aes_key_pkcs11;
+	PK11SymKey *mac_key_pkcs11;
+
+	rv = ssl3_GetSessionTicketKeysPKCS11(ss, &aes_key_pkcs11,
+	    &mac_key_pkcs11);
+	if (rv != SECSuccess)
+	    return rv;
+	key->aes_key_pkcs11 = PK11_ReferenceSymKey(aes_key_pkcs11);
+	key->mac_key_pkcs11 = PK11_ReferenceSymKey(mac_key_pkcs11);
+    }
+    PORT_Memcpy(key->name, key_name, SESS_TICKET_KEY_NAME_LEN);
+    *found = name == NULL ||
+	PORT_Memcmp(name, key_name, SESS_TICKET_KEY_NAME_LEN) == 0;
+    return SECSuccess;
+}
+
+static PK11SymKey *
+ssl3_ImportTicketKey(PK11SlotInfo *slot, CK_MECHANISM_TYPE mech,
+                     CK_FLAGS flags, const unsigned char *data,
+                     unsigned int len)
+{
+    SECItem item;
+
+    item.type = siBuffer;
+    item.data = (unsigned char *)data;
+    item.len = len;
+    return PK11_ImportSymKeyWithFlags(slot, mech, PK11_OriginUnwrap,
+	CKA_FLAGS_ONLY, &item, flags, PR_FALSE, NULL);
+}
+
+SECStatus
+SSL_SetSessionTicketKeys(const SSLSessionTicketKey *keys,
+                         unsigned int numKeys)
+{
+    ssl3TicketKey *new_keys = NULL;
+    ssl3TicketKey *old_keys;
+    unsigned int   num_old_keys;
+    PK11SlotInfo  *slot = NULL;
+    unsigned int   i;
+
+    if (numKeys > 0 && keys == NULL) {
+	PORT_SetError(SEC_ERROR_INVALID_ARGS);
+	return SECFailure;
+    }
+    if (PR_CallOnce(&ticket_keys_lock_once,
+	    ssl3_InitTicketKeysLock) != PR_SUCCESS)
+	return SECFailure;
+
+    /* Import the keys before taking the lock, so handshakes only ever wait
+     * for the swap below. */
+    if (numKeys > 0) {
+	new_keys = PORT_ZNewArray(ssl3TicketKey, numKeys);
+	if (!new_keys)
+	    return SECFailure;
+	slot = PK11_GetInternalSlot();
+	if (!slot)
+	    goto loser;
+	for (i = 0; i < numKeys; i++) {
+	    PORT_Memcpy(new_keys[i].name, keys[i].name,
+		SESS_TICKET_KEY_NAME_LEN);
+	    new_keys[i].aes_key_pkcs11 = ssl3_ImportTicketKey(slot,
+		CKM_AES_CBC, CKF_ENCRYPT | CKF_DECRYPT, keys[i].aesKey,
+		sizeof(keys[i].aesKey));
+	    new_keys[i].mac_key_pkcs11 = ssl3_ImportTicketKey(slot,
+		CKM_SHA256_HMAC, CKF_SIGN, keys[i].macKey,
+		sizeof(keys[i].macKey));
+	    if (!new_keys[i].aes_key_pkcs11 || !new_keys[i].mac_key_pkcs11)
+		goto loser;
+#ifndef NO_PKCS11_BYPASS
+	    PORT_Memcpy(new_keys[i].aes_key, keys[i].aesKey,
+		sizeof(new_keys[i].aes_key));
+	    PORT_Memcpy(new_keys[i].mac_key, keys[i].macKey,
+		sizeof(new_keys[i].mac_key));
+#endif
+	}
+	PK11_FreeSlot(slot);
+    }
+
+    PZ_Lock(ticket_keys_lock);
+    old_keys = ticket_keys;
+    num_old_keys = num_ticket_keys;
+    ticket_keys = new_keys;
+    num_ticket_keys = numKeys;
+    PZ_Unlock(ticket_keys_lock);
+
+    ssl3_FreeTicketKeys(old_keys, num_old_keys);
+    return SECSuccess;
+
+loser:
+    if (slot)
+	PK11_FreeSlot(slot);
+    ssl3_FreeTicketKeys(new_keys, numKeys);
+    return SECFailure;
+}
+
 /* Table of handlers for received TLS hello extensions, one per extension.
  * In the second generation, this table will be dynamic, and functions
  * will be registered here.
@@ -830,13 +1052,9 @@ ssl3_SendNewSessionTicket(sslSocket *ss)
     PRUint32             cert_length;
     uint8                length_buf[4];
     PRUint32             now;
-    PK11SymKey          *aes_key_pkcs11;
-    PK11SymKey          *mac_key_pkcs11;
+    ssl3TicketKey        ticket_key;
+    PRBool               found_ticket_key;
 #ifndef NO_PKCS11_BYPASS
-    const unsigned char *aes_key;
-    const unsigned char *mac_key;
-    PRUint32             aes_key_length;
-    PRUint32             mac_key_length;
     PRUint64             aes_ctx_buf[MAX_CIPHER_CONTEXT_LLONGS];
     AESContext          *aes_ctx;
     const SECHashObject *hashObj = NULL;
@@ -862,6 +1080,7 @@ ssl3_SendNewSessionTicket(sslSocket *ss)
     PORT_Assert( ss->opt.noLocks || ssl_HaveXmitBufLock(ss));
     PORT_Assert( ss->opt.noLocks || ssl_HaveSSL3HandshakeLock(ss));
 
+    PORT_Memset(&ticket_key, 0, sizeof(ticket_key));
     ticket.ticket_lifetime_hint = TLS_EX_SESS_TICKET_LIFETIME_HINT;
     cert_length = (ss->opt.requestCertificate && ss->sec.ci.sid->peerCert) ?
 	3 + ss->sec.ci.sid->peerCert->derCert.len : 0;
@@ -872,17 +1091,9 @@ ssl3_SendNewSessionTicket(sslSocket *ss)
     rv = PK11_GenerateRandom(iv, sizeof(iv));
     if (rv != SECSuccess) goto loser;
 
-#ifndef NO_PKCS11_BYPASS
-    if (ss->opt.bypassPKCS11) {
-	rv = ssl3_GetSessionTicketKeys(&aes_key, &aes_key_length,
-	    &mac_key, &mac_key_length);
-    } else 
-#endif
-    {
-	rv = ssl3_GetSessionTicketKeysPKCS11(ss, &aes_key_pkcs11,
-	    &mac_key_pkcs11);
-    }
+    rv = ssl3_GetTicketKey(ss, NULL, &ticket_key, &found_ticket_key);
     if (rv != SECSuccess) goto loser;
+    PORT_Assert(found_ticket_key);
 
     if (ss->ssl3.pwSpec->msItem.len && ss->ssl3.pwSpec->msItem.data) {
 	/* The master secret is available unwrapped. */
@@ -1048,8 +1259,8 @@ ssl3_SendNewSessionTicket(sslSocket *ss)
 #ifndef NO_PKCS11_BYPASS
     if (ss->opt.bypassPKCS11) {
 	aes_ctx = (AESContext *)aes_ctx_buf;
-	rv = AES_InitContext(aes_ctx, aes_key, aes_key_length, iv, 
-	    NSS_AES_CBC, 1, AES_BLOCK_SIZE);
+	rv = AES_InitContext(aes_ctx, ticket_key.aes_key,
+	    sizeof(ticket_key.aes_key), iv, NSS_AES_CBC, 1, AES_BLOCK_SIZE);
 	if (rv != SECSuccess) goto loser;
 
 	rv = AES_Encrypt(aes_ctx, ciphertext.data, &ciphertext.len,
@@ -1060,7 +1271,7 @@ ssl3_SendNewSessionTicket(sslSocket *ss)
 #endif
     {
 	aes_ctx_pkcs11 = PK11_CreateContextBySymKey(cipherMech,
-	    CKA_ENCRYPT, aes_key_pkcs11, &ivItem);
+	    CKA_ENCRYPT, ticket_key.aes_key_pkcs11, &ivItem);
 	if (!aes_ctx_pkcs11) 
 	    goto loser;
 
@@ -1081,12 +1292,12 @@ ssl3_SendNewSessionTicket(sslSocket *ss)
     if (ss->opt.bypassPKCS11) {
 	hmac_ctx = (HMACContext *)hmac_ctx_buf;
 	hashObj = HASH_GetRawHashObject(HASH_AlgSHA256);
-	if (HMAC_Init(hmac_ctx, hashObj, mac_key,
-		mac_key_length, PR_FALSE) != SECSuccess)
+	if (HMAC_Init(hmac_ctx, hashObj, ticket_key.mac_key,
+		sizeof(ticket_key.mac_key), PR_FALSE) != SECSuccess)
 	    goto loser;
 
 	HMAC_Begin(hmac_ctx);
-	HMAC_Update(hmac_ctx, key_name, SESS_TICKET_KEY_NAME_LEN);
+	HMAC_Update(hmac_ctx, ticket_key.name, SESS_TICKET_KEY_NAME_LEN);
 	HMAC_Update(hmac_ctx, iv, sizeof(iv));
 	HMAC_Update(hmac_ctx, (unsigned char *)length_buf, 2);
 	HMAC_Update(hmac_ctx, ciphertext.data, ciphertext.len);
@@ -1099,12 +1310,12 @@ ssl3_SendNewSessionTicket(sslSocket *ss)
 	macParam.data = NULL;
 	macParam.len = 0;
 	hmac_ctx_pkcs11 = PK11_CreateContextBySymKey(macMech,
-	    CKA_SIGN, mac_key_pkcs11, &macParam);
+	    CKA_SIGN, ticket_key.mac_key_pkcs11, &macParam);
 	if (!hmac_ctx_pkcs11)
 	    goto loser;
 
 	rv = PK11_DigestBegin(hmac_ctx_pkcs11);
-	rv = PK11_DigestOp(hmac_ctx_pkcs11, key_name,
+	rv = PK11_DigestOp(hmac_ctx_pkcs11, ticket_key.name,
 	    SESS_TICKET_KEY_NAME_LEN);
 	rv = PK11_DigestOp(hmac_ctx_pkcs11, iv, sizeof(iv));
 	rv = PK11_DigestOp(hmac_ctx_pkcs11, (unsigned char *)length_buf, 2);
@@ -1127,7 +1338,7 @@ ssl3_SendNewSessionTicket(sslSocket *ss)
 	message_length - sizeof(ticket.ticket_lifetime_hint) - 2, 2);
     if (rv != SECSuccess) goto loser;
 
-    rv = ssl3_AppendHandshake(ss, key_name, SESS_TICKET_KEY_NAME_LEN);
+    rv = ssl3_AppendHandshake(ss, ticket_key.name, SESS_TICKET_KEY_NAME_LEN);
     if (rv != SECSuccess) goto loser;
 
     rv = ssl3_AppendHandshake(ss, iv, sizeof(iv));
@@ -1140,6 +1351,7 @@ ssl3_SendNewSessionTicket(sslSocket *ss)
     if (rv != SECSuccess) goto loser;
 
 loser:
+    ssl3_ReleaseTicketKey(&ticket_key);
     if (plaintext_item.data)
 	SECITEM_FreeItem(&plaintext_item, PR_FALSE);
     if (ciphertext.data)
@@ -1172,11 +1384,14 @@ ssl3_ServerHandleSessionTicketXtn(sslSocket *ss, PRUint16 ex_type,
     SessionTicket *parsed_session_ticket = NULL;
     sslSessionID *sid = NULL;
     SSL3Statistics *ssl3stats;
+    ssl3TicketKey ticket_key;
 
     /* Ignore the SessionTicket extension if processing is disabled. */
     if (!ss->opt.enableSessionTickets)
 	return SECSuccess;
 
+    PORT_Memset(&ticket_key, 0, sizeof(ticket_key));
+
     /* Keep track of negotiated extensions. */
     ss->xtnData.negotiated[ss->xtnData.numNegotiated++] = ex_type;
 
@@ -1194,17 +1409,12 @@ ssl3_ServerHandleSessionTicketXtn(sslSocket *ss, PRUint16 ex_type,
 	unsigned int           computed_mac_length;
 #ifndef NO_PKCS11_BYPASS
 	const SECHashObject   *hashObj;
-	const unsigned char   *aes_key;
-	const unsigned char   *mac_key;
-	PRUint32               aes_key_length;
-	PRUint32               mac_key_length;
 	PRUint64               hmac_ctx_buf[MAX_MAC_CONTEXT_LLONGS];
 	HMACContext           *hmac_ctx;
 	PRUint64               aes_ctx_buf[MAX_CIPHER_CONTEXT_LLONGS];
 	AESContext            *aes_ctx;
 #endif
-	PK11SymKey            *aes_key_pkcs11;
-	PK11SymKey            *mac_key_pkcs11;
+	PRBool                 found_ticket_key;
 	PK11Context           *hmac_ctx_pkcs11;
 	CK_MECHANISM_TYPE      macMech = CKM_SHA256_HMAC;
 	PK11Context           *aes_ctx_pkcs11;
@@ -1236,28 +1446,19 @@ ssl3_ServerHandleSessionTicketXtn(sslSocket *ss, PRUint16 ex_type,
 	    != SECSuccess)
 	    return SECFailure;
 
-	/* Get session ticket keys. */
-#ifndef NO_PKCS11_BYPASS
-	if (ss->opt.bypassPKCS11) {
-	    rv = ssl3_GetSessionTicketKeys(&aes_key, &aes_key_length,
-		&mac_key, &mac_key_length);
-	} else 
-#endif
-	{
-	    rv = ssl3_GetSessionTicketKeysPKCS11(ss, &aes_key_pkcs11,
-		&mac_key_pkcs11);
-	}
+	/* Get the session ticket keys the ticket was issued under. */
+	rv = ssl3_GetTicketKey(ss, enc_session_ticket.key_name, &ticket_key,
+	    &found_ticket_key);
 	if (rv != SECSuccess) {
 	    SSL_DBG(("%d: SSL[%d]: Unable to get/generate session ticket keys.",
 			SSL_GETPID(), ss->fd));
 	    goto loser;
 	}
 
-	/* If the ticket sent by the client was generated under a key different
-	 * from the one we have, bypass ticket processing.
+	/* If the ticket sent by the client was generated under a key we no
+	 * longer have, bypass ticket processing.
 	 */
-	if (PORT_Memcmp(enc_session_ticket.key_name, key_name,
-		SESS_TICKET_KEY_NAME_LEN) != 0) {
+	if (!found_ticket_key) {
 	    SSL_DBG(("%d: SSL[%d]: Session ticket key_name sent mismatch.",
 			SSL_GETPID(), ss->fd));
 	    goto no_ticket;
@@ -1270,8 +1471,8 @@ ssl3_ServerHandleSessionTicketXtn(sslSocket *ss, PRUint16 ex_type,
 	if (ss->opt.bypassPKCS11) {
 	    hmac_ctx = (HMACContext *)hmac_ctx_buf;
 	    hashObj = HASH_GetRawHashObject(HASH_AlgSHA256);
-	    if (HMAC_Init(hmac_ctx, hashObj, mac_key,
-		    sizeof(session_ticket_mac_key), PR_FALSE) != SECSuccess)
+	    if (HMAC_Init(hmac_ctx, hashObj, ticket_key.mac_key,
+		    sizeof(ticket_key.mac_key), PR_FALSE) != SECSuccess)
 		goto no_ticket;
 	    HMAC_Begin(hmac_ctx);
 	    HMAC_Update(hmac_ctx, extension_data.data,
@@ -1286,7 +1487,7 @@ ssl3_ServerHandleSessionTicketXtn(sslSocket *ss, PRUint16 ex_type,
 	    macParam.data = NULL;
 	    macParam.len = 0;
 	    hmac_ctx_pkcs11 = PK11_CreateContextBySymKey(macMech,
-		CKA_SIGN, mac_key_pkcs11, &macParam);
+		CKA_SIGN, ticket_key.mac_key_pkcs11, &macParam);
 	    if (!hmac_ctx_pkcs11) {
 		SSL_DBG(("%d: SSL[%d]: Unable to create HMAC context: %d.",
 			    SSL_GETPID(), ss->fd, PORT_GetError()));
@@ -1315,10 +1516,6 @@ ssl3_ServerHandleSessionTicketXtn(sslSocket *ss, PRUint16 ex_type,
 	    goto no_ticket;
 	}
 
-	/* We ignore key_name for now.
-	 * This is ok as MAC verification succeeded.
-	 */
-
 	/* Decrypt the ticket. */
 
 	/* Plaintext is shorter than the ciphertext due to padding. */
@@ -1328,8 +1525,8 @@ ssl3_ServerHandleSessionTicketXtn(sslSocket *ss, PRUint16 ex_type,
 #ifndef NO_PKCS11_BYPASS
 	if (ss->opt.bypassPKCS11) {
 	    aes_ctx = (AESContext *)aes_ctx_buf;
-	    rv = AES_InitContext(aes_ctx, aes_key,
-		sizeof(session_ticket_enc_key), enc_session_ticket.iv,
+	    rv = AES_InitContext(aes_ctx, ticket_key.aes_key,
+		sizeof(ticket_key.aes_key), enc_session_ticket.iv,
 		NSS_AES_CBC, 0,AES_BLOCK_SIZE);
 	    if (rv != SECSuccess) {
 		SSL_DBG(("%d: SSL[%d]: Unable to create AES context.",
@@ -1350,7 +1547,7 @@ ssl3_ServerHandleSessionTicketXtn(sslSocket *ss, PRUint16 ex_type,
 	    ivItem.data = enc_session_ticket.iv;
 	    ivItem.len = AES_BLOCK_SIZE;
 	    aes_ctx_pkcs11 = PK11_CreateContextBySymKey(cipherMech,
-		CKA_DECRYPT, aes_key_pkcs11, &ivItem);
+		CKA_DECRYPT, ticket_key.aes_key_pkcs11, &ivItem);
 	    if (!aes_ctx_pkcs11) {
 		SSL_DBG(("%d: SSL[%d]: Unable to create AES context.",
 			    SSL_GETPID(), ss->fd));
@@ -1575,6 +1772,7 @@ loser:
 	    ssl_FreeSID(sid);
 	    sid = NULL;
 	}
+    ssl3_ReleaseTicketKey(&ticket_key);
     if (decrypted_state != NULL) {
 	SECITEM_FreeItem(decrypted_state, PR_TRUE);
 	decrypted_state = NULL;
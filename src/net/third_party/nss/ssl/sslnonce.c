@@ -22,8 +22,24 @@
 PRUint32 ssl_sid_timeout = 100;
 PRUint32 ssl3_sid_timeout = 86400L; /* 24 hours */
 
-static sslSessionID *cache = NULL;
-static PZLock *      cacheLock = NULL;
+/* The client session cache is a hash table keyed on the server address,
+ * port and peerID, so that a lookup only walks the sids cached for one
+ * server rather than every sid in the process.  Each bucket has its own
+ * lock, which also protects the reference counts of all sids that hash to
+ * that bucket, whether or not they are cached.  A bucket's list is kept in
+ * most recently used order and holds at most SID_CACHE_MAX_BUCKET_ENTRIES
+ * sids; when it overflows, the least recently used sid is dropped.
+ */
+#define SID_CACHE_BUCKETS		1024	/* must be a power of 2 */
+#define SID_CACHE_MAX_BUCKET_ENTRIES	32
+
+typedef struct sidCacheBucketStr {
+    sslSessionID *head;
+    PRUint32      count;
+    PZLock *      lock;
+} sidCacheBucket;
+
+static sidCacheBucket cache[SID_CACHE_BUCKETS];
 
 /* sids can be in one of 4 states:
  *
@@ -33,26 +49,64 @@ static PZLock *      cacheLock = NULL;
  * invalid_cache	has been removed from the cache. 
  */
 
-#define LOCK_CACHE 	lock_cache()
-#define UNLOCK_CACHE	PZ_Unlock(cacheLock)
+#define LOCK_BUCKET(bucket)	lock_bucket(bucket)
+#define UNLOCK_BUCKET(bucket)	PZ_Unlock((bucket)->lock)
 
-static SECStatus
-ssl_InitClientSessionCacheLock(void)
+/* Returns the cache bucket for sids of the server at addr:port reached
+ * through peerID.  The hash is FNV-1a.
+ */
+static sidCacheBucket *
+ssl_GetSIDCacheBucket(const PRIPv6Addr *addr, PRUint16 port,
+                      const char *peerID)
 {
-    cacheLock = PZ_NewLock(nssILockCache);
-    return cacheLock ? SECSuccess : SECFailure;
+    const unsigned char *p = (const unsigned char *)addr;
+    PRUint32 hash = 2166136261U;
+    unsigned int i;
+
+    for (i = 0; i < sizeof(PRIPv6Addr); i++) {
+	hash = (hash ^ p[i]) * 16777619U;
+    }
+    hash = (hash ^ (port & 0xff)) * 16777619U;
+    hash = (hash ^ (port >> 8)) * 16777619U;
+    if (peerID) {
+	for (p = (const unsigned char *)peerID; *p; p++) {
+	    hash = (hash ^ *p) * 16777619U;
+	}
+    }
+    return &cache[hash & (SID_CACHE_BUCKETS - 1)];
 }
 
+#define SID_BUCKET(sid) \
+    ssl_GetSIDCacheBucket(&(sid)->addr, (sid)->port, (sid)->peerID)
+
 static SECStatus
 ssl_FreeClientSessionCacheLock(void)
 {
-    if (cacheLock) {
-        PZ_DestroyLock(cacheLock);
-        cacheLock = NULL;
-        return SECSuccess;
+    int i;
+
+    if (!cache[0].lock) {
+	PORT_SetError(SEC_ERROR_NOT_INITIALIZED);
+	return SECFailure;
     }
-    PORT_SetError(SEC_ERROR_NOT_INITIALIZED);
-    return SECFailure;
+    for (i = 0; i < SID_CACHE_BUCKETS && cache[i].lock; i++) {
+	PZ_DestroyLock(cache[i].lock);
+	cache[i].lock = NULL;
+    }
+    return SECSuccess;
+}
+
+/* On failure, the caller frees the locks that were created. */
+static SECStatus
+ssl_InitClientSessionCacheLock(void)
+{
+    int i;
+
+    for (i = 0; i < SID_CACHE_BUCKETS; i++) {
+	cache[i].lock = PZ_NewLock(nssILockCache);
+	if (!cache[i].lock)
+	    return SECFailure;
+    }
+    return SECSuccess;
 }
 
 static PRBool LocksInitializedEarly = PR_FALSE;
@@ -153,10 +207,10 @@ ssl_InitSessionCacheLocks(PRBool lazyInit)
 }
 
 static void 
-lock_cache(void)
+lock_bucket(sidCacheBucket *bucket)
 {
     ssl_InitSessionCacheLocks(PR_TRUE);
-    PZ_Lock(cacheLock);
+    PZ_Lock(bucket->lock);
 }
 
 /* BEWARE: This function gets called for both client and server SIDs !!
@@ -170,7 +224,7 @@ ssl_DestroySID(sslSessionID *sid)
     PORT_Assert((sid->references == 0));
 
     if (sid->cached == in_client_cache)
-    	return;	/* it will get taken care of next time cache is traversed. */
+    	return;	/* it will get taken care of next time its bucket is traversed. */
 
     if (sid->version < SSL_LIBRARY_VERSION_3_0) {
 	SECITEM_ZfreeItem(&sid->u.ssl2.masterKey, PR_FALSE);
@@ -232,9 +286,11 @@ ssl_FreeLockedSID(sslSessionID *sid)
 void
 ssl_FreeSID(sslSessionID *sid)
 {
-    LOCK_CACHE;
+    sidCacheBucket *bucket = SID_BUCKET(sid);
+
+    LOCK_BUCKET(bucket);
     ssl_FreeLockedSID(sid);
-    UNLOCK_CACHE;
+    UNLOCK_BUCKET(bucket);
 }
 
 /************************************************************************/
@@ -243,6 +299,7 @@ ssl_FreeSID(sslSessionID *sid)
 **  Lookup sid entry in cache by Address, port, and peerID string.
 **  If found, Increment reference count, and return pointer to caller.
 **  If it has timed out or ref count is zero, remove from list and free it.
+**  Only the bucket that addr, port and peerID hash to is searched.
 */
 
 sslSessionID *
@@ -251,13 +308,15 @@ ssl_LookupSID(const PRIPv6Addr *addr, PRUint16 port, const char *peerID,
 {
     sslSessionID **sidp;
     sslSessionID * sid;
+    sidCacheBucket *bucket;
     PRUint32       now;
 
     if (!urlSvrName)
     	return NULL;
     now = ssl_Time();
-    LOCK_CACHE;
-    sidp = &cache;
+    bucket = ssl_GetSIDCacheBucket(addr, port, peerID);
+    LOCK_BUCKET(bucket);
+    sidp = &bucket->head;
     while ((sid = *sidp) != 0) {
 	PORT_Assert(sid->cached == in_client_cache);
 	PORT_Assert(sid->references >= 1);
@@ -273,6 +332,7 @@ ssl_LookupSID(const PRIPv6Addr *addr, PRUint16 port, const char *peerID,
 			now - sid->creationTime, sid->references));
 
 	    *sidp = sid->next; 			/* delink it from the list. */
+	    bucket->count--;
 	    sid->cached = invalid_cache;	/* mark not on list. */
 	    if (!sid->references)
 	    	ssl_DestroySID(sid);
@@ -294,7 +354,10 @@ ssl_LookupSID(const PRIPv6Addr *addr, PRUint16 port, const char *peerID,
 		    ((sid->peerCert != NULL) && (SECSuccess == 
 		      CERT_VerifyCertName(sid->peerCert, urlSvrName))) )
 		  ) {
-	    /* Hit */
+	    /* Hit.  Move it to the front of the bucket's LRU list. */
+	    *sidp = sid->next;
+	    sid->next = bucket->head;
+	    bucket->head = sid;
 	    sid->lastAccessTime = now;
 	    sid->references++;
 	    break;
@@ -302,7 +365,7 @@ ssl_LookupSID(const PRIPv6Addr *addr, PRUint16 port, const char *peerID,
 	    sidp = &sid->next;
 	}
     }
-    UNLOCK_CACHE;
+    UNLOCK_BUCKET(bucket);
     return sid;
 }
 
@@ -313,6 +376,9 @@ ssl_LookupSID(const PRIPv6Addr *addr, PRUint16 port, const char *peerID,
 static void 
 CacheSID(sslSessionID *sid)
 {
+    sidCacheBucket *bucket;
+    sslSessionID  **sidp;
+    sslSessionID *  evicted;
     PRUint32  expirationPeriod;
     SSL_TRC(8, ("SSL: Cache: sid=0x%x cached=%d addr=0x%08x%08x%08x%08x port=0x%04x "
 		"time=%x cached=%d",
@@ -366,23 +432,36 @@ CacheSID(sslSessionID *sid)
      * cache is holding a reference. Uncache will reduce the cache
      * reference.
      */
-    LOCK_CACHE;
+    bucket = SID_BUCKET(sid);
+    LOCK_BUCKET(bucket);
     sid->references++;
-    sid->cached = in_client_cache;
-    sid->next   = cache;
-    cache       = sid;
-    UNLOCK_CACHE;
+    sid->cached  = in_client_cache;
+    sid->next    = bucket->head;
+    bucket->head = sid;
+    if (++bucket->count > SID_CACHE_MAX_BUCKET_ENTRIES) {
+	/* Drop the least recently used sid, at the end of the list. */
+	sidp = &bucket->head;
+	while ((*sidp)->next != NULL)
+	    sidp = &(*sidp)->next;
+	evicted = *sidp;
+	*sidp = NULL;
+	bucket->count--;
+	SSL_TRC(7, ("SSL: cache full, evicting sid=0x%x", evicted));
+	evicted->cached = invalid_cache;
+	ssl_FreeLockedSID(evicted);
+    }
+    UNLOCK_BUCKET(bucket);
 }
 
 /* 
  * If sid "zap" is in the cache,
  *    removes sid from cache, and decrements reference count.
- * Caller must hold cache lock.
+ * Caller must hold the lock of "bucket", the bucket that zap hashes to.
  */
 static void
-UncacheSID(sslSessionID *zap)
+UncacheSID(sidCacheBucket *bucket, sslSessionID *zap)
 {
-    sslSessionID **sidp = &cache;
+    sslSessionID **sidp = &bucket->head;
     sslSessionID *sid;
 
     if (zap->cached != in_client_cache) {
@@ -412,6 +491,7 @@ UncacheSID(sslSessionID *zap)
 	    ** everyone is done with the sid we can free it up.
 	    */
 	    *sidp = zap->next;
+	    bucket->count--;
 	    zap->cached = invalid_cache;
 	    ssl_FreeLockedSID(zap);
 	    return;
@@ -428,10 +508,11 @@ UncacheSID(sslSessionID *zap)
 static void
 LockAndUncacheSID(sslSessionID *zap)
 {
-    LOCK_CACHE;
-    UncacheSID(zap);
-    UNLOCK_CACHE;
+    sidCacheBucket *bucket = SID_BUCKET(zap);
 
+    LOCK_BUCKET(bucket);
+    UncacheSID(bucket, zap);
+    UNLOCK_BUCKET(bucket);
 }
 
 /* choose client or server cache functions for this sslsocket. */
@@ -451,10 +532,16 @@ ssl_ChooseSessionIDProcs(sslSecurityInfo *sec)
 void
 SSL_ClearSessionCache(void)
 {
-    LOCK_CACHE;
-    while(cache != NULL)
-	UncacheSID(cache);
-    UNLOCK_CACHE;
+    int i;
+
+    for (i = 0; i < SID_CACHE_BUCKETS; i++) {
+	sidCacheBucket *bucket = &cache[i];
+
+	LOCK_BUCKET(bucket);
+	while (bucket->head != NULL)
+	    UncacheSID(bucket, bucket->head);
+	UNLOCK_BUCKET(bucket);
+    }
 }
 
 /* returns an unsigned int containing the number of seconds in PR_Now() */
@@ -481,9 +568,10 @@ SECStatus
 ssl3_SetSIDSessionTicket(sslSessionID *sid, NewSessionTicket *session_ticket)
 {
     SECStatus rv;
+    sidCacheBucket *bucket = SID_BUCKET(sid);
 
     /* We need to lock the cache, as this sid might already be in the cache. */
-    LOCK_CACHE;
+    LOCK_BUCKET(bucket);
 
     /* A server might have sent us an empty ticket, which has the
      * effect of clearing the previously known ticket.
@@ -494,7 +582,7 @@ ssl3_SetSIDSessionTicket(sslSessionID *sid, NewSessionTicket *session_ticket)
 	rv = SECITEM_CopyItem(NULL, &sid->u.ssl3.sessionTicket.ticket,
 	    &session_ticket->ticket);
 	if (rv != SECSuccess) {
-	    UNLOCK_CACHE;
+	    UNLOCK_BUCKET(bucket);
 	    return rv;
 	}
     } else {
@@ -506,6 +594,6 @@ ssl3_SetSIDSessionTicket(sslSessionID *sid, NewSessionTicket *session_ticket)
     sid->u.ssl3.sessionTicket.ticket_lifetime_hint =
 	session_ticket->ticket_lifetime_hint;
 
-    UNLOCK_CACHE;
+    UNLOCK_BUCKET(bucket);
     return SECSuccess;
 }
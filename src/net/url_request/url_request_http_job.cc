@@ -230,7 +230,7 @@ URLRequestHttpJob::URLRequestHttpJob(
     : URLRequestJob(request, network_delegate),
       priority_(DEFAULT_PRIORITY),
       response_info_(NULL),
-      response_cookies_save_index_(0),
+      pending_cookie_saves_(0),
       proxy_auth_state_(AUTH_STATE_DONT_NEED_AUTH),
       server_auth_state_(AUTH_STATE_DONT_NEED_AUTH),
       start_callback_(base::Bind(
@@ -664,34 +664,33 @@ void URLRequestHttpJob::SaveCookiesAndNotifyHeadersComplete(int result) {
   DCHECK(response_info);
 
   response_cookies_.clear();
-  response_cookies_save_index_ = 0;
 
   FetchResponseCookies(&response_cookies_);
 
   if (!GetResponseHeaders()->GetDateValue(&response_date_))
     response_date_ = base::Time();
 
-  // Now, loop over the response cookies, and attempt to persist each.
-  SaveNextCookie();
+  // Now, attempt to persist the response cookies.
+  SaveResponseCookies();
 }
 
-// If the save occurs synchronously, SaveNextCookie will loop and save the next
-// cookie. If the save is deferred, the callback is responsible for continuing
-// to iterate through the cookies.
+// All cookies that pass the cookie policy are handed to the cookie store up
+// front rather than one at a time.  The store applies them in the order they
+// were set, so the job only has to wait for the store once per response
+// instead of once per cookie.
 // TODO(erikwright): Modify the CookieStore API to indicate via return value
 // whether it completed synchronously or asynchronously.
 // See http://crbug.com/131066.
-void URLRequestHttpJob::SaveNextCookie() {
+void URLRequestHttpJob::SaveResponseCookies() {
   // No matter what, we want to report our status as IO pending since we will
   // be notifying our consumer asynchronously via OnStartCompleted.
   SetStatus(URLRequestStatus(URLRequestStatus::IO_PENDING, 0));
 
   // Used to communicate with the callback. See the implementation of
   // OnCookieSaved.
-  scoped_refptr<SharedBoolean> callback_pending = new SharedBoolean(false);
-  scoped_refptr<SharedBoolean> save_next_cookie_running =
-      new SharedBoolean(true);
+  scoped_refptr<SharedBoolean> save_cookies_running = new SharedBoolean(true);
 
+  DCHECK_EQ(0u, pending_cookie_saves_);
   if (!(request_info_.load_flags & LOAD_DO_NOT_SAVE_COOKIES) &&
       request_->context()->cookie_store() &&
       response_cookies_.size() > 0) {
@@ -699,60 +698,55 @@ void URLRequestHttpJob::SaveNextCookie() {
     options.set_include_httponly();
     options.set_server_time(response_date_);
 
+    // Run the whole response past the cookie policy before setting anything,
+    // so the saves below go out back to back.
+    std::vector<std::string> cookies;
+    std::vector<CookieOptions> cookie_options;
+    for (size_t i = 0; i < response_cookies_.size(); ++i) {
+      if (CanSetCookie(response_cookies_[i], &options)) {
+        cookies.push_back(response_cookies_[i]);
+        cookie_options.push_back(options);
+      }
+    }
+
+    pending_cookie_saves_ = cookies.size();
     net::CookieStore::SetCookiesCallback callback(
         base::Bind(&URLRequestHttpJob::OnCookieSaved,
                    weak_factory_.GetWeakPtr(),
-                   save_next_cookie_running,
-                   callback_pending));
-
-    // Loop through the cookies as long as SetCookieWithOptionsAsync completes
-    // synchronously.
-    while (!callback_pending->data &&
-           response_cookies_save_index_ < response_cookies_.size()) {
-      if (CanSetCookie(
-          response_cookies_[response_cookies_save_index_], &options)) {
-        callback_pending->data = true;
-        request_->context()->cookie_store()->SetCookieWithOptionsAsync(
-            request_->url(), response_cookies_[response_cookies_save_index_],
-            options, callback);
-      }
-      ++response_cookies_save_index_;
+                   save_cookies_running));
+    CookieStore* cookie_store = request_->context()->cookie_store();
+    for (size_t i = 0; i < cookies.size(); ++i) {
+      cookie_store->SetCookieWithOptionsAsync(
+          request_->url(), cookies[i], cookie_options[i], callback);
     }
   }
 
-  save_next_cookie_running->data = false;
+  save_cookies_running->data = false;
+  response_cookies_.clear();
 
-  if (!callback_pending->data) {
-    response_cookies_.clear();
-    response_cookies_save_index_ = 0;
+  if (pending_cookie_saves_ == 0) {
     SetStatus(URLRequestStatus());  // Clear the IO_PENDING status
     NotifyHeadersComplete();
-    return;
   }
 }
 
-// |save_next_cookie_running| is true when the callback is bound and set to
-// false when SaveNextCookie exits, allowing the callback to determine if the
-// save occurred synchronously or asynchronously.
-// |callback_pending| is false when the callback is invoked and will be set to
-// true by the callback, allowing SaveNextCookie to detect whether the save
-// occurred synchronously.
-// See SaveNextCookie() for more information.
+// |save_cookies_running| is true when the callback is bound and set to false
+// when SaveResponseCookies exits, allowing the callback to determine if the
+// saves completed synchronously or asynchronously.  If they all completed
+// synchronously, SaveResponseCookies finishes up itself.
+// See SaveResponseCookies() for more information.
 void URLRequestHttpJob::OnCookieSaved(
-    scoped_refptr<SharedBoolean> save_next_cookie_running,
-    scoped_refptr<SharedBoolean> callback_pending,
+    scoped_refptr<SharedBoolean> save_cookies_running,
     bool cookie_status) {
-  callback_pending->data = false;
-
-  // If we were called synchronously, return.
-  if (save_next_cookie_running->data) {
+  DCHECK_GT(pending_cookie_saves_, 0u);
+  if (--pending_cookie_saves_ > 0 || save_cookies_running->data)
     return;
-  }
 
-  // We were called asynchronously, so trigger the next save.
+  // The last save completed asynchronously.
   // We may have been canceled within OnSetCookie.
   if (GetStatus().is_success()) {
-    SaveNextCookie();
+    SetStatus(URLRequestStatus());  // Clear the IO_PENDING status
+    NotifyHeadersComplete();
   } else {
     NotifyCanceled();
   }
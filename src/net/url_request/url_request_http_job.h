@@ -75,7 +75,7 @@ class NET_EXPORT_PRIVATE URLRequestHttpJob : public URLRequestJob {
   void AddExtraHeaders();
   void AddCookieHeaderAndStart();
   void SaveCookiesAndNotifyHeadersComplete(int result);
-  void SaveNextCookie();
+  void SaveResponseCookies();
   void FetchResponseCookies(std::vector<std::string>* cookies);
 
   // Processes the Strict-Transport-Security header, if one exists.
@@ -146,10 +146,8 @@ class NET_EXPORT_PRIVATE URLRequestHttpJob : public URLRequestJob {
   void OnCookiesLoaded(const std::string& cookie_line);
   void DoStartTransaction();
 
-  // See the implementation for a description of save_next_cookie_running and
-  // callback_pending.
-  void OnCookieSaved(scoped_refptr<SharedBoolean> save_next_cookie_running,
-                     scoped_refptr<SharedBoolean> callback_pending,
+  // See the implementation for a description of save_cookies_running.
+  void OnCookieSaved(scoped_refptr<SharedBoolean> save_cookies_running,
                      bool cookie_status);
 
   // Some servers send the body compressed, but specify the content length as
@@ -172,7 +170,9 @@ class NET_EXPORT_PRIVATE URLRequestHttpJob : public URLRequestJob {
   const HttpResponseInfo* response_info_;
 
   std::vector<std::string> response_cookies_;
-  size_t response_cookies_save_index_;
+  // Number of cookie store writes for the current response that haven't
+  // completed yet.
+  size_t pending_cookie_saves_;
   base::Time response_date_;
 
   // Auth states for proxy and origin server.
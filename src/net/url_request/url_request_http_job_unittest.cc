@@ -0,0 +1,279 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/url_request/url_request_http_job.h"
+
+#include <string>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/bind.h"
+#include "base/compiler_specific.h"
+#include "base/memory/ref_counted.h"
+#include "base/message_loop.h"
+#include "base/string_util.h"
+#include "googleurl/src/gurl.h"
+#include "net/cookies/cookie_monster.h"
+#include "net/cookies/cookie_store.h"
+#include "net/http/http_transaction_unittest.h"
+#include "net/url_request/url_request.h"
+#include "net/url_request/url_request_test_util.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace net {
+
+namespace {
+
+// Set-Cookie lines sent with the responses below.  Cookies whose name starts
+// with "blocked" are rejected by BlockingNetworkDelegate.
+const char kSetCookieHeaders[] =
+    "Set-Cookie: a=1\n"
+    "Set-Cookie: b=2\n"
+    "Set-Cookie: c=3\n"
+    "Set-Cookie: d=4\n";
+const size_t kNumSetCookieHeaders = 4;
+
+const char kPartlyBlockedSetCookieHeaders[] =
+    "Set-Cookie: a=1\n"
+    "Set-Cookie: blocked_b=2\n"
+    "Set-Cookie: c=3\n"
+    "Set-Cookie: blocked_d=4\n"
+    "Set-Cookie: e=5\n";
+const size_t kNumPermittedSetCookieHeaders = 3;
+
+// A CookieStore that saves cookies in a CookieMonster, and runs the callback
+// for each save either synchronously or from a posted task, following a
+// schedule given up front.
+class ScheduledCookieStore : public CookieStore {
+ public:
+  // The i-th save's callback is run asynchronously if |async_saves[i]| is
+  // true.  Saves past the end of the schedule complete synchronously.
+  explicit ScheduledCookieStore(const std::vector<bool>& async_saves)
+      : cookie_monster_(new CookieMonster(NULL, NULL)),
+        async_saves_(async_saves),
+        num_saves_(0),
+        num_saves_completed_(0) {
+  }
+
+  size_t num_saves() const { return num_saves_; }
+  size_t num_saves_completed() const { return num_saves_completed_; }
+
+  // CookieStore implementation:
+  virtual void SetCookieWithOptionsAsync(
+      const GURL& url,
+      const std::string& cookie_line,
+      const CookieOptions& options,
+      const SetCookiesCallback& callback) OVERRIDE {
+    bool async = num_saves_ < async_saves_.size() && async_saves_[num_saves_];
+    ++num_saves_;
+    cookie_monster_->SetCookieWithOptionsAsync(
+        url, cookie_line, options,
+        base::Bind(&ScheduledCookieStore::OnCookieSet, this, async, callback));
+  }
+
+  virtual void GetCookiesWithOptionsAsync(
+      const GURL& url,
+      const CookieOptions& options,
+      const GetCookiesCallback& callback) OVERRIDE {
+    cookie_monster_->GetCookiesWithOptionsAsync(url, options, callback);
+  }
+
+  virtual void DeleteCookieAsync(const GURL& url,
+                                 const std::string& cookie_name,
+                                 const base::Closure& callback) OVERRIDE {
+    cookie_monster_->DeleteCookieAsync(url, cookie_name, callback);
+  }
+
+  virtual void DeleteAllCreatedBetweenAsync(
+      const base::Time& delete_begin,
+      const base::Time& delete_end,
+      const DeleteCallback& callback) OVERRIDE {
+    cookie_monster_->DeleteAllCreatedBetweenAsync(delete_begin, delete_end,
+                                                  callback);
+  }
+
+  virtual void DeleteSessionCookiesAsync(
+      const DeleteCallback& callback) OVERRIDE {
+    cookie_monster_->DeleteSessionCookiesAsync(callback);
+  }
+
+  virtual CookieMonster* GetCookieMonster() OVERRIDE {
+    return cookie_monster_.get();
+  }
+
+ private:
+  virtual ~ScheduledCookieStore() {}
+
+  void OnCookieSet(bool async,
+                   const SetCookiesCallback& callback,
+                   bool success) {
+    if (async) {
+      base::MessageLoop::current()->PostTask(
+          FROM_HERE, base::Bind(&ScheduledCookieStore::RunCallback, this,
+                                callback, success));
+      return;
+    }
+    RunCallback(callback, success);
+  }
+
+  void RunCallback(const SetCookiesCallback& callback, bool success) {
+    ++num_saves_completed_;
+    callback.Run(success);
+  }
+
+  scoped_refptr<CookieMonster> cookie_monster_;
+  const std::vector<bool> async_saves_;
+  size_t num_saves_;
+  size_t num_saves_completed_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScheduledCookieStore);
+};
+
+// Rejects cookies whose name starts with "blocked".
+class BlockingNetworkDelegate : public TestNetworkDelegate {
+ public:
+  BlockingNetworkDelegate() {}
+
+ private:
+  virtual bool OnCanSetCookie(const URLRequest& request,
+                              const std::string& cookie_line,
+                              CookieOptions* options) OVERRIDE {
+    return !StartsWithASCII(cookie_line, "blocked", true);
+  }
+
+  DISALLOW_COPY_AND_ASSIGN(BlockingNetworkDelegate);
+};
+
+// Records how many cookie saves had completed each time the response
+// started, i.e. when the job called NotifyHeadersComplete().
+class CookieSaveCountingDelegate : public TestDelegate {
+ public:
+  explicit CookieSaveCountingDelegate(ScheduledCookieStore* cookie_store)
+      : cookie_store_(cookie_store) {
+  }
+
+  const std::vector<size_t>& saves_completed_at_response_start() const {
+    return saves_completed_at_response_start_;
+  }
+
+  virtual void OnResponseStarted(URLRequest* request) OVERRIDE {
+    saves_completed_at_response_start_.push_back(
+        cookie_store_->num_saves_completed());
+    TestDelegate::OnResponseStarted(request);
+  }
+
+ private:
+  ScheduledCookieStore* cookie_store_;
+  std::vector<size_t> saves_completed_at_response_start_;
+
+  DISALLOW_COPY_AND_ASSIGN(CookieSaveCountingDelegate);
+};
+
+class URLRequestHttpJobCookieTest : public testing::Test {
+ protected:
+  URLRequestHttpJobCookieTest() {}
+
+  // Fetches a response carrying |set_cookie_headers|.  The i-th cookie that
+  // reaches the cookie store completes asynchronously if |async_saves[i]|
+  // is true.  Checks that the headers complete exactly once, after the last
+  // of |expected_saves| saves.
+  void FetchAndCheckSaves(const char* set_cookie_headers,
+                          const bool* async_saves,
+                          size_t num_async_saves,
+                          size_t expected_saves) {
+    scoped_refptr<ScheduledCookieStore> cookie_store(new ScheduledCookieStore(
+        std::vector<bool>(async_saves, async_saves + num_async_saves)));
+
+    TestURLRequestContext context(true);
+    context.set_http_transaction_factory(&network_layer_);
+    context.set_network_delegate(&network_delegate_);
+    context.set_cookie_store(cookie_store);
+    context.Init();
+
+    MockTransaction transaction(kSimpleGET_Transaction);
+    transaction.response_headers = set_cookie_headers;
+    AddMockTransaction(&transaction);
+
+    CookieSaveCountingDelegate delegate(cookie_store);
+    {
+      URLRequest request(GURL(transaction.url), &delegate, &context);
+      request.Start();
+      base::MessageLoop::current()->Run();
+
+      EXPECT_TRUE(request.status().is_success());
+      EXPECT_EQ(1, delegate.response_started_count());
+    }
+
+    RemoveMockTransaction(&transaction);
+
+    EXPECT_EQ(expected_saves, cookie_store->num_saves());
+    EXPECT_EQ(expected_saves, cookie_store->num_saves_completed());
+    ASSERT_EQ(1u, delegate.saves_completed_at_response_start().size());
+    EXPECT_EQ(expected_saves, delegate.saves_completed_at_response_start()[0]);
+  }
+
+ private:
+  base::MessageLoopForIO message_loop_;
+  MockNetworkLayer network_layer_;
+  BlockingNetworkDelegate network_delegate_;
+};
+
+}  // namespace
+
+TEST_F(URLRequestHttpJobCookieTest, SynchronousSaves) {
+  const bool kAsyncSaves[] = { false, false, false, false };
+  FetchAndCheckSaves(kSetCookieHeaders, kAsyncSaves, arraysize(kAsyncSaves),
+                     kNumSetCookieHeaders);
+}
+
+TEST_F(URLRequestHttpJobCookieTest, AsynchronousSaves) {
+  const bool kAsyncSaves[] = { true, true, true, true };
+  FetchAndCheckSaves(kSetCookieHeaders, kAsyncSaves, arraysize(kAsyncSaves),
+                     kNumSetCookieHeaders);
+}
+
+// Only the first save is asynchronous, so it completes after all the others.
+TEST_F(URLRequestHttpJobCookieTest, FirstSaveAsynchronous) {
+  const bool kAsyncSaves[] = { true, false, false, false };
+  FetchAndCheckSaves(kSetCookieHeaders, kAsyncSaves, arraysize(kAsyncSaves),
+                     kNumSetCookieHeaders);
+}
+
+// Only the last save is asynchronous.
+TEST_F(URLRequestHttpJobCookieTest, LastSaveAsynchronous) {
+  const bool kAsyncSaves[] = { false, false, false, true };
+  FetchAndCheckSaves(kSetCookieHeaders, kAsyncSaves, arraysize(kAsyncSaves),
+                     kNumSetCookieHeaders);
+}
+
+// Cookies rejected by the network delegate never reach the store, and the
+// headers still complete once, after the last permitted save.
+TEST_F(URLRequestHttpJobCookieTest, BlockedCookiesSynchronousSaves) {
+  const bool kAsyncSaves[] = { false, false, false };
+  FetchAndCheckSaves(kPartlyBlockedSetCookieHeaders, kAsyncSaves,
+                     arraysize(kAsyncSaves), kNumPermittedSetCookieHeaders);
+}
+
+TEST_F(URLRequestHttpJobCookieTest, BlockedCookiesAsynchronousSaves) {
+  const bool kAsyncSaves[] = { true, true, true };
+  FetchAndCheckSaves(kPartlyBlockedSetCookieHeaders, kAsyncSaves,
+                     arraysize(kAsyncSaves), kNumPermittedSetCookieHeaders);
+}
+
+// The last cookie is permitted but the one before it is blocked, so the
+// final save in the response follows a rejected cookie.
+TEST_F(URLRequestHttpJobCookieTest, BlockedCookiesMixedSaves) {
+  const bool kAsyncSaves[] = { true, false, true };
+  FetchAndCheckSaves(kPartlyBlockedSetCookieHeaders, kAsyncSaves,
+                     arraysize(kAsyncSaves), kNumPermittedSetCookieHeaders);
+}
+
+// Every cookie is blocked, so the headers complete without any saves.
+TEST_F(URLRequestHttpJobCookieTest, AllCookiesBlocked) {
+  FetchAndCheckSaves("Set-Cookie: blocked_a=1\n"
+                     "Set-Cookie: blocked_b=2\n",
+                     NULL, 0, 0);
+}
+
+}  // namespace net